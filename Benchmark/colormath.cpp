@@ -0,0 +1,116 @@
+// microbenchmark for the color math / output kernel of the ppu
+// checks every kernel available on this machine against the portable one, then times a line of each
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <chrono>
+#include <vector>
+
+#include <colormath.h>
+
+typedef struct TestLine {
+  uint16_t main[256];
+  uint16_t sub[256];
+  uint16_t left[256];
+  uint8_t clip[256];
+  uint8_t math[256];
+  uint8_t half[256];
+  bool hires;
+  bool subtract;
+  int brightness;
+} TestLine;
+
+static uint32_t rngState = 0x12345678;
+static volatile uint32_t sink; // keeps the timed loop from being optimized away
+
+static uint32_t nextRandom() {
+  // xorshift32
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+static uint8_t randomMask(int percent) {
+  return (int) (nextRandom() % 100) < percent ? 0xff : 0;
+}
+
+static void fillLine(TestLine* test) {
+  for(int x = 0; x < 256; x++) {
+    test->main[x] = nextRandom() & 0x7fff;
+    test->sub[x] = nextRandom() & 0x7fff;
+    test->left[x] = nextRandom() & 0x7fff;
+    test->clip[x] = randomMask(10);
+    test->math[x] = randomMask(60);
+    test->half[x] = randomMask(50);
+  }
+  test->hires = nextRandom() & 1;
+  test->subtract = nextRandom() & 1;
+  test->brightness = nextRandom() % 16;
+}
+
+static ColorMathLine toLine(const TestLine* test) {
+  ColorMathLine line;
+  line.main = test->main;
+  line.sub = test->sub;
+  line.left = test->hires ? test->left : NULL;
+  line.clip = test->clip;
+  line.math = test->math;
+  line.half = test->half;
+  line.subtract = test->subtract;
+  line.brightness = test->brightness;
+  return line;
+}
+
+int main(int argc, char** argv) {
+  int lines = argc > 1 ? atoi(argv[1]) : 200000;
+  if(lines <= 0) {
+    fprintf(stderr, "usage: %s [lines]\n", argv[0]);
+    return 1;
+  }
+  std::vector<TestLine> tests(64);
+  for(TestLine& test : tests) fillLine(&test);
+  // bit-exactness against the portable kernel, including odd counts for the tail handling
+  uint8_t expected[256 * 8];
+  uint8_t actual[256 * 8];
+  bool ok = true;
+  for(int kernel = COLORMATH_PORTABLE + 1; kernel < COLORMATH_KERNEL_COUNT; kernel++) {
+    if(!colormath_hasKernel(kernel)) continue;
+    for(int i = 0; i < 4096 && ok; i++) {
+      if(i % tests.size() == 0) for(TestLine& t : tests) fillLine(&t);
+      TestLine* test = &tests[i % tests.size()];
+      ColorMathLine line = toLine(test);
+      int count = (i & 1) ? 256 : 1 + nextRandom() % 256;
+      memset(expected, 0xaa, sizeof(expected));
+      memset(actual, 0xaa, sizeof(actual));
+      colormath_renderLineWith(COLORMATH_PORTABLE, &line, expected, count);
+      colormath_renderLineWith(kernel, &line, actual, count);
+      if(memcmp(expected, actual, sizeof(expected)) != 0) {
+        fprintf(stderr, "%s differs from portable (count %d, brightness %d)\n", colormath_kernelName(kernel), count, test->brightness);
+        ok = false;
+      }
+    }
+  }
+  if(!ok) return 3;
+  // throughput
+  printf("%-10s %12s %12s\n", "kernel", "ns/line", "Mpixels/s");
+  std::vector<uint8_t> out(256 * 8);
+  for(int kernel = COLORMATH_PORTABLE; kernel < COLORMATH_KERNEL_COUNT; kernel++) {
+    if(!colormath_hasKernel(kernel)) continue;
+    std::vector<ColorMathLine> prepared;
+    for(const TestLine& test : tests) prepared.push_back(toLine(&test));
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < lines; i++) {
+      colormath_renderLineWith(kernel, &prepared[i & 63], out.data(), 256);
+      sink = sink + out[i & 2047];
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-10s %12.1f %12.1f\n", colormath_kernelName(kernel), seconds * 1e9 / lines, 256.0 * lines / seconds / 1e6);
+  }
+  printf("auto: %s\n", colormath_kernelName(COLORMATH_AUTO));
+  return 0;
+}
@@ -0,0 +1,604 @@
+// headless frame-throughput benchmark for the core
+// runs each rom for a number of warm-up frames, then times every frame of the measured run
+// with --check-threads it instead runs several instances at once and checks them against a serial run,
+// with --batch it measures the aggregate throughput of many instances on the batch runner
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <snes.h>
+#include <batch.h>
+
+#include "../Tests/testrom.h" // hashFrame, sameCpu
+
+typedef enum OutputFormat {
+  OUTPUT_TEXT = 0,
+  OUTPUT_JSON,
+  OUTPUT_CSV
+} OutputFormat;
+
+typedef struct BenchOptions {
+  int frames;
+  int warmup;
+  bool video;
+  int pixelFormat; // PPU_FORMAT_* for --video, -1: snes_setPixels
+  bool audio;
+  bool stats;
+  bool ppuThread; // render on the ppu worker thread (snes_setPpuThread)
+  int frameSkip; // snes_setFrameSkip
+  bool checkTiming; // compare the timing shortcuts against exact timing instead of benchmarking
+  int checkThreads; // 0: benchmark mode
+  int batch; // instances for the batch runner, 0: benchmark mode
+  int threads; // batch runner threads, 0: all hardware threads
+  OutputFormat format;
+} BenchOptions;
+
+typedef struct BenchResult {
+  const char* path;
+  bool loaded;
+  bool pal;
+  int frames;
+  double seconds;
+  double fps;
+  double nsMean;
+  double nsP50;
+  double nsP99;
+  double nsMin;
+  double nsMax;
+  double mainCpuNs; // cpu time of the emulation thread per frame, without the ppu worker
+  bool hasStats;
+  SnesStats stats; // totals over the measured frames
+} BenchResult;
+
+static const char* regionNames[SNES_REGION_COUNT] = {"wram", "rom", "sram", "bbus", "regs", "dma", "other"};
+static const char* timeNames[SNES_TIME_COUNT] = {"cpu", "ppu", "apu", "dma"};
+
+static void printUsage(const char* name) {
+  fprintf(stderr,
+    "usage: %s [options] rom [rom...]\n"
+    "  -f, --frames N    measured frames per rom (default 1200)\n"
+    "  -w, --warmup N    frames to run before measuring (default 120)\n"
+    "      --video       fetch the framebuffer every frame (snes_setPixels)\n"
+    "      --pixel-format F\n"
+    "                    fetch it at its actual size instead (snes_setPixelsFormat),\n"
+    "                    F is xrgb8888, xbgr8888, rgb565 or rgb555\n"
+    "      --audio       fetch the audio samples every frame (snes_setSamples)\n"
+    "      --stats       report per-frame core counters (needs a core built with SNES_STATS=1)\n"
+    "      --frame-skip N\n"
+    "                    render one frame, then skip N (video is only fetched for rendered frames)\n"
+    "      --ppu-thread  render the ppu lines on a worker thread; with --check-threads, the\n"
+    "                    concurrent instances use it and are checked against inline rendering\n"
+    "      --check-timing\n"
+    "                    run each rom with and without the idle loop and bus debt shortcuts\n"
+    "                    (snes_setExactTiming), comparing the cpu, master cycle, video, audio\n"
+    "                    and wram after every frame\n"
+    "      --format F    output format: text, json or csv (default text)\n"
+    "      --check-threads N\n"
+    "                    run N instances concurrently (roms assigned round-robin) and compare\n"
+    "                    every frame (video, audio, wram) against a single-threaded run\n"
+    "      --batch N     run N instances (roms assigned round-robin) on the batch runner and\n"
+    "                    report the aggregate frame rate\n"
+    "      --threads N   batch runner threads (default: one per hardware thread)\n",
+    name
+  );
+}
+
+static uint8_t* readFile(const char* name, int* length) {
+  FILE* f = fopen(name, "rb");
+  if(f == NULL) return NULL;
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  rewind(f);
+  uint8_t* buffer = (uint8_t*)malloc(size > 0 ? size : 1);
+  if(size <= 0 || fread(buffer, size, 1, f) != 1) {
+    free(buffer);
+    fclose(f);
+    return NULL;
+  }
+  fclose(f);
+  *length = (int)size;
+  return buffer;
+}
+
+static int silenceStdout(void) {
+  // the core logs rom info to stdout on load, keep it out of the (possibly machine-readable) output
+  fflush(stdout);
+  int savedStdout = dup(fileno(stdout));
+  int devNull = open("/dev/null", O_WRONLY);
+  if(savedStdout >= 0 && devNull >= 0) dup2(devNull, fileno(stdout));
+  if(devNull >= 0) close(devNull);
+  return savedStdout;
+}
+
+static void restoreStdout(int savedStdout) {
+  fflush(stdout);
+  if(savedStdout < 0) return;
+  dup2(savedStdout, fileno(stdout));
+  close(savedStdout);
+}
+
+static bool loadRomQuiet(Snes* snes, const uint8_t* data, int length) {
+  int savedStdout = silenceStdout();
+  bool loaded = snes_loadRom(snes, data, length);
+  restoreStdout(savedStdout);
+  return loaded;
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+  // nearest-rank percentile
+  if(sorted.empty()) return 0;
+  size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.5);
+  if(rank < 1) rank = 1;
+  if(rank > sorted.size()) rank = sorted.size();
+  return sorted[rank - 1];
+}
+
+static void fetchVideo(Snes* snes, const BenchOptions* options, uint8_t* pixels) {
+  if(options->pixelFormat < 0) {
+    snes_setPixels(snes, pixels);
+    return;
+  }
+  int width, height;
+  snes_getFrameSize(snes, &width, &height);
+  int pitch = width * (options->pixelFormat <= PPU_FORMAT_XBGR8888 ? 4 : 2);
+  snes_setPixelsFormat(snes, pixels, pitch, options->pixelFormat, &width, &height);
+}
+
+static double threadCpuNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (double)ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static BenchResult runRom(const char* path, const BenchOptions* options) {
+  using namespace std::chrono;
+  BenchResult result = {};
+  result.path = path;
+  int length = 0;
+  uint8_t* data = readFile(path, &length);
+  if(data == NULL) {
+    fprintf(stderr, "Failed to read %s\n", path);
+    return result;
+  }
+  Snes* snes = snes_init();
+  result.loaded = loadRomQuiet(snes, data, length);
+  free(data);
+  if(!result.loaded) {
+    fprintf(stderr, "Failed to load %s\n", path);
+    snes_free(snes);
+    return result;
+  }
+  result.pal = snes->palTiming;
+  if(options->ppuThread) snes_setPpuThread(snes, true);
+  snes_setFrameSkip(snes, options->frameSkip);
+  const int samplesPerFrame = 48000 / (snes->palTiming ? 50 : 60);
+  std::vector<uint8_t> pixels(512 * 480 * 4);
+  std::vector<int16_t> samples(samplesPerFrame * 2);
+  // warm-up: let the game get past its boot code, and get caches and branch predictors settled
+  for(int i = 0; i < options->warmup; i++) {
+    snes_runFrame(snes);
+    if(options->audio) snes_setSamples(snes, samples.data(), samplesPerFrame);
+    if(options->video && snes_frameRendered(snes)) fetchVideo(snes, options, pixels.data());
+  }
+  snes_resetStats(snes);
+  std::vector<double> frameTimes(options->frames);
+  auto runStart = steady_clock::now();
+  double cpuStart = threadCpuNs();
+  for(int i = 0; i < options->frames; i++) {
+    auto frameStart = steady_clock::now();
+    snes_runFrame(snes);
+    if(options->audio) snes_setSamples(snes, samples.data(), samplesPerFrame);
+    if(options->video && snes_frameRendered(snes)) fetchVideo(snes, options, pixels.data());
+    frameTimes[i] = (double)duration_cast<nanoseconds>(steady_clock::now() - frameStart).count();
+  }
+  double totalNs = (double)duration_cast<nanoseconds>(steady_clock::now() - runStart).count();
+  double cpuNs = threadCpuNs() - cpuStart;
+  if(options->stats) result.hasStats = snes_getStats(snes, &result.stats);
+  snes_free(snes);
+  // statistics
+  result.frames = options->frames;
+  result.seconds = totalNs / 1e9;
+  result.fps = result.seconds > 0 ? options->frames / result.seconds : 0;
+  double sum = 0;
+  for(double t : frameTimes) sum += t;
+  result.nsMean = options->frames > 0 ? sum / options->frames : 0;
+  std::sort(frameTimes.begin(), frameTimes.end());
+  result.nsP50 = percentile(frameTimes, 50);
+  result.nsP99 = percentile(frameTimes, 99);
+  result.nsMin = frameTimes.empty() ? 0 : frameTimes.front();
+  result.nsMax = frameTimes.empty() ? 0 : frameTimes.back();
+  result.mainCpuNs = options->frames > 0 ? cpuNs / options->frames : 0;
+  return result;
+}
+
+static void runHashed(Snes* snes, int frames, std::vector<uint64_t>* hashes) {
+  const int samplesPerFrame = 48000 / (snes->palTiming ? 50 : 60);
+  std::vector<uint8_t> pixels(512 * 480 * 4);
+  std::vector<int16_t> samples(samplesPerFrame * 2);
+  hashes->resize(frames);
+  for(int i = 0; i < frames; i++) {
+    snes_runFrame(snes);
+    (*hashes)[i] = hashFrame(snes, pixels.data(), samples.data(), samplesPerFrame);
+  }
+}
+
+static int checkThreads(const std::vector<const char*>& roms, const BenchOptions* options) {
+  // reference hashes from one instance per rom, run alone
+  std::vector<uint8_t*> romData(roms.size());
+  std::vector<int> romLength(roms.size());
+  std::vector<std::vector<uint64_t>> reference(roms.size());
+  for(size_t r = 0; r < roms.size(); r++) {
+    romData[r] = readFile(roms[r], &romLength[r]);
+    if(romData[r] == NULL) {
+      fprintf(stderr, "Failed to read %s\n", roms[r]);
+      return 2;
+    }
+    Snes* snes = snes_init();
+    if(!loadRomQuiet(snes, romData[r], romLength[r])) {
+      fprintf(stderr, "Failed to load %s\n", roms[r]);
+      return 2;
+    }
+    runHashed(snes, options->frames, &reference[r]);
+    snes_free(snes);
+  }
+  // the same, with all instances running at once (loading stays serial, it redirects stdout)
+  int count = options->checkThreads;
+  std::vector<Snes*> instances(count);
+  std::vector<std::vector<uint64_t>> hashes(count);
+  for(int i = 0; i < count; i++) {
+    instances[i] = snes_init();
+    loadRomQuiet(instances[i], romData[i % roms.size()], romLength[i % roms.size()]);
+    if(options->ppuThread) snes_setPpuThread(instances[i], true);
+  }
+  std::vector<std::thread> threads;
+  for(int i = 0; i < count; i++) {
+    threads.emplace_back(runHashed, instances[i], options->frames, &hashes[i]);
+  }
+  for(std::thread& thread : threads) thread.join();
+  int failed = 0;
+  for(int i = 0; i < count; i++) {
+    const std::vector<uint64_t>& ref = reference[i % roms.size()];
+    int frame = 0;
+    while(frame < options->frames && hashes[i][frame] == ref[frame]) frame++;
+    if(frame == options->frames) {
+      printf("instance %d (%s): %d frames match\n", i, roms[i % roms.size()], options->frames);
+    } else {
+      printf("instance %d (%s): mismatch at frame %d\n", i, roms[i % roms.size()], frame);
+      failed++;
+    }
+    snes_free(instances[i]);
+  }
+  for(uint8_t* data : romData) free(data);
+  printf("%d of %d instances consistent\n", count - failed, count);
+  return failed ? 3 : 0;
+}
+
+static int checkTiming(const std::vector<const char*>& roms, const BenchOptions* options) {
+  // the shortcuts only skip over scheduler steps that would have done nothing, so both instances have to end
+  // every frame after the same opcode, on the same master cycle
+  int failed = 0;
+  for(const char* rom : roms) {
+    int length = 0;
+    uint8_t* data = readFile(rom, &length);
+    if(data == NULL) {
+      fprintf(stderr, "Failed to read %s\n", rom);
+      return 2;
+    }
+    Snes* fast = snes_init();
+    Snes* exact = snes_init();
+    bool loaded = loadRomQuiet(fast, data, length) && loadRomQuiet(exact, data, length);
+    free(data);
+    if(!loaded) {
+      fprintf(stderr, "Failed to load %s\n", rom);
+      return 2;
+    }
+    snes_setExactTiming(exact, true);
+    const int samplesPerFrame = 48000 / (fast->palTiming ? 50 : 60);
+    std::vector<uint8_t> pixels(512 * 480 * 4);
+    std::vector<int16_t> samples(samplesPerFrame * 2);
+    int frame = 0;
+    const char* mismatch = NULL;
+    for(; frame < options->frames && mismatch == NULL; frame++) {
+      snes_runFrame(fast);
+      snes_runFrame(exact);
+      if(!sameCpu(fast, exact)) {
+        mismatch = "cpu";
+      } else if(hashFrame(fast, pixels.data(), samples.data(), samplesPerFrame) !=
+        hashFrame(exact, pixels.data(), samples.data(), samplesPerFrame)) {
+        mismatch = "frame";
+      }
+    }
+    SnesStats stats;
+    if(mismatch != NULL) {
+      printf("%s: %s mismatch in frame %d, at %02x:%04x\n", rom, mismatch, frame - 1, fast->cpu->k, fast->cpu->pc);
+      failed++;
+    } else if(snes_getStats(fast, &stats)) {
+      printf("%s: %d frames match (%llu idle loop cycles skipped, %llu bus cycles deferred)\n", rom, frame,
+        (unsigned long long)stats.idleCycles, (unsigned long long)stats.busCycles);
+    } else {
+      printf("%s: %d frames match\n", rom, frame);
+    }
+    snes_free(fast);
+    snes_free(exact);
+  }
+  return failed ? 3 : 0;
+}
+
+static int runBatch(const std::vector<const char*>& roms, const BenchOptions* options) {
+  using namespace std::chrono;
+  Batch* batch = batch_init(options->threads);
+  std::vector<BatchJob> jobs(options->batch);
+  for(int i = 0; i < options->batch; i++) {
+    const char* path = roms[i % roms.size()];
+    int length = 0;
+    uint8_t* data = readFile(path, &length);
+    int instance = -1;
+    if(data != NULL) {
+      int savedStdout = silenceStdout();
+      instance = batch_addInstance(batch, data, length);
+      restoreStdout(savedStdout);
+      free(data);
+    }
+    if(instance < 0) {
+      fprintf(stderr, "Failed to load %s\n", path);
+      batch_free(batch);
+      return 2;
+    }
+    jobs[i] = {};
+    jobs[i].instance = instance;
+    jobs[i].flags = (options->video ? BATCH_HASH_VIDEO : 0) | (options->audio ? BATCH_HASH_AUDIO : 0);
+  }
+  for(BatchJob& job : jobs) {
+    job.frames = options->warmup;
+    batch_submit(batch, &job);
+  }
+  batch_wait(batch);
+  auto start = steady_clock::now();
+  for(BatchJob& job : jobs) {
+    job.frames = options->frames;
+    batch_submit(batch, &job);
+  }
+  batch_wait(batch);
+  double seconds = (double)duration_cast<nanoseconds>(steady_clock::now() - start).count() / 1e9;
+  batch_free(batch);
+  double total = (double)options->frames * options->batch;
+  double fps = seconds > 0 ? total / seconds : 0;
+  printf("batch: %d instances, %d frames each in %.3f s, %.2f frames/s total (%.1fx real time at 60 fps)\n",
+    options->batch, options->frames, seconds, fps, fps / 60
+  );
+  return 0;
+}
+
+static void printJsonString(const char* str) {
+  putchar('"');
+  for(const char* c = str; *c; c++) {
+    if(*c == '"' || *c == '\\') {
+      printf("\\%c", *c);
+    } else if((uint8_t)*c < 0x20) {
+      printf("\\u%04x", (uint8_t)*c);
+    } else {
+      putchar(*c);
+    }
+  }
+  putchar('"');
+}
+
+static void printStatsText(const BenchResult* r) {
+  // everything as averages per measured frame
+  const SnesStats* st = &r->stats;
+  double f = r->frames;
+  printf("  cpu opcodes %.0f, runCycle %.0f, ppu lines %.1f, spc opcodes %.0f, dsp cycles %.0f, apu catch-ups %.1f\n",
+    st->cpuOpcodes / f, st->runCycles / f, st->ppuLines / f, st->spcOpcodes / f, st->dspCycles / f, st->apuCatchups / f
+  );
+  printf("  dma bytes %.1f, hdma bytes %.1f, idle loop cycles skipped %.0f, bus cycles deferred %.0f\n", st->dmaBytes / f,
+    st->hdmaBytes / f, st->idleCycles / f, st->busCycles / f);
+  printf("  reads ");
+  for(int i = 0; i < SNES_REGION_COUNT; i++) printf("%s%s %.0f", i == 0 ? "" : ", ", regionNames[i], st->reads[i] / f);
+  printf("\n  writes ");
+  for(int i = 0; i < SNES_REGION_COUNT; i++) printf("%s%s %.0f", i == 0 ? "" : ", ", regionNames[i], st->writes[i] / f);
+  printf("\n  time (ns) ");
+  for(int i = 0; i < SNES_TIME_COUNT; i++) printf("%s%s %.0f", i == 0 ? "" : ", ", timeNames[i], st->timeNs[i] / f);
+  printf("\n");
+}
+
+static void printStatsJson(const BenchResult* r) {
+  const SnesStats* st = &r->stats;
+  double f = r->frames;
+  printf(", \"stats\": {\"cpu_opcodes\": %.1f, \"run_cycles\": %.1f, \"ppu_lines\": %.1f, \"spc_opcodes\": %.1f, "
+    "\"dsp_cycles\": %.1f, \"apu_catchups\": %.1f, \"dma_bytes\": %.1f, \"hdma_bytes\": %.1f, \"idle_cycles\": %.1f, \"bus_cycles\": %.1f",
+    st->cpuOpcodes / f, st->runCycles / f, st->ppuLines / f, st->spcOpcodes / f,
+    st->dspCycles / f, st->apuCatchups / f, st->dmaBytes / f, st->hdmaBytes / f, st->idleCycles / f, st->busCycles / f
+  );
+  for(int i = 0; i < SNES_REGION_COUNT; i++) printf(", \"reads_%s\": %.1f", regionNames[i], st->reads[i] / f);
+  for(int i = 0; i < SNES_REGION_COUNT; i++) printf(", \"writes_%s\": %.1f", regionNames[i], st->writes[i] / f);
+  for(int i = 0; i < SNES_TIME_COUNT; i++) printf(", \"%s_ns\": %.1f", timeNames[i], st->timeNs[i] / f);
+  printf("}");
+}
+
+static void printResults(const std::vector<BenchResult>& results, const BenchOptions* options) {
+  switch(options->format) {
+    case OUTPUT_TEXT: {
+      for(const BenchResult& r : results) {
+        if(!r.loaded) {
+          printf("%s: failed to load\n", r.path);
+          continue;
+        }
+        printf(
+          "%s (%s): %d frames in %.3f s, %.2f fps, %.0f ns/frame (p50 %.0f, p99 %.0f, min %.0f, max %.0f), "
+          "main thread %.0f cpu ns/frame\n",
+          r.path, r.pal ? "PAL" : "NTSC", r.frames, r.seconds, r.fps, r.nsMean, r.nsP50, r.nsP99, r.nsMin, r.nsMax,
+          r.mainCpuNs
+        );
+        if(r.hasStats) printStatsText(&r);
+      }
+      break;
+    }
+    case OUTPUT_JSON: {
+      printf("{\"frames\": %d, \"warmup\": %d, \"video\": %s, \"audio\": %s, \"results\": [",
+        options->frames, options->warmup, options->video ? "true" : "false", options->audio ? "true" : "false"
+      );
+      for(size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        printf("%s\n  {\"rom\": ", i == 0 ? "" : ",");
+        printJsonString(r.path);
+        if(!r.loaded) {
+          printf(", \"loaded\": false}");
+          continue;
+        }
+        printf(
+          ", \"loaded\": true, \"region\": \"%s\", \"frames\": %d, \"seconds\": %.6f, \"fps\": %.3f, "
+          "\"ns_per_frame\": %.1f, \"p50_ns\": %.1f, \"p99_ns\": %.1f, \"min_ns\": %.1f, \"max_ns\": %.1f, "
+          "\"main_cpu_ns\": %.1f",
+          r.pal ? "PAL" : "NTSC", r.frames, r.seconds, r.fps, r.nsMean, r.nsP50, r.nsP99, r.nsMin, r.nsMax, r.mainCpuNs
+        );
+        if(r.hasStats) printStatsJson(&r);
+        printf("}");
+      }
+      printf("\n]}\n");
+      break;
+    }
+    case OUTPUT_CSV: {
+      printf("rom,loaded,region,frames,seconds,fps,ns_per_frame,p50_ns,p99_ns,min_ns,max_ns,main_cpu_ns");
+      if(options->stats) {
+        printf(",cpu_opcodes,run_cycles,ppu_lines,spc_opcodes,dsp_cycles,apu_catchups,dma_bytes,hdma_bytes,idle_cycles,bus_cycles");
+        for(int i = 0; i < SNES_REGION_COUNT; i++) printf(",reads_%s", regionNames[i]);
+        for(int i = 0; i < SNES_REGION_COUNT; i++) printf(",writes_%s", regionNames[i]);
+        for(int i = 0; i < SNES_TIME_COUNT; i++) printf(",%s_ns", timeNames[i]);
+      }
+      printf("\n");
+      for(const BenchResult& r : results) {
+        printf(
+          "%s,%d,%s,%d,%.6f,%.3f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f",
+          r.path, r.loaded, r.loaded ? (r.pal ? "PAL" : "NTSC") : "", r.frames, r.seconds, r.fps,
+          r.nsMean, r.nsP50, r.nsP99, r.nsMin, r.nsMax, r.mainCpuNs
+        );
+        if(options->stats) {
+          const SnesStats* st = &r.stats;
+          double f = r.frames > 0 ? r.frames : 1;
+          printf(",%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f",
+            st->cpuOpcodes / f, st->runCycles / f, st->ppuLines / f, st->spcOpcodes / f,
+            st->dspCycles / f, st->apuCatchups / f, st->dmaBytes / f, st->hdmaBytes / f, st->idleCycles / f, st->busCycles / f
+          );
+          for(int i = 0; i < SNES_REGION_COUNT; i++) printf(",%.1f", st->reads[i] / f);
+          for(int i = 0; i < SNES_REGION_COUNT; i++) printf(",%.1f", st->writes[i] / f);
+          for(int i = 0; i < SNES_TIME_COUNT; i++) printf(",%.1f", st->timeNs[i] / f);
+        }
+        printf("\n");
+      }
+      break;
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  BenchOptions options = {};
+  options.frames = 1200;
+  options.warmup = 120;
+  options.format = OUTPUT_TEXT;
+  options.pixelFormat = -1;
+  std::vector<const char*> roms;
+  for(int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if((!strcmp(arg, "-f") || !strcmp(arg, "--frames")) && hasValue) {
+      options.frames = atoi(argv[++i]);
+    } else if((!strcmp(arg, "-w") || !strcmp(arg, "--warmup")) && hasValue) {
+      options.warmup = atoi(argv[++i]);
+    } else if(!strcmp(arg, "--video")) {
+      options.video = true;
+    } else if(!strcmp(arg, "--pixel-format") && hasValue) {
+      static const char* names[PPU_FORMAT_COUNT] = {"xrgb8888", "xbgr8888", "rgb565", "rgb555"};
+      const char* name = argv[++i];
+      options.pixelFormat = -1;
+      for(int f = 0; f < PPU_FORMAT_COUNT; f++) {
+        if(!strcmp(name, names[f])) options.pixelFormat = f;
+      }
+      if(options.pixelFormat < 0) {
+        fprintf(stderr, "Unknown pixel format: %s\n", name);
+        return 1;
+      }
+      options.video = true;
+    } else if(!strcmp(arg, "--audio")) {
+      options.audio = true;
+    } else if(!strcmp(arg, "--stats")) {
+      options.stats = true;
+    } else if(!strcmp(arg, "--frame-skip") && hasValue) {
+      options.frameSkip = atoi(argv[++i]);
+    } else if(!strcmp(arg, "--ppu-thread")) {
+      options.ppuThread = true;
+    } else if(!strcmp(arg, "--check-timing")) {
+      options.checkTiming = true;
+    } else if(!strcmp(arg, "--batch") && hasValue) {
+      options.batch = atoi(argv[++i]);
+      if(options.batch <= 0) {
+        fprintf(stderr, "Invalid instance count: %s\n", argv[i]);
+        return 1;
+      }
+    } else if(!strcmp(arg, "--threads") && hasValue) {
+      options.threads = atoi(argv[++i]);
+    } else if(!strcmp(arg, "--check-threads") && hasValue) {
+      options.checkThreads = atoi(argv[++i]);
+      if(options.checkThreads <= 0) {
+        fprintf(stderr, "Invalid thread count: %s\n", argv[i]);
+        return 1;
+      }
+    } else if(!strcmp(arg, "--format") && hasValue) {
+      const char* format = argv[++i];
+      if(!strcmp(format, "text")) {
+        options.format = OUTPUT_TEXT;
+      } else if(!strcmp(format, "json")) {
+        options.format = OUTPUT_JSON;
+      } else if(!strcmp(format, "csv")) {
+        options.format = OUTPUT_CSV;
+      } else {
+        fprintf(stderr, "Unknown format: %s\n", format);
+        return 1;
+      }
+    } else if(!strcmp(arg, "-h") || !strcmp(arg, "--help")) {
+      printUsage(argv[0]);
+      return 0;
+    } else if(arg[0] == '-') {
+      fprintf(stderr, "Unknown option: %s\n", arg);
+      printUsage(argv[0]);
+      return 1;
+    } else {
+      roms.push_back(arg);
+    }
+  }
+  if(roms.empty() || options.frames <= 0 || options.warmup < 0) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  if(options.checkThreads > 0) return checkThreads(roms, &options);
+  if(options.checkTiming) return checkTiming(roms, &options);
+  if(options.batch > 0) return runBatch(roms, &options);
+  if(options.stats) {
+    SnesStats probe;
+    Snes* snes = snes_init();
+    if(!snes_getStats(snes, &probe)) {
+      fprintf(stderr, "Core was built without SNES_STATS, --stats ignored\n");
+      options.stats = false;
+    }
+    snes_free(snes);
+  }
+  std::vector<BenchResult> results;
+  for(const char* rom : roms) {
+    results.push_back(runRom(rom, &options));
+  }
+  printResults(results, &options);
+  for(const BenchResult& r : results) {
+    if(!r.loaded) return 2;
+  }
+  return 0;
+}
@@ -11,8 +11,6 @@
 #include <dsp.h>
 #include <statehandler.h>
 
-static uint8_t bootRom[0x40]; // algorithmically constructed
-
 static const uint8_t iplDeltas[0x40] = {
   0x18, 0x45, 0xeb, 0x61, 0x1c, 0x9a, 0xdc, 0x06, 0xa1, 0x26, 0x15, 0x07, 0x89, 0x96, 0xb8, 0xe2,
   0xf5, 0xe1, 0x1e, 0xf1, 0xeb, 0x0a, 0xd2, 0xc0, 0xf7, 0x83, 0x7e, 0x60, 0x93, 0x40, 0x15, 0x46,
@@ -36,11 +34,11 @@ static uint8_t ipl_lfsr(uint32_t posTo, int32_t arrayPos) {
   return seed;
 }
 
-static void ipl_create() {
+static void ipl_create(Apu* apu) {
   uint8_t prev = 0;
   for (int i = 0; i < 0x40; i++) {
     prev = (prev - iplDeltas[i]) & 0xff;
-    bootRom[i] = ipl_lfsr(prev, i);
+    apu->bootRom[i] = ipl_lfsr(prev, i);
     prev = iplDeltas[i];
   }
 }
@@ -50,7 +48,7 @@ Apu* apu_init(Snes* snes) {
   apu->snes = snes;
   apu->spc = spc_init(apu, apu_spcRead, apu_spcWrite, apu_spcIdle);
   apu->dsp = dsp_init(apu);
-  ipl_create();
+  ipl_create(apu);
   return apu;
 }
 
@@ -101,6 +99,7 @@ void apu_runCycles(Apu* apu) {
 
   while (apu->cycles < sync_to) {
     spc_runOpcode(apu->spc);
+    SNES_STAT_INC(apu->snes, spcOpcodes);
   }
 }
 
@@ -108,6 +107,7 @@ static void apu_cycle(Apu* apu) {
   if((apu->cycles & 0x1f) == 0) {
     // every 32 cycles
     dsp_cycle(apu->dsp);
+    SNES_STAT_INC(apu->snes, dspCycles);
   }
 
   // handle timers
@@ -161,7 +161,7 @@ uint8_t apu_read(Apu* apu, uint16_t adr) {
     }
   }
   if(apu->romReadable && adr >= 0xffc0) {
-    return bootRom[adr - 0xffc0];
+    return apu->bootRom[adr - 0xffc0];
   }
   return apu->ram[adr];
 }
@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <batch.h>
+#include <snes.h>
+
+typedef struct BatchSlot {
+  Snes* snes;
+  std::deque<BatchJob*> jobs; // waiting, front is next
+  bool scheduled; // sitting in a worker queue or running
+} BatchSlot;
+
+typedef struct BatchWorker {
+  std::mutex lock;
+  std::deque<int> ready; // instances with queued jobs, owner pops the back, thieves take the front
+  std::thread thread;
+} BatchWorker;
+
+struct Batch {
+  std::vector<BatchSlot*> slots;
+  std::vector<BatchWorker*> workers;
+  // guards slots, counters and the worker queue pushes
+  std::mutex lock;
+  std::condition_variable workAvailable;
+  std::condition_variable allDone;
+  int readyCount; // entries in the worker queues not yet claimed
+  int pending; // submitted jobs not yet done
+  int nextWorker; // round-robin target for newly scheduled instances
+  bool stopping;
+};
+
+static void batch_workerLoop(Batch* batch, int index);
+static int batch_takeReady(Batch* batch, int index);
+static void batch_runJob(Snes* snes, BatchJob* job, uint8_t* pixels, int16_t* samples);
+
+Batch* batch_init(int threads) {
+  if(threads <= 0) threads = std::thread::hardware_concurrency();
+  if(threads <= 0) threads = 1;
+  Batch* batch = new Batch();
+  batch->readyCount = 0;
+  batch->pending = 0;
+  batch->nextWorker = 0;
+  batch->stopping = false;
+  for(int i = 0; i < threads; i++) batch->workers.push_back(new BatchWorker());
+  for(int i = 0; i < threads; i++) batch->workers[i]->thread = std::thread(batch_workerLoop, batch, i);
+  return batch;
+}
+
+void batch_free(Batch* batch) {
+  batch_wait(batch);
+  {
+    std::lock_guard<std::mutex> guard(batch->lock);
+    batch->stopping = true;
+  }
+  batch->workAvailable.notify_all();
+  for(BatchWorker* worker : batch->workers) {
+    worker->thread.join();
+    delete worker;
+  }
+  for(BatchSlot* slot : batch->slots) {
+    snes_free(slot->snes);
+    delete slot;
+  }
+  delete batch;
+}
+
+int batch_addInstance(Batch* batch, const uint8_t* data, int length) {
+  Snes* snes = snes_init();
+  if(!snes_loadRom(snes, data, length)) {
+    snes_free(snes);
+    return -1;
+  }
+  BatchSlot* slot = new BatchSlot();
+  slot->snes = snes;
+  slot->scheduled = false;
+  std::lock_guard<std::mutex> guard(batch->lock);
+  batch->slots.push_back(slot);
+  return (int)batch->slots.size() - 1;
+}
+
+Snes* batch_getInstance(Batch* batch, int instance) {
+  std::lock_guard<std::mutex> guard(batch->lock);
+  if(instance < 0 || instance >= (int)batch->slots.size()) return NULL;
+  return batch->slots[instance]->snes;
+}
+
+void batch_submit(Batch* batch, BatchJob* job) {
+  job->videoHash = 0;
+  job->audioHash = 0;
+  job->done = false;
+  std::unique_lock<std::mutex> guard(batch->lock);
+  if(job->instance < 0 || job->instance >= (int)batch->slots.size()) {
+    job->done = true; // nothing to run on
+    return;
+  }
+  BatchSlot* slot = batch->slots[job->instance];
+  slot->jobs.push_back(job);
+  batch->pending++;
+  if(!slot->scheduled) {
+    // hand the instance to the next worker, idle ones steal it if that worker is busy
+    slot->scheduled = true;
+    BatchWorker* worker = batch->workers[batch->nextWorker];
+    batch->nextWorker = (batch->nextWorker + 1) % batch->workers.size();
+    {
+      std::lock_guard<std::mutex> workerGuard(worker->lock);
+      worker->ready.push_back(job->instance);
+    }
+    batch->readyCount++;
+    guard.unlock();
+    batch->workAvailable.notify_one();
+  }
+}
+
+void batch_wait(Batch* batch) {
+  std::unique_lock<std::mutex> guard(batch->lock);
+  batch->allDone.wait(guard, [batch] { return batch->pending == 0; });
+}
+
+static void batch_workerLoop(Batch* batch, int index) {
+  std::vector<uint8_t> pixels(512 * 480 * 4);
+  std::vector<int16_t> samples(48000 / 50 * 2);
+  while(true) {
+    {
+      // claim one queued instance, there is guaranteed to be one in some queue afterwards
+      std::unique_lock<std::mutex> guard(batch->lock);
+      batch->workAvailable.wait(guard, [batch] { return batch->readyCount > 0 || batch->stopping; });
+      if(batch->readyCount == 0) return;
+      batch->readyCount--;
+    }
+    int instance = batch_takeReady(batch, index);
+    BatchSlot* slot;
+    BatchJob* job;
+    {
+      std::lock_guard<std::mutex> guard(batch->lock);
+      slot = batch->slots[instance];
+      job = slot->jobs.front();
+      slot->jobs.pop_front();
+    }
+    batch_runJob(slot->snes, job, pixels.data(), samples.data());
+    bool finished = false;
+    {
+      std::lock_guard<std::mutex> guard(batch->lock);
+      job->done = true;
+      if(!slot->jobs.empty()) {
+        // keep the instance on this worker, its state is hot in this core's caches
+        BatchWorker* worker = batch->workers[index];
+        std::lock_guard<std::mutex> workerGuard(worker->lock);
+        worker->ready.push_back(instance);
+        batch->readyCount++;
+      } else {
+        slot->scheduled = false;
+      }
+      finished = --batch->pending == 0;
+    }
+    if(finished) batch->allDone.notify_all();
+  }
+}
+
+static int batch_takeReady(Batch* batch, int index) {
+  // own queue first (newest), then steal the oldest entry from the others
+  int count = batch->workers.size();
+  while(true) {
+    for(int i = 0; i < count; i++) {
+      BatchWorker* worker = batch->workers[(index + i) % count];
+      std::lock_guard<std::mutex> guard(worker->lock);
+      if(worker->ready.empty()) continue;
+      int instance;
+      if(i == 0) {
+        instance = worker->ready.back();
+        worker->ready.pop_back();
+      } else {
+        instance = worker->ready.front();
+        worker->ready.pop_front();
+      }
+      return instance;
+    }
+    std::this_thread::yield(); // a thief got to the entry we scanned for first, look again
+  }
+}
+
+static void batch_runJob(Snes* snes, BatchJob* job, uint8_t* pixels, int16_t* samples) {
+  const int samplesPerFrame = 48000 / (snes->palTiming ? 50 : 60);
+  uint64_t videoHash = SNES_HASH_INIT;
+  uint64_t audioHash = SNES_HASH_INIT;
+  int nextInput = 0;
+  for(int frame = 0; frame < job->frames; frame++) {
+    while(nextInput < job->inputCount && job->inputs[nextInput].frame <= frame) {
+      const BatchInput* input = &job->inputs[nextInput++];
+      for(int i = 0; i < 12; i++) snes_setButtonState(snes, input->player, i, (input->buttons >> i) & 1);
+    }
+    snes_runFrame(snes);
+    if(job->flags & BATCH_HASH_AUDIO) {
+      snes_setSamples(snes, samples, samplesPerFrame);
+      audioHash = snes_hash(audioHash, samples, samplesPerFrame * 2 * sizeof(int16_t));
+    }
+    if(job->flags & BATCH_HASH_VIDEO) {
+      snes_setPixels(snes, pixels);
+      videoHash = snes_hash(videoHash, pixels, 512 * 480 * 4);
+    }
+  }
+  if(job->ram != NULL) memcpy(job->ram, snes->ram, sizeof(snes->ram));
+  job->videoHash = (job->flags & BATCH_HASH_VIDEO) ? videoHash : 0;
+  job->audioHash = (job->flags & BATCH_HASH_AUDIO) ? audioHash : 0;
+}
@@ -17,6 +17,7 @@ static uint8_t cart_readExHirom(Cart* cart, uint8_t bank, uint16_t adr);
 static void cart_writeHirom(Cart* cart, uint8_t bank, uint16_t adr, uint8_t val);
 static uint8_t cart_readCX4(Cart* cart, uint8_t bank, uint16_t adr);
 static void cart_writeCX4(Cart* cart, uint8_t bank, uint16_t adr, uint8_t val);
+static uint8_t* cart_ramPage(Cart* cart, uint32_t offset);
 
 Cart* cart_init(Snes* snes) {
   Cart* cart = (Cart*)malloc(sizeof(Cart));
@@ -27,12 +28,14 @@ Cart* cart_init(Snes* snes) {
   cart->romSize = 0;
   cart->ram = NULL;
   cart->ramSize = 0;
+  cart->cx4 = NULL;
   return cart;
 }
 
 void cart_free(Cart* cart) {
   if(cart->rom != NULL) free(cart->rom);
   if(cart->ram != NULL) free(cart->ram);
+  if(cart->cx4 != NULL) cx4_free(cart->cx4);
   free(cart);
 }
 
@@ -40,8 +43,7 @@ void cart_reset(Cart* cart) {
   // do not reset ram, assumed to be battery backed
   switch (cart->type) {
     case 0x04:
-      cx4_init(cart->snes);
-      cx4_reset();
+      cx4_reset(cart->cx4);
       break;
   }
 }
@@ -66,7 +68,7 @@ void cart_handleState(Cart* cart, StateHandler* sh) {
   if(cart->ram != NULL) sh_handleByteArray(sh, cart->ram, cart->ramSize);
 
   switch(cart->type) {
-    case 4: cx4_handleState(sh); break;
+    case 4: cx4_handleState(cart->cx4, sh); break;
   }
 }
 
@@ -85,6 +87,7 @@ void cart_load(Cart* cart, int type, uint8_t* rom, int romSize, int ramSize, boo
   }
   cart->ramSize = ramSize;
   memcpy(cart->rom, rom, romSize);
+  if(type == 4 && cart->cx4 == NULL) cart->cx4 = cx4_init(cart->snes);
 }
 
 bool cart_handleBattery(Cart* cart, bool save, uint8_t* data, int* size) {
@@ -147,7 +150,7 @@ static uint8_t cart_readCX4(Cart* cart, uint8_t bank, uint16_t adr) {
   // cx4 mapper
   if((bank & 0x7f) < 0x40 && adr >= 0x6000 && adr < 0x8000) {
     // banks 00-3f and 80-bf, adr 6000-7fff
-	return cx4_read(adr);
+	return cx4_read(cart->cx4, adr);
   }
   // save ram
   if(((bank >= 0x70 && bank < 0x7e) || bank >= 0xf0) && adr < 0x8000 && cart->ramSize > 0) {
@@ -166,7 +169,7 @@ static void cart_writeCX4(Cart* cart, uint8_t bank, uint16_t adr, uint8_t val) {
   // cx4 mapper
   if((bank & 0x7f) < 0x40 && adr >= 0x6000 && adr < 0x8000) {
     // banks 00-3f and 80-bf, adr 6000-7fff
-	cx4_write(adr, val);
+	cx4_write(cart->cx4, adr, val);
   }
   // save ram
   if(((bank >= 0x70 && bank < 0x7e) || bank > 0xf0) && adr < 0x8000 && cart->ramSize > 0) {
@@ -209,3 +212,70 @@ static void cart_writeHirom(Cart* cart, uint8_t bank, uint16_t adr, uint8_t val)
     cart->ram[(((bank & 0x3f) << 13) | (adr & 0x1fff)) & (cart->ramSize - 1)] = val;
   }
 }
+
+// page mapping, mirrors the read/write functions above for whole 4K pages
+
+static uint8_t* cart_ramPage(Cart* cart, uint32_t offset) {
+  // ram smaller than a page mirrors within the page, leave that to the read/write functions
+  if(cart->ramSize < 0x1000) return NULL;
+  return &cart->ram[offset & (cart->ramSize - 1)];
+}
+
+uint8_t* cart_getReadPage(Cart* cart, uint8_t bank, uint16_t adr) {
+  switch(cart->type) {
+    case 1:
+    case 4: {
+      if(cart->type == 4 && (bank & 0x7f) < 0x40 && adr >= 0x6000 && adr < 0x8000) {
+        return NULL; // cx4 registers
+      }
+      bool ramMapped = cart->type == 4 ? adr < 0x8000 : (cart->romSize < 0x200000 || adr < 0x8000);
+      if(((bank >= 0x70 && bank < 0x7e) || bank >= 0xf0) && ramMapped && cart->ramSize > 0) {
+        return cart_ramPage(cart, ((bank & 0xf) << 15) | adr);
+      }
+      bank &= 0x7f;
+      if(adr >= 0x8000 || bank >= 0x40) {
+        return &cart->rom[((bank << 15) | (adr & 0x7fff)) & (cart->romSize - 1)];
+      }
+      return NULL;
+    }
+    case 2:
+    case 3: {
+      bool secondHalf = cart->type == 3 && bank < 0x80;
+      bank &= 0x7f;
+      if(bank < 0x40 && adr >= 0x6000 && adr < 0x8000 && cart->ramSize > 0) {
+        return cart_ramPage(cart, ((bank & 0x3f) << 13) | (adr & 0x1fff));
+      }
+      if(adr >= 0x8000 || bank >= 0x40) {
+        return &cart->rom[(((bank & 0x3f) << 16) | (secondHalf ? 0x400000 : 0) | adr) & (cart->romSize - 1)];
+      }
+      return NULL;
+    }
+  }
+  return NULL;
+}
+
+uint8_t* cart_getWritePage(Cart* cart, uint8_t bank, uint16_t adr) {
+  switch(cart->type) {
+    case 1:
+    case 4: {
+      if(cart->type == 4 && (bank & 0x7f) < 0x40 && adr >= 0x6000 && adr < 0x8000) {
+        return NULL; // cx4 registers
+      }
+      // note: bank f0 is not writable (matches cart_writeLorom/cart_writeCX4)
+      bool ramMapped = cart->type == 4 ? adr < 0x8000 : (cart->romSize < 0x200000 || adr < 0x8000);
+      if(((bank >= 0x70 && bank < 0x7e) || bank > 0xf0) && ramMapped && cart->ramSize > 0) {
+        return cart_ramPage(cart, ((bank & 0xf) << 15) | adr);
+      }
+      return NULL;
+    }
+    case 2:
+    case 3: {
+      bank &= 0x7f;
+      if(bank < 0x40 && adr >= 0x6000 && adr < 0x8000 && cart->ramSize > 0) {
+        return cart_ramPage(cart, ((bank & 0x3f) << 13) | (adr & 0x1fff));
+      }
+      return NULL;
+    }
+  }
+  return NULL;
+}
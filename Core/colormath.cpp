@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COLORMATH_X86 1
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#define COLORMATH_X86_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+#include <colormath.h>
+
+static void colormath_portable(const ColorMathLine* line, uint8_t* out, int start, int count);
+#ifdef COLORMATH_X86
+static int colormath_sse2(const ColorMathLine* line, uint8_t* out, int count);
+#endif
+#ifdef COLORMATH_X86_AVX2
+static int colormath_avx2(const ColorMathLine* line, uint8_t* out, int count);
+#endif
+
+// 5-bit channel expanded to 8 bits and scaled by brightness: ((c << 3) | (c >> 2)) * brightness / 15
+static uint8_t brightnessLut[16][32];
+
+static int colormath_init() {
+  for(int brightness = 0; brightness < 16; brightness++) {
+    for(int c = 0; c < 32; c++) {
+      brightnessLut[brightness][c] = ((c << 3) | (c >> 2)) * brightness / 15;
+    }
+  }
+  for(int kernel = COLORMATH_KERNEL_COUNT - 1; kernel > COLORMATH_PORTABLE; kernel--) {
+    if(colormath_hasKernel(kernel)) return kernel;
+  }
+  return COLORMATH_PORTABLE;
+}
+
+static const int bestKernel = colormath_init();
+
+static const char* kernelNames[COLORMATH_KERNEL_COUNT] = {"auto", "portable", "sse2", "avx2"};
+
+void colormath_renderLine(const ColorMathLine* line, uint8_t* out, int count) {
+  colormath_renderLineWith(bestKernel, line, out, count);
+}
+
+void colormath_renderLineWith(int kernel, const ColorMathLine* line, uint8_t* out, int count) {
+  // simd kernels do whole blocks, the portable one does the rest
+  int done = 0;
+  switch(kernel == COLORMATH_AUTO ? bestKernel : kernel) {
+#ifdef COLORMATH_X86
+    case COLORMATH_SSE2: done = colormath_sse2(line, out, count); break;
+#endif
+#ifdef COLORMATH_X86_AVX2
+    case COLORMATH_AVX2: done = colormath_avx2(line, out, count); break;
+#endif
+    default: break;
+  }
+  if(done < count) colormath_portable(line, out, done, count);
+}
+
+bool colormath_hasKernel(int kernel) {
+  switch(kernel) {
+    case COLORMATH_AUTO:
+    case COLORMATH_PORTABLE: return true;
+#ifdef COLORMATH_X86
+    case COLORMATH_SSE2: return true;
+#endif
+#ifdef COLORMATH_X86_AVX2
+    case COLORMATH_AVX2:
+      __builtin_cpu_init(); // also called from the static initializer of bestKernel, maybe before libgcc's
+      return __builtin_cpu_supports("avx2");
+#endif
+  }
+  return false;
+}
+
+const char* colormath_kernelName(int kernel) {
+  if(kernel < 0 || kernel >= COLORMATH_KERNEL_COUNT) return "unknown";
+  return kernelNames[kernel == COLORMATH_AUTO ? bestKernel : kernel];
+}
+
+void colormath_toXbgr(uint16_t color, int brightness, uint8_t* out) {
+  const uint8_t* lut = brightnessLut[brightness];
+  out[0] = 0;
+  out[1] = lut[(color >> 10) & 0x1f];
+  out[2] = lut[(color >> 5) & 0x1f];
+  out[3] = lut[color & 0x1f];
+}
+
+static void colormath_portable(const ColorMathLine* line, uint8_t* out, int start, int count) {
+  const uint8_t* lut = brightnessLut[line->brightness];
+  for(int x = start; x < count; x++) {
+    int color = line->clip[x] ? 0 : line->main[x];
+    int r = color & 0x1f;
+    int g = (color >> 5) & 0x1f;
+    int b = (color >> 10) & 0x1f;
+    if(line->math[x]) {
+      int other = line->sub[x];
+      if(line->subtract) {
+        r -= other & 0x1f;
+        g -= (other >> 5) & 0x1f;
+        b -= (other >> 10) & 0x1f;
+      } else {
+        r += other & 0x1f;
+        g += (other >> 5) & 0x1f;
+        b += (other >> 10) & 0x1f;
+      }
+      if(line->half[x]) {
+        r >>= 1;
+        g >>= 1;
+        b >>= 1;
+      }
+      if(r > 31) r = 31;
+      if(g > 31) g = 31;
+      if(b > 31) b = 31;
+      if(r < 0) r = 0;
+      if(g < 0) g = 0;
+      if(b < 0) b = 0;
+    }
+    int r2 = r, g2 = g, b2 = b;
+    if(line->left) {
+      r2 = line->left[x] & 0x1f;
+      g2 = (line->left[x] >> 5) & 0x1f;
+      b2 = (line->left[x] >> 10) & 0x1f;
+    }
+    uint8_t* pixel = &out[x * 8];
+    pixel[0] = 0;
+    pixel[1] = lut[b2];
+    pixel[2] = lut[g2];
+    pixel[3] = lut[r2];
+    pixel[4] = 0;
+    pixel[5] = lut[b];
+    pixel[6] = lut[g];
+    pixel[7] = lut[r];
+  }
+}
+
+#ifdef COLORMATH_X86
+
+static inline __m128i colormath_brightness128(__m128i c, __m128i brightness) {
+  // same as the lut: v / 15 == (v * 0x8889) >> 19 for all v up to 255 * 15
+  __m128i expanded = _mm_or_si128(_mm_slli_epi16(c, 3), _mm_srli_epi16(c, 2));
+  __m128i scaled = _mm_mullo_epi16(expanded, brightness);
+  return _mm_srli_epi16(_mm_mulhi_epu16(scaled, _mm_set1_epi16((short) 0x8889)), 3);
+}
+
+static inline __m128i colormath_pack128(__m128i r, __m128i g, __m128i b, bool high) {
+  // 4 pixels of 16-bit channels (low or high half) to 0, b, g, r bytes
+  __m128i lo = _mm_slli_epi16(b, 8);
+  __m128i hi = _mm_or_si128(g, _mm_slli_epi16(r, 8));
+  return high ? _mm_unpackhi_epi16(lo, hi) : _mm_unpacklo_epi16(lo, hi);
+}
+
+static int colormath_sse2(const ColorMathLine* line, uint8_t* out, int count) {
+  const __m128i mask5 = _mm_set1_epi16(0x1f);
+  const __m128i max5 = _mm_set1_epi16(31);
+  const __m128i brightness = _mm_set1_epi16(line->brightness);
+  int x = 0;
+  for(; x + 8 <= count; x += 8) {
+    // byte masks to word masks
+    __m128i clip = _mm_loadl_epi64((const __m128i*) &line->clip[x]);
+    __m128i math = _mm_loadl_epi64((const __m128i*) &line->math[x]);
+    __m128i half = _mm_loadl_epi64((const __m128i*) &line->half[x]);
+    clip = _mm_unpacklo_epi8(clip, clip);
+    math = _mm_unpacklo_epi8(math, math);
+    half = _mm_unpacklo_epi8(half, half);
+    __m128i main = _mm_andnot_si128(clip, _mm_loadu_si128((const __m128i*) &line->main[x]));
+    __m128i sub = _mm_loadu_si128((const __m128i*) &line->sub[x]);
+    __m128i result[3], left[3];
+    for(int i = 0; i < 3; i++) {
+      __m128i m = _mm_and_si128(_mm_srli_epi16(main, i * 5), mask5);
+      __m128i s = _mm_and_si128(_mm_srli_epi16(sub, i * 5), mask5);
+      // unsigned saturation does the clamp at 0, halving a clamped 0 stays 0
+      __m128i v = line->subtract ? _mm_subs_epu16(m, s) : _mm_add_epi16(m, s);
+      v = _mm_or_si128(_mm_and_si128(half, _mm_srli_epi16(v, 1)), _mm_andnot_si128(half, v));
+      v = _mm_min_epi16(v, max5);
+      result[i] = _mm_or_si128(_mm_and_si128(math, v), _mm_andnot_si128(math, m));
+    }
+    if(line->left) {
+      __m128i l = _mm_loadu_si128((const __m128i*) &line->left[x]);
+      for(int i = 0; i < 3; i++) left[i] = _mm_and_si128(_mm_srli_epi16(l, i * 5), mask5);
+    } else {
+      for(int i = 0; i < 3; i++) left[i] = result[i];
+    }
+    for(int i = 0; i < 3; i++) {
+      result[i] = colormath_brightness128(result[i], brightness);
+      left[i] = colormath_brightness128(left[i], brightness);
+    }
+    __m128i leftLo = colormath_pack128(left[0], left[1], left[2], false);
+    __m128i leftHi = colormath_pack128(left[0], left[1], left[2], true);
+    __m128i rightLo = colormath_pack128(result[0], result[1], result[2], false);
+    __m128i rightHi = colormath_pack128(result[0], result[1], result[2], true);
+    __m128i* dst = (__m128i*) &out[x * 8];
+    _mm_storeu_si128(dst + 0, _mm_unpacklo_epi32(leftLo, rightLo));
+    _mm_storeu_si128(dst + 1, _mm_unpackhi_epi32(leftLo, rightLo));
+    _mm_storeu_si128(dst + 2, _mm_unpacklo_epi32(leftHi, rightHi));
+    _mm_storeu_si128(dst + 3, _mm_unpackhi_epi32(leftHi, rightHi));
+  }
+  return x;
+}
+
+#endif
+
+#ifdef COLORMATH_X86_AVX2
+
+__attribute__((target("avx2")))
+static inline __m256i colormath_brightness256(__m256i c, __m256i lutLo, __m256i lutHi) {
+  // 32-entry lut as two 16-byte shuffles, the high byte of each word is cleared afterwards
+  __m256i high = _mm256_cmpgt_epi16(c, _mm256_set1_epi16(15));
+  __m256i lo = _mm256_shuffle_epi8(lutLo, c);
+  __m256i hi = _mm256_shuffle_epi8(lutHi, c);
+  return _mm256_and_si256(_mm256_blendv_epi8(lo, hi, high), _mm256_set1_epi16(0xff));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i colormath_pack256(__m256i r, __m256i g, __m256i b, bool high) {
+  __m256i lo = _mm256_slli_epi16(b, 8);
+  __m256i hi = _mm256_or_si256(g, _mm256_slli_epi16(r, 8));
+  return high ? _mm256_unpackhi_epi16(lo, hi) : _mm256_unpacklo_epi16(lo, hi);
+}
+
+__attribute__((target("avx2")))
+static int colormath_avx2(const ColorMathLine* line, uint8_t* out, int count) {
+  const __m256i mask5 = _mm256_set1_epi16(0x1f);
+  const __m256i max5 = _mm256_set1_epi16(31);
+  const uint8_t* lut = brightnessLut[line->brightness];
+  const __m256i lutLo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) &lut[0]));
+  const __m256i lutHi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) &lut[16]));
+  int x = 0;
+  for(; x + 16 <= count; x += 16) {
+    __m256i clip = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*) &line->clip[x]));
+    __m256i math = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*) &line->math[x]));
+    __m256i half = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*) &line->half[x]));
+    __m256i main = _mm256_andnot_si256(clip, _mm256_loadu_si256((const __m256i*) &line->main[x]));
+    __m256i sub = _mm256_loadu_si256((const __m256i*) &line->sub[x]);
+    __m256i result[3], left[3];
+    for(int i = 0; i < 3; i++) {
+      __m256i m = _mm256_and_si256(_mm256_srli_epi16(main, i * 5), mask5);
+      __m256i s = _mm256_and_si256(_mm256_srli_epi16(sub, i * 5), mask5);
+      __m256i v = line->subtract ? _mm256_subs_epu16(m, s) : _mm256_add_epi16(m, s);
+      v = _mm256_blendv_epi8(v, _mm256_srli_epi16(v, 1), half);
+      v = _mm256_min_epi16(v, max5);
+      result[i] = _mm256_blendv_epi8(m, v, math);
+    }
+    if(line->left) {
+      __m256i l = _mm256_loadu_si256((const __m256i*) &line->left[x]);
+      for(int i = 0; i < 3; i++) left[i] = _mm256_and_si256(_mm256_srli_epi16(l, i * 5), mask5);
+    } else {
+      for(int i = 0; i < 3; i++) left[i] = result[i];
+    }
+    for(int i = 0; i < 3; i++) {
+      result[i] = colormath_brightness256(result[i], lutLo, lutHi);
+      left[i] = colormath_brightness256(left[i], lutLo, lutHi);
+    }
+    // unpacks stay within 128-bit lanes (pixels 0-7 and 8-15), put the quarters back in order when storing
+    __m256i leftLo = colormath_pack256(left[0], left[1], left[2], false);
+    __m256i leftHi = colormath_pack256(left[0], left[1], left[2], true);
+    __m256i rightLo = colormath_pack256(result[0], result[1], result[2], false);
+    __m256i rightHi = colormath_pack256(result[0], result[1], result[2], true);
+    __m256i a = _mm256_unpacklo_epi32(leftLo, rightLo); // pixels 0-1, 8-9
+    __m256i b = _mm256_unpackhi_epi32(leftLo, rightLo); // 2-3, 10-11
+    __m256i c = _mm256_unpacklo_epi32(leftHi, rightHi); // 4-5, 12-13
+    __m256i d = _mm256_unpackhi_epi32(leftHi, rightHi); // 6-7, 14-15
+    __m256i* dst = (__m256i*) &out[x * 8];
+    _mm256_storeu_si256(dst + 0, _mm256_permute2x128_si256(a, b, 0x20));
+    _mm256_storeu_si256(dst + 1, _mm256_permute2x128_si256(c, d, 0x20));
+    _mm256_storeu_si256(dst + 2, _mm256_permute2x128_si256(a, b, 0x31));
+    _mm256_storeu_si256(dst + 3, _mm256_permute2x128_si256(c, d, 0x31));
+  }
+  return x;
+}
+
+#endif
@@ -19,27 +19,46 @@ static uint8_t cpu_getFlags(Cpu* cpu);
 static void cpu_setFlags(Cpu* cpu, uint8_t value);
 static void cpu_setZN(Cpu* cpu, uint16_t value, bool byte);
 static void cpu_doBranch(Cpu* cpu, bool check);
-static uint8_t cpu_pullByte(Cpu* cpu);
-static void cpu_pushByte(Cpu* cpu, uint8_t value);
-static uint16_t cpu_pullWord(Cpu* cpu, bool intCheck);
-static void cpu_pushWord(Cpu* cpu, uint16_t value, bool intCheck);
+template<bool E> static uint8_t cpu_pullByte(Cpu* cpu);
+template<bool E> static void cpu_pushByte(Cpu* cpu, uint8_t value);
+template<bool E> static uint16_t cpu_pullWord(Cpu* cpu, bool intCheck);
+template<bool E> static void cpu_pushWord(Cpu* cpu, uint16_t value, bool intCheck);
 static uint16_t cpu_readWord(Cpu* cpu, uint32_t adrl, uint32_t adrh, bool intCheck);
 static void cpu_writeWord(Cpu* cpu, uint32_t adrl, uint32_t adrh, uint16_t value, bool reversed, bool intCheck);
-static void cpu_doInterrupt(Cpu* cpu);
-static void cpu_doOpcode(Cpu* cpu, uint8_t opcode);
+template<bool E> static void cpu_doInterrupt(Cpu* cpu);
+static void cpu_updateMode(Cpu* cpu);
+static void cpu_flushDecoded(Cpu* cpu);
+static void cpu_runDecoded(Cpu* cpu);
+static void cpu_checkLoop(Cpu* cpu);
+static void cpu_forgetLoop(Cpu* cpu);
+
+// entries in the decode cache
+static const int decodedSize = 0x1000;
+// longest loop (in bytes, up to and including the branch) reported to CpuLoopHandler
+static const int idleLoopSize = 16;
 
 // addressing modes and opcode functions not declared, only used after defintions
 
-Cpu* cpu_init(void* mem, CpuReadHandler read, CpuWriteHandler write, CpuIdleHandler idle) {
+Cpu* cpu_init(void* mem, CpuReadHandler read, CpuWriteHandler write, CpuIdleHandler idle, CpuCodeHandler code, CpuFetchHandler fetch, CpuLoopHandler loop) {
   Cpu* cpu = (Cpu*)malloc(sizeof(Cpu));
   cpu->mem = mem;
   cpu->read = read;
   cpu->write = write;
   cpu->idle = idle;
+  cpu->code = code;
+  cpu->fetch = fetch;
+  cpu->loop = loop;
+  cpu->opcodes = NULL; // set from the flags by cpu_reset
+  cpu->decoded = (CpuDecoded*)malloc(decodedSize * sizeof(CpuDecoded));
+  cpu->running = NULL;
+  cpu->operandsLeft = 0;
+  cpu_flushDecoded(cpu);
+  cpu_forgetLoop(cpu);
   return cpu;
 }
 
 void cpu_free(Cpu* cpu) {
+  free(cpu->decoded);
   free(cpu);
 }
 
@@ -63,6 +82,7 @@ void cpu_reset(Cpu* cpu, bool hard) {
     cpu->mf = false;
     cpu->e = false;
     cpu->irqWanted = false;
+    cpu_updateMode(cpu);
   }
   cpu->waiting = false;
   cpu->stopped = false;
@@ -70,6 +90,8 @@ void cpu_reset(Cpu* cpu, bool hard) {
   cpu->intWanted = false;
   cpu->intDelay = false;
   cpu->resetWanted = true;
+  cpu_flushDecoded(cpu); // the memory map gets rebuilt
+  cpu_forgetLoop(cpu);
 }
 
 void cpu_handleState(Cpu* cpu, StateHandler* sh) {
@@ -79,6 +101,9 @@ void cpu_handleState(Cpu* cpu, StateHandler* sh) {
   );
   sh_handleBytes(sh, &cpu->k, &cpu->db, NULL);
   sh_handleWords(sh, &cpu->a, &cpu->x, &cpu->y, &cpu->sp, &cpu->pc, &cpu->dp, NULL);
+  cpu_updateMode(cpu);
+  cpu_flushDecoded(cpu);
+  cpu_forgetLoop(cpu);
 }
 
 void cpu_runOpcode(Cpu* cpu) {
@@ -118,10 +143,13 @@ void cpu_runOpcode(Cpu* cpu) {
   // not stopped or waiting, execute a opcode or go to interrupt
   if(cpu->intWanted) {
     cpu_read(cpu, (cpu->k << 16) | cpu->pc);
-    cpu_doInterrupt(cpu);
+    if(cpu->e) {
+      cpu_doInterrupt<true>(cpu);
+    } else {
+      cpu_doInterrupt<false>(cpu);
+    }
   } else {
-    uint8_t opcode = cpu_readOpcode(cpu);
-    cpu_doOpcode(cpu, opcode);
+    cpu_runDecoded(cpu);
   }
 }
 
@@ -159,6 +187,16 @@ static void cpu_checkInt(Cpu* cpu) {
 }
 
 static uint8_t cpu_readOpcode(Cpu* cpu) {
+  if(cpu->operandsLeft > 0) {
+    // operand of a cached opcode, same access but the value comes from the entry (unless its page got written since)
+    const CpuDecoded* entry = cpu->running;
+    if(*entry->pageWrites == entry->writes) {
+      int index = entry->length - cpu->operandsLeft--;
+      cpu->intDelay = false;
+      return cpu->fetch(cpu->mem, (cpu->k << 16) | cpu->pc++, entry->bytes[index], entry->code + index);
+    }
+    cpu->operandsLeft = 0;
+  }
   return cpu_read(cpu, (cpu->k << 16) | cpu->pc++);
 }
 
@@ -198,6 +236,7 @@ static void cpu_setFlags(Cpu* cpu, uint8_t val) {
     cpu->x &= 0xff;
     cpu->y &= 0xff;
   }
+  cpu_updateMode(cpu);
 }
 
 static void cpu_setZN(Cpu* cpu, uint16_t value, bool byte) {
@@ -217,31 +256,36 @@ static void cpu_doBranch(Cpu* cpu, bool check) {
     cpu_checkInt(cpu);
     cpu_idle(cpu); // taken branch: 1 extra cycle
     cpu->pc += (int8_t) value;
+    if((int8_t) value < 0 && (int8_t) value >= -idleLoopSize) cpu_checkLoop(cpu);
   }
 }
 
+template<bool E>
 static uint8_t cpu_pullByte(Cpu* cpu) {
   cpu->sp++;
-  if(cpu->e) cpu->sp = (cpu->sp & 0xff) | 0x100;
+  if(E) cpu->sp = (cpu->sp & 0xff) | 0x100;
   return cpu_read(cpu, cpu->sp);
 }
 
+template<bool E>
 static void cpu_pushByte(Cpu* cpu, uint8_t value) {
   cpu_write(cpu, cpu->sp, value);
   cpu->sp--;
-  if(cpu->e) cpu->sp = (cpu->sp & 0xff) | 0x100;
+  if(E) cpu->sp = (cpu->sp & 0xff) | 0x100;
 }
 
+template<bool E>
 static uint16_t cpu_pullWord(Cpu* cpu, bool intCheck) {
-  uint8_t value = cpu_pullByte(cpu);
+  uint8_t value = cpu_pullByte<E>(cpu);
   if(intCheck) cpu_checkInt(cpu);
-  return value | (cpu_pullByte(cpu) << 8);
+  return value | (cpu_pullByte<E>(cpu) << 8);
 }
 
+template<bool E>
 static void cpu_pushWord(Cpu* cpu, uint16_t value, bool intCheck) {
-  cpu_pushByte(cpu, value >> 8);
+  cpu_pushByte<E>(cpu, value >> 8);
   if(intCheck) cpu_checkInt(cpu);
-  cpu_pushByte(cpu, value & 0xff);
+  cpu_pushByte<E>(cpu, value & 0xff);
 }
 
 static uint16_t cpu_readWord(Cpu* cpu, uint32_t adrl, uint32_t adrh, bool intCheck) {
@@ -262,11 +306,12 @@ static void cpu_writeWord(Cpu* cpu, uint32_t adrl, uint32_t adrh, uint16_t value
   }
 }
 
+template<bool E>
 static void cpu_doInterrupt(Cpu* cpu) {
   cpu_idle(cpu);
-  cpu_pushByte(cpu, cpu->k);
-  cpu_pushWord(cpu, cpu->pc, false);
-  cpu_pushByte(cpu, cpu_getFlags(cpu));
+  cpu_pushByte<E>(cpu, cpu->k);
+  cpu_pushWord<E>(cpu, cpu->pc, false);
+  cpu_pushByte<E>(cpu, cpu_getFlags(cpu));
   cpu->i = true;
   cpu->d = false;
   cpu->k = 0;
@@ -293,8 +338,10 @@ static void cpu_adrImp(Cpu* cpu) {
   }
 }
 
-static uint32_t cpu_adrImm(Cpu* cpu, uint32_t* low, bool xFlag) {
-  if((xFlag && cpu->xf) || (!xFlag && cpu->mf)) {
+template<bool Byte>
+static uint32_t cpu_adrImm(Cpu* cpu, uint32_t* low) {
+  // Byte: the m or x flag that sets the size
+  if(Byte) {
     *low = (cpu->k << 16) | cpu->pc++;
     return 0;
   } else {
@@ -343,12 +390,13 @@ static uint32_t cpu_adrIdx(Cpu* cpu, uint32_t* low) {
   return ((cpu->db << 16) + pointer + 1) & 0xffffff;
 }
 
+template<bool X>
 static uint32_t cpu_adrIdy(Cpu* cpu, uint32_t* low, bool write) {
   uint8_t adr = cpu_readOpcode(cpu);
   if(cpu->dp & 0xff) cpu_idle(cpu); // dpr not 0: 1 extra cycle
   uint16_t pointer = cpu_readWord(cpu, (cpu->dp + adr) & 0xffff, (cpu->dp + adr + 1) & 0xffff, false);
   // writing opcode or x = 0 or page crossed: 1 extra cycle
-  if(write || !cpu->xf || ((pointer >> 8) != ((pointer + cpu->y) >> 8))) cpu_idle(cpu);
+  if(write || !X || ((pointer >> 8) != ((pointer + cpu->y) >> 8))) cpu_idle(cpu);
   *low = ((cpu->db << 16) + pointer + cpu->y) & 0xffffff;
   return ((cpu->db << 16) + pointer + cpu->y + 1) & 0xffffff;
 }
@@ -393,18 +441,20 @@ static uint32_t cpu_adrAbs(Cpu* cpu, uint32_t* low) {
   return ((cpu->db << 16) + adr + 1) & 0xffffff;
 }
 
+template<bool X>
 static uint32_t cpu_adrAbx(Cpu* cpu, uint32_t* low, bool write) {
   uint16_t adr = cpu_readOpcodeWord(cpu, false);
   // writing opcode or x = 0 or page crossed: 1 extra cycle
-  if(write || !cpu->xf || ((adr >> 8) != ((adr + cpu->x) >> 8))) cpu_idle(cpu);
+  if(write || !X || ((adr >> 8) != ((adr + cpu->x) >> 8))) cpu_idle(cpu);
   *low = ((cpu->db << 16) + adr + cpu->x) & 0xffffff;
   return ((cpu->db << 16) + adr + cpu->x + 1) & 0xffffff;
 }
 
+template<bool X>
 static uint32_t cpu_adrAby(Cpu* cpu, uint32_t* low, bool write) {
   uint16_t adr = cpu_readOpcodeWord(cpu, false);
   // writing opcode or x = 0 or page crossed: 1 extra cycle
-  if(write || !cpu->xf || ((adr >> 8) != ((adr + cpu->y) >> 8))) cpu_idle(cpu);
+  if(write || !X || ((adr >> 8) != ((adr + cpu->y) >> 8))) cpu_idle(cpu);
   *low = ((cpu->db << 16) + adr + cpu->y) & 0xffffff;
   return ((cpu->db << 16) + adr + cpu->y + 1) & 0xffffff;
 }
@@ -425,8 +475,9 @@ static uint32_t cpu_adrAlx(Cpu* cpu, uint32_t* low) {
 
 // opcode functions
 
+template<bool M>
 static void cpu_and(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+  if(M) {
     cpu_checkInt(cpu);
     uint8_t value = cpu_read(cpu, low);
     cpu->a = (cpu->a & 0xff00) | ((cpu->a & value) & 0xff);
@@ -434,11 +485,12 @@ static void cpu_and(Cpu* cpu, uint32_t low, uint32_t high) {
     uint16_t value = cpu_readWord(cpu, low, high, true);
     cpu->a &= value;
   }
-  cpu_setZN(cpu, cpu->a, cpu->mf);
+  cpu_setZN(cpu, cpu->a, M);
 }
 
+template<bool M>
 static void cpu_ora(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+  if(M) {
     cpu_checkInt(cpu);
     uint8_t value = cpu_read(cpu, low);
     cpu->a = (cpu->a & 0xff00) | ((cpu->a | value) & 0xff);
@@ -446,11 +498,12 @@ static void cpu_ora(Cpu* cpu, uint32_t low, uint32_t high) {
     uint16_t value = cpu_readWord(cpu, low, high, true);
     cpu->a |= value;
   }
-  cpu_setZN(cpu, cpu->a, cpu->mf);
+  cpu_setZN(cpu, cpu->a, M);
 }
 
+template<bool M>
 static void cpu_eor(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+  if(M) {
     cpu_checkInt(cpu);
     uint8_t value = cpu_read(cpu, low);
     cpu->a = (cpu->a & 0xff00) | ((cpu->a ^ value) & 0xff);
@@ -458,11 +511,12 @@ static void cpu_eor(Cpu* cpu, uint32_t low, uint32_t high) {
     uint16_t value = cpu_readWord(cpu, low, high, true);
     cpu->a ^= value;
   }
-  cpu_setZN(cpu, cpu->a, cpu->mf);
+  cpu_setZN(cpu, cpu->a, M);
 }
 
+template<bool M>
 static void cpu_adc(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+  if(M) {
     cpu_checkInt(cpu);
     uint8_t value = cpu_read(cpu, low);
     int result = 0;
@@ -496,11 +550,12 @@ static void cpu_adc(Cpu* cpu, uint32_t low, uint32_t high) {
     cpu->c = result > 0xffff;
     cpu->a = result;
   }
-  cpu_setZN(cpu, cpu->a, cpu->mf);
+  cpu_setZN(cpu, cpu->a, M);
 }
 
+template<bool M>
 static void cpu_sbc(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+  if(M) {
     cpu_checkInt(cpu);
     uint8_t value = cpu_read(cpu, low) ^ 0xff;
     int result = 0;
@@ -534,12 +589,13 @@ static void cpu_sbc(Cpu* cpu, uint32_t low, uint32_t high) {
     cpu->c = result > 0xffff;
     cpu->a = result;
   }
-  cpu_setZN(cpu, cpu->a, cpu->mf);
+  cpu_setZN(cpu, cpu->a, M);
 }
 
+template<bool M>
 static void cpu_cmp(Cpu* cpu, uint32_t low, uint32_t high) {
   int result = 0;
-  if(cpu->mf) {
+  if(M) {
     cpu_checkInt(cpu);
     uint8_t value = cpu_read(cpu, low) ^ 0xff;
     result = (cpu->a & 0xff) + value + 1;
@@ -549,12 +605,13 @@ static void cpu_cmp(Cpu* cpu, uint32_t low, uint32_t high) {
     result = cpu->a + value + 1;
     cpu->c = result > 0xffff;
   }
-  cpu_setZN(cpu, result, cpu->mf);
+  cpu_setZN(cpu, result, M);
 }
 
+template<bool X>
 static void cpu_cpx(Cpu* cpu, uint32_t low, uint32_t high) {
   int result = 0;
-  if(cpu->xf) {
+  if(X) {
     cpu_checkInt(cpu);
     uint8_t value = cpu_read(cpu, low) ^ 0xff;
     result = (cpu->x & 0xff) + value + 1;
@@ -564,12 +621,13 @@ static void cpu_cpx(Cpu* cpu, uint32_t low, uint32_t high) {
     result = cpu->x + value + 1;
     cpu->c = result > 0xffff;
   }
-  cpu_setZN(cpu, result, cpu->xf);
+  cpu_setZN(cpu, result, X);
 }
 
+template<bool X>
 static void cpu_cpy(Cpu* cpu, uint32_t low, uint32_t high) {
   int result = 0;
-  if(cpu->xf) {
+  if(X) {
     cpu_checkInt(cpu);
     uint8_t value = cpu_read(cpu, low) ^ 0xff;
     result = (cpu->y & 0xff) + value + 1;
@@ -579,11 +637,12 @@ static void cpu_cpy(Cpu* cpu, uint32_t low, uint32_t high) {
     result = cpu->y + value + 1;
     cpu->c = result > 0xffff;
   }
-  cpu_setZN(cpu, result, cpu->xf);
+  cpu_setZN(cpu, result, X);
 }
 
+template<bool M>
 static void cpu_bit(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+  if(M) {
     cpu_checkInt(cpu);
     uint8_t value = cpu_read(cpu, low);
     uint8_t result = (cpu->a & 0xff) & value;
@@ -599,38 +658,42 @@ static void cpu_bit(Cpu* cpu, uint32_t low, uint32_t high) {
   }
 }
 
+template<bool M>
 static void cpu_lda(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+  if(M) {
     cpu_checkInt(cpu);
     cpu->a = (cpu->a & 0xff00) | cpu_read(cpu, low);
   } else {
     cpu->a = cpu_readWord(cpu, low, high, true);
   }
-  cpu_setZN(cpu, cpu->a, cpu->mf);
+  cpu_setZN(cpu, cpu->a, M);
 }
 
+template<bool X>
 static void cpu_ldx(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->xf) {
+  if(X) {
     cpu_checkInt(cpu);
     cpu->x = cpu_read(cpu, low);
   } else {
     cpu->x = cpu_readWord(cpu, low, high, true);
   }
-  cpu_setZN(cpu, cpu->x, cpu->xf);
+  cpu_setZN(cpu, cpu->x, X);
 }
 
+template<bool X>
 static void cpu_ldy(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->xf) {
+  if(X) {
     cpu_checkInt(cpu);
     cpu->y = cpu_read(cpu, low);
   } else {
     cpu->y = cpu_readWord(cpu, low, high, true);
   }
-  cpu_setZN(cpu, cpu->y, cpu->xf);
+  cpu_setZN(cpu, cpu->y, X);
 }
 
+template<bool M>
 static void cpu_sta(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+  if(M) {
     cpu_checkInt(cpu);
     cpu_write(cpu, low, cpu->a);
   } else {
@@ -638,8 +701,9 @@ static void cpu_sta(Cpu* cpu, uint32_t low, uint32_t high) {
   }
 }
 
+template<bool X>
 static void cpu_stx(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->xf) {
+  if(X) {
     cpu_checkInt(cpu);
     cpu_write(cpu, low, cpu->x);
   } else {
@@ -647,8 +711,9 @@ static void cpu_stx(Cpu* cpu, uint32_t low, uint32_t high) {
   }
 }
 
+template<bool X>
 static void cpu_sty(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->xf) {
+  if(X) {
     cpu_checkInt(cpu);
     cpu_write(cpu, low, cpu->y);
   } else {
@@ -656,8 +721,9 @@ static void cpu_sty(Cpu* cpu, uint32_t low, uint32_t high) {
   }
 }
 
+template<bool M>
 static void cpu_stz(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+  if(M) {
     cpu_checkInt(cpu);
     cpu_write(cpu, low, 0);
   } else {
@@ -665,10 +731,11 @@ static void cpu_stz(Cpu* cpu, uint32_t low, uint32_t high) {
   }
 }
 
+template<bool M>
 static void cpu_ror(Cpu* cpu, uint32_t low, uint32_t high) {
   bool carry = false;
   int result = 0;
-  if(cpu->mf) {
+  if(M) {
     uint8_t value = cpu_read(cpu, low);
     cpu_idle(cpu);
     carry = value & 1;
@@ -682,13 +749,14 @@ static void cpu_ror(Cpu* cpu, uint32_t low, uint32_t high) {
     result = (value >> 1) | (cpu->c << 15);
     cpu_writeWord(cpu, low, high, result, true, true);
   }
-  cpu_setZN(cpu, result, cpu->mf);
+  cpu_setZN(cpu, result, M);
   cpu->c = carry;
 }
 
+template<bool M>
 static void cpu_rol(Cpu* cpu, uint32_t low, uint32_t high) {
   int result = 0;
-  if(cpu->mf) {
+  if(M) {
     result = (cpu_read(cpu, low) << 1) | cpu->c;
     cpu_idle(cpu);
     cpu->c = result & 0x100;
@@ -700,12 +768,13 @@ static void cpu_rol(Cpu* cpu, uint32_t low, uint32_t high) {
     cpu->c = result & 0x10000;
     cpu_writeWord(cpu, low, high, result, true, true);
   }
-  cpu_setZN(cpu, result, cpu->mf);
+  cpu_setZN(cpu, result, M);
 }
 
+template<bool M>
 static void cpu_lsr(Cpu* cpu, uint32_t low, uint32_t high) {
   int result = 0;
-  if(cpu->mf) {
+  if(M) {
     uint8_t value = cpu_read(cpu, low);
     cpu_idle(cpu);
     cpu->c = value & 1;
@@ -719,12 +788,13 @@ static void cpu_lsr(Cpu* cpu, uint32_t low, uint32_t high) {
     result = value >> 1;
     cpu_writeWord(cpu, low, high, result, true, true);
   }
-  cpu_setZN(cpu, result, cpu->mf);
+  cpu_setZN(cpu, result, M);
 }
 
+template<bool M>
 static void cpu_asl(Cpu* cpu, uint32_t low, uint32_t high) {
   int result = 0;
-  if(cpu->mf) {
+  if(M) {
     result = cpu_read(cpu, low) << 1;
     cpu_idle(cpu);
     cpu->c = result & 0x100;
@@ -736,12 +806,13 @@ static void cpu_asl(Cpu* cpu, uint32_t low, uint32_t high) {
     cpu->c = result & 0x10000;
     cpu_writeWord(cpu, low, high, result, true, true);
   }
-  cpu_setZN(cpu, result, cpu->mf);
+  cpu_setZN(cpu, result, M);
 }
 
+template<bool M>
 static void cpu_inc(Cpu* cpu, uint32_t low, uint32_t high) {
   int result = 0;
-  if(cpu->mf) {
+  if(M) {
     result = cpu_read(cpu, low) + 1;
     cpu_idle(cpu);
     cpu_checkInt(cpu);
@@ -751,12 +822,13 @@ static void cpu_inc(Cpu* cpu, uint32_t low, uint32_t high) {
     cpu_idle(cpu);
     cpu_writeWord(cpu, low, high, result, true, true);
   }
-  cpu_setZN(cpu, result, cpu->mf);
+  cpu_setZN(cpu, result, M);
 }
 
+template<bool M>
 static void cpu_dec(Cpu* cpu, uint32_t low, uint32_t high) {
   int result = 0;
-  if(cpu->mf) {
+  if(M) {
     result = cpu_read(cpu, low) - 1;
     cpu_idle(cpu);
     cpu_checkInt(cpu);
@@ -766,11 +838,12 @@ static void cpu_dec(Cpu* cpu, uint32_t low, uint32_t high) {
     cpu_idle(cpu);
     cpu_writeWord(cpu, low, high, result, true, true);
   }
-  cpu_setZN(cpu, result, cpu->mf);
+  cpu_setZN(cpu, result, M);
 }
 
+template<bool M>
 static void cpu_tsb(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+  if(M) {
     uint8_t value = cpu_read(cpu, low);
     cpu_idle(cpu);
     cpu->z = ((cpu->a & 0xff) & value) == 0;
@@ -784,8 +857,9 @@ static void cpu_tsb(Cpu* cpu, uint32_t low, uint32_t high) {
   }
 }
 
+template<bool M>
 static void cpu_trb(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+  if(M) {
     uint8_t value = cpu_read(cpu, low);
     cpu_idle(cpu);
     cpu->z = ((cpu->a & 0xff) & value) == 0;
@@ -799,1688 +873,2025 @@ static void cpu_trb(Cpu* cpu, uint32_t low, uint32_t high) {
   }
 }
 
-static void cpu_doOpcode(Cpu* cpu, uint8_t opcode) {
-  switch(opcode) {
-    case 0x00: { // brk imm(s)
-      uint32_t vector = (cpu->e) ? 0xfffe : 0xffe6;
-      cpu_readOpcode(cpu);
-      if (!cpu->e) cpu_pushByte(cpu, cpu->k);
-      cpu_pushWord(cpu, cpu->pc, false);
-      cpu_pushByte(cpu, cpu_getFlags(cpu));
-      cpu->i = true;
-      cpu->d = false;
-      cpu->k = 0;
-      cpu->pc = cpu_readWord(cpu, vector, vector + 1, true);
-      break;
-    }
-    case 0x01: { // ora idx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdx(cpu, &low);
-      cpu_ora(cpu, low, high);
-      break;
-    }
-    case 0x02: { // cop imm(s)
-      uint32_t vector = (cpu->e) ? 0xfff4 : 0xffe4;
-      cpu_readOpcode(cpu);
-      if (!cpu->e) cpu_pushByte(cpu, cpu->k);
-      cpu_pushWord(cpu, cpu->pc, false);
-      cpu_pushByte(cpu, cpu_getFlags(cpu));
-      cpu->i = true;
-      cpu->d = false;
-      cpu->k = 0;
-      cpu->pc = cpu_readWord(cpu, vector, vector + 1, true);
-      break;
-    }
-    case 0x03: { // ora sr
-      uint32_t low = 0;
-      uint32_t high = cpu_adrSr(cpu, &low);
-      cpu_ora(cpu, low, high);
-      break;
-    }
-    case 0x04: { // tsb dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_tsb(cpu, low, high);
-      break;
-    }
-    case 0x05: { // ora dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_ora(cpu, low, high);
-      break;
-    }
-    case 0x06: { // asl dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_asl(cpu, low, high);
-      break;
-    }
-    case 0x07: { // ora idl
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdl(cpu, &low);
-      cpu_ora(cpu, low, high);
-      break;
-    }
-    case 0x08: { // php imp
-      cpu_idle(cpu);
-      cpu_checkInt(cpu);
-      cpu_pushByte(cpu, cpu_getFlags(cpu));
-      break;
-    }
-    case 0x09: { // ora imm(m)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, false);
-      cpu_ora(cpu, low, high);
-      break;
-    }
-    case 0x0a: { // asla imp
-      cpu_adrImp(cpu);
-      if(cpu->mf) {
-        cpu->c = cpu->a & 0x80;
-        cpu->a = (cpu->a & 0xff00) | ((cpu->a << 1) & 0xff);
-      } else {
-        cpu->c = cpu->a & 0x8000;
-        cpu->a <<= 1;
-      }
-      cpu_setZN(cpu, cpu->a, cpu->mf);
-      break;
-    }
-    case 0x0b: { // phd imp
-      cpu_idle(cpu);
-      cpu_pushWord(cpu, cpu->dp, true);
-      break;
-    }
-    case 0x0c: { // tsb abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_tsb(cpu, low, high);
-      break;
-    }
-    case 0x0d: { // ora abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_ora(cpu, low, high);
-      break;
-    }
-    case 0x0e: { // asl abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_asl(cpu, low, high);
-      break;
-    }
-    case 0x0f: { // ora abl
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbl(cpu, &low);
-      cpu_ora(cpu, low, high);
-      break;
-    }
-    case 0x10: { // bpl rel
-      cpu_doBranch(cpu, !cpu->n);
-      break;
-    }
-    case 0x11: { // ora idy(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdy(cpu, &low, false);
-      cpu_ora(cpu, low, high);
-      break;
-    }
-    case 0x12: { // ora idp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdp(cpu, &low);
-      cpu_ora(cpu, low, high);
-      break;
-    }
-    case 0x13: { // ora isy
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIsy(cpu, &low);
-      cpu_ora(cpu, low, high);
-      break;
-    }
-    case 0x14: { // trb dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_trb(cpu, low, high);
-      break;
-    }
-    case 0x15: { // ora dpx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_ora(cpu, low, high);
-      break;
-    }
-    case 0x16: { // asl dpx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_asl(cpu, low, high);
-      break;
-    }
-    case 0x17: { // ora ily
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIly(cpu, &low);
-      cpu_ora(cpu, low, high);
-      break;
-    }
-    case 0x18: { // clc imp
-      cpu_adrImp(cpu);
-      cpu->c = false;
-      break;
-    }
-    case 0x19: { // ora aby(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAby(cpu, &low, false);
-      cpu_ora(cpu, low, high);
-      break;
-    }
-    case 0x1a: { // inca imp
-      cpu_adrImp(cpu);
-      if(cpu->mf) {
-        cpu->a = (cpu->a & 0xff00) | ((cpu->a + 1) & 0xff);
-      } else {
-        cpu->a++;
-      }
-      cpu_setZN(cpu, cpu->a, cpu->mf);
-      break;
-    }
-    case 0x1b: { // tcs imp
-      cpu_adrImp(cpu);
-      cpu->sp = (cpu->e) ? (cpu->a & 0xff) | 0x100 : cpu->a;
-      break;
-    }
-    case 0x1c: { // trb abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_trb(cpu, low, high);
-      break;
-    }
-    case 0x1d: { // ora abx(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, false);
-      cpu_ora(cpu, low, high);
-      break;
-    }
-    case 0x1e: { // asl abx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, true);
-      cpu_asl(cpu, low, high);
-      break;
-    }
-    case 0x1f: { // ora alx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAlx(cpu, &low);
-      cpu_ora(cpu, low, high);
-      break;
-    }
-    case 0x20: { // jsr abs
-      uint16_t value = cpu_readOpcodeWord(cpu, false);
-      cpu_idle(cpu);
-      cpu_pushWord(cpu, cpu->pc - 1, true);
-      cpu->pc = value;
-      break;
-    }
-    case 0x21: { // and idx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdx(cpu, &low);
-      cpu_and(cpu, low, high);
-      break;
-    }
-    case 0x22: { // jsl abl
-      uint16_t value = cpu_readOpcodeWord(cpu, false);
-      cpu_pushByte(cpu, cpu->k);
-      cpu_idle(cpu);
-      uint8_t newK = cpu_readOpcode(cpu);
-      cpu_pushWord(cpu, cpu->pc - 1, true);
-      cpu->pc = value;
-      cpu->k = newK;
-      break;
-    }
-    case 0x23: { // and sr
-      uint32_t low = 0;
-      uint32_t high = cpu_adrSr(cpu, &low);
-      cpu_and(cpu, low, high);
-      break;
-    }
-    case 0x24: { // bit dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_bit(cpu, low, high);
-      break;
-    }
-    case 0x25: { // and dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_and(cpu, low, high);
-      break;
-    }
-    case 0x26: { // rol dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_rol(cpu, low, high);
-      break;
-    }
-    case 0x27: { // and idl
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdl(cpu, &low);
-      cpu_and(cpu, low, high);
-      break;
-    }
-    case 0x28: { // plp imp
-      cpu_idle(cpu);
-      cpu_idle(cpu);
-      cpu_checkInt(cpu);
-      cpu_setFlags(cpu, cpu_pullByte(cpu));
-      break;
-    }
-    case 0x29: { // and imm(m)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, false);
-      cpu_and(cpu, low, high);
-      break;
-    }
-    case 0x2a: { // rola imp
-      cpu_adrImp(cpu);
-      int result = (cpu->a << 1) | cpu->c;
-      if(cpu->mf) {
-        cpu->c = result & 0x100;
-        cpu->a = (cpu->a & 0xff00) | (result & 0xff);
-      } else {
-        cpu->c = result & 0x10000;
-        cpu->a = result;
-      }
-      cpu_setZN(cpu, cpu->a, cpu->mf);
-      break;
-    }
-    case 0x2b: { // pld imp
-      cpu_idle(cpu);
-      cpu_idle(cpu);
-      cpu->dp = cpu_pullWord(cpu, true);
-      cpu_setZN(cpu, cpu->dp, false);
-      break;
-    }
-    case 0x2c: { // bit abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_bit(cpu, low, high);
-      break;
-    }
-    case 0x2d: { // and abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_and(cpu, low, high);
-      break;
-    }
-    case 0x2e: { // rol abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_rol(cpu, low, high);
-      break;
-    }
-    case 0x2f: { // and abl
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbl(cpu, &low);
-      cpu_and(cpu, low, high);
-      break;
-    }
-    case 0x30: { // bmi rel
-      cpu_doBranch(cpu, cpu->n);
-      break;
-    }
-    case 0x31: { // and idy(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdy(cpu, &low, false);
-      cpu_and(cpu, low, high);
-      break;
-    }
-    case 0x32: { // and idp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdp(cpu, &low);
-      cpu_and(cpu, low, high);
-      break;
-    }
-    case 0x33: { // and isy
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIsy(cpu, &low);
-      cpu_and(cpu, low, high);
-      break;
-    }
-    case 0x34: { // bit dpx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_bit(cpu, low, high);
-      break;
-    }
-    case 0x35: { // and dpx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_and(cpu, low, high);
-      break;
-    }
-    case 0x36: { // rol dpx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_rol(cpu, low, high);
-      break;
-    }
-    case 0x37: { // and ily
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIly(cpu, &low);
-      cpu_and(cpu, low, high);
-      break;
-    }
-    case 0x38: { // sec imp
-      cpu_adrImp(cpu);
-      cpu->c = true;
-      break;
-    }
-    case 0x39: { // and aby(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAby(cpu, &low, false);
-      cpu_and(cpu, low, high);
-      break;
-    }
-    case 0x3a: { // deca imp
-      cpu_adrImp(cpu);
-      if(cpu->mf) {
-        cpu->a = (cpu->a & 0xff00) | ((cpu->a - 1) & 0xff);
-      } else {
-        cpu->a--;
-      }
-      cpu_setZN(cpu, cpu->a, cpu->mf);
-      break;
-    }
-    case 0x3b: { // tsc imp
-      cpu_adrImp(cpu);
-      cpu->a = cpu->sp;
-      cpu_setZN(cpu, cpu->a, false);
-      break;
-    }
-    case 0x3c: { // bit abx(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, false);
-      cpu_bit(cpu, low, high);
-      break;
-    }
-    case 0x3d: { // and abx(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, false);
-      cpu_and(cpu, low, high);
-      break;
-    }
-    case 0x3e: { // rol abx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, true);
-      cpu_rol(cpu, low, high);
-      break;
-    }
-    case 0x3f: { // and alx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAlx(cpu, &low);
-      cpu_and(cpu, low, high);
-      break;
-    }
-    case 0x40: { // rti imp
-      cpu_idle(cpu);
-      cpu_idle(cpu);
-      cpu_setFlags(cpu, cpu_pullByte(cpu));
-      cpu->pc = cpu_pullWord(cpu, false);
-      cpu_checkInt(cpu);
-      cpu->k = cpu_pullByte(cpu);
-      break;
-    }
-    case 0x41: { // eor idx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdx(cpu, &low);
-      cpu_eor(cpu, low, high);
-      break;
-    }
-    case 0x42: { // wdm imm(s)
-      cpu_checkInt(cpu);
-      cpu_readOpcode(cpu);
-      break;
-    }
-    case 0x43: { // eor sr
-      uint32_t low = 0;
-      uint32_t high = cpu_adrSr(cpu, &low);
-      cpu_eor(cpu, low, high);
-      break;
-    }
-    case 0x44: { // mvp bm
-      uint8_t dest = cpu_readOpcode(cpu);
-      uint8_t src = cpu_readOpcode(cpu);
-      cpu->db = dest;
-      cpu_write(cpu, (dest << 16) | cpu->y, cpu_read(cpu, (src << 16) | cpu->x));
-      cpu->a--;
-      cpu->x--;
-      cpu->y--;
-      if(cpu->a != 0xffff) {
-        cpu->pc -= 3;
-      }
-      if(cpu->xf) {
-        cpu->x &= 0xff;
-        cpu->y &= 0xff;
-      }
-      cpu_idle(cpu);
-      cpu_checkInt(cpu);
-      cpu_idle(cpu);
-      break;
-    }
-    case 0x45: { // eor dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_eor(cpu, low, high);
-      break;
-    }
-    case 0x46: { // lsr dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_lsr(cpu, low, high);
-      break;
-    }
-    case 0x47: { // eor idl
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdl(cpu, &low);
-      cpu_eor(cpu, low, high);
-      break;
-    }
-    case 0x48: { // pha imp
-      cpu_idle(cpu);
-      if(cpu->mf) {
-        cpu_checkInt(cpu);
-        cpu_pushByte(cpu, cpu->a);
-      } else {
-        cpu_pushWord(cpu, cpu->a, true);
-      }
-      break;
-    }
-    case 0x49: { // eor imm(m)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, false);
-      cpu_eor(cpu, low, high);
-      break;
-    }
-    case 0x4a: { // lsra imp
-      cpu_adrImp(cpu);
-      cpu->c = cpu->a & 1;
-      if(cpu->mf) {
-        cpu->a = (cpu->a & 0xff00) | ((cpu->a >> 1) & 0x7f);
-      } else {
-        cpu->a >>= 1;
-      }
-      cpu_setZN(cpu, cpu->a, cpu->mf);
-      break;
-    }
-    case 0x4b: { // phk imp
-      cpu_idle(cpu);
-      cpu_checkInt(cpu);
-      cpu_pushByte(cpu, cpu->k);
-      break;
-    }
-    case 0x4c: { // jmp abs
-      cpu->pc = cpu_readOpcodeWord(cpu, true);
-      break;
-    }
-    case 0x4d: { // eor abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_eor(cpu, low, high);
-      break;
-    }
-    case 0x4e: { // lsr abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_lsr(cpu, low, high);
-      break;
-    }
-    case 0x4f: { // eor abl
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbl(cpu, &low);
-      cpu_eor(cpu, low, high);
-      break;
-    }
-    case 0x50: { // bvc rel
-      cpu_doBranch(cpu, !cpu->v);
-      break;
-    }
-    case 0x51: { // eor idy(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdy(cpu, &low, false);
-      cpu_eor(cpu, low, high);
-      break;
-    }
-    case 0x52: { // eor idp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdp(cpu, &low);
-      cpu_eor(cpu, low, high);
-      break;
-    }
-    case 0x53: { // eor isy
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIsy(cpu, &low);
-      cpu_eor(cpu, low, high);
-      break;
-    }
-    case 0x54: { // mvn bm
-      uint8_t dest = cpu_readOpcode(cpu);
-      uint8_t src = cpu_readOpcode(cpu);
-      cpu->db = dest;
-      cpu_write(cpu, (dest << 16) | cpu->y, cpu_read(cpu, (src << 16) | cpu->x));
-      cpu->a--;
-      cpu->x++;
-      cpu->y++;
-      if(cpu->a != 0xffff) {
-        cpu->pc -= 3;
-      }
-      if(cpu->xf) {
-        cpu->x &= 0xff;
-        cpu->y &= 0xff;
-      }
-      cpu_idle(cpu);
-      cpu_checkInt(cpu);
-      cpu_idle(cpu);
-      break;
-    }
-    case 0x55: { // eor dpx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_eor(cpu, low, high);
-      break;
-    }
-    case 0x56: { // lsr dpx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_lsr(cpu, low, high);
-      break;
-    }
-    case 0x57: { // eor ily
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIly(cpu, &low);
-      cpu_eor(cpu, low, high);
-      break;
-    }
-    case 0x58: { // cli imp
-      cpu_adrImp(cpu);
-      cpu->i = false;
-      break;
-    }
-    case 0x59: { // eor aby(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAby(cpu, &low, false);
-      cpu_eor(cpu, low, high);
-      break;
-    }
-    case 0x5a: { // phy imp
-      cpu_idle(cpu);
-      if(cpu->xf) {
-        cpu_checkInt(cpu);
-        cpu_pushByte(cpu, cpu->y);
-      } else {
-        cpu_pushWord(cpu, cpu->y, true);
-      }
-      break;
-    }
-    case 0x5b: { // tcd imp
-      cpu_adrImp(cpu);
-      cpu->dp = cpu->a;
-      cpu_setZN(cpu, cpu->dp, false);
-      break;
-    }
-    case 0x5c: { // jml abl
-      uint16_t value = cpu_readOpcodeWord(cpu, false);
-      cpu_checkInt(cpu);
-      cpu->k = cpu_readOpcode(cpu);
-      cpu->pc = value;
-      break;
-    }
-    case 0x5d: { // eor abx(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, false);
-      cpu_eor(cpu, low, high);
-      break;
-    }
-    case 0x5e: { // lsr abx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, true);
-      cpu_lsr(cpu, low, high);
-      break;
-    }
-    case 0x5f: { // eor alx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAlx(cpu, &low);
-      cpu_eor(cpu, low, high);
-      break;
-    }
-    case 0x60: { // rts imp
-      cpu_idle(cpu);
-      cpu_idle(cpu);
-      cpu->pc = cpu_pullWord(cpu, false) + 1;
-      cpu_checkInt(cpu);
-      cpu_idle(cpu);
-      break;
-    }
-    case 0x61: { // adc idx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdx(cpu, &low);
-      cpu_adc(cpu, low, high);
-      break;
-    }
-    case 0x62: { // per rll
-      uint16_t value = cpu_readOpcodeWord(cpu, false);
-      cpu_idle(cpu);
-      cpu_pushWord(cpu, cpu->pc + (int16_t) value, true);
-      break;
-    }
-    case 0x63: { // adc sr
-      uint32_t low = 0;
-      uint32_t high = cpu_adrSr(cpu, &low);
-      cpu_adc(cpu, low, high);
-      break;
-    }
-    case 0x64: { // stz dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_stz(cpu, low, high);
-      break;
-    }
-    case 0x65: { // adc dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_adc(cpu, low, high);
-      break;
-    }
-    case 0x66: { // ror dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_ror(cpu, low, high);
-      break;
-    }
-    case 0x67: { // adc idl
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdl(cpu, &low);
-      cpu_adc(cpu, low, high);
-      break;
-    }
-    case 0x68: { // pla imp
-      cpu_idle(cpu);
-      cpu_idle(cpu);
-      if(cpu->mf) {
-        cpu_checkInt(cpu);
-        cpu->a = (cpu->a & 0xff00) | cpu_pullByte(cpu);
-      } else {
-        cpu->a = cpu_pullWord(cpu, true);
-      }
-      cpu_setZN(cpu, cpu->a, cpu->mf);
-      break;
-    }
-    case 0x69: { // adc imm(m)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, false);
-      cpu_adc(cpu, low, high);
-      break;
-    }
-    case 0x6a: { // rora imp
-      cpu_adrImp(cpu);
-      bool carry = cpu->a & 1;
-      if(cpu->mf) {
-        cpu->a = (cpu->a & 0xff00) | ((cpu->a >> 1) & 0x7f) | (cpu->c << 7);
-      } else {
-        cpu->a = (cpu->a >> 1) | (cpu->c << 15);
-      }
-      cpu->c = carry;
-      cpu_setZN(cpu, cpu->a, cpu->mf);
-      break;
-    }
-    case 0x6b: { // rtl imp
-      cpu_idle(cpu);
-      cpu_idle(cpu);
-      cpu->pc = cpu_pullWord(cpu, false) + 1;
-      cpu_checkInt(cpu);
-      cpu->k = cpu_pullByte(cpu);
-      break;
-    }
-    case 0x6c: { // jmp ind
-      uint16_t adr = cpu_readOpcodeWord(cpu, false);
-      cpu->pc = cpu_readWord(cpu, adr, (adr + 1) & 0xffff, true);
-      break;
-    }
-    case 0x6d: { // adc abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_adc(cpu, low, high);
-      break;
-    }
-    case 0x6e: { // ror abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_ror(cpu, low, high);
-      break;
-    }
-    case 0x6f: { // adc abl
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbl(cpu, &low);
-      cpu_adc(cpu, low, high);
-      break;
-    }
-    case 0x70: { // bvs rel
-      cpu_doBranch(cpu, cpu->v);
-      break;
-    }
-    case 0x71: { // adc idy(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdy(cpu, &low, false);
-      cpu_adc(cpu, low, high);
-      break;
-    }
-    case 0x72: { // adc idp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdp(cpu, &low);
-      cpu_adc(cpu, low, high);
-      break;
-    }
-    case 0x73: { // adc isy
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIsy(cpu, &low);
-      cpu_adc(cpu, low, high);
-      break;
-    }
-    case 0x74: { // stz dpx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_stz(cpu, low, high);
-      break;
-    }
-    case 0x75: { // adc dpx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_adc(cpu, low, high);
-      break;
-    }
-    case 0x76: { // ror dpx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_ror(cpu, low, high);
-      break;
-    }
-    case 0x77: { // adc ily
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIly(cpu, &low);
-      cpu_adc(cpu, low, high);
-      break;
-    }
-    case 0x78: { // sei imp
-      cpu_adrImp(cpu);
-      cpu->i = true;
-      break;
-    }
-    case 0x79: { // adc aby(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAby(cpu, &low, false);
-      cpu_adc(cpu, low, high);
-      break;
-    }
-    case 0x7a: { // ply imp
-      cpu_idle(cpu);
-      cpu_idle(cpu);
-      if(cpu->xf) {
-        cpu_checkInt(cpu);
-        cpu->y = cpu_pullByte(cpu);
-      } else {
-        cpu->y = cpu_pullWord(cpu, true);
-      }
-      cpu_setZN(cpu, cpu->y, cpu->xf);
-      break;
-    }
-    case 0x7b: { // tdc imp
-      cpu_adrImp(cpu);
-      cpu->a = cpu->dp;
-      cpu_setZN(cpu, cpu->a, false);
-      break;
-    }
-    case 0x7c: { // jmp iax
-      uint16_t adr = cpu_readOpcodeWord(cpu, false);
-      cpu_idle(cpu);
-      cpu->pc = cpu_readWord(cpu, (cpu->k << 16) | ((adr + cpu->x) & 0xffff), (cpu->k << 16) | ((adr + cpu->x + 1) & 0xffff), true);
-      break;
-    }
-    case 0x7d: { // adc abx(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, false);
-      cpu_adc(cpu, low, high);
-      break;
-    }
-    case 0x7e: { // ror abx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, true);
-      cpu_ror(cpu, low, high);
-      break;
-    }
-    case 0x7f: { // adc alx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAlx(cpu, &low);
-      cpu_adc(cpu, low, high);
-      break;
-    }
-    case 0x80: { // bra rel
-      cpu_doBranch(cpu, true);
-      break;
-    }
-    case 0x81: { // sta idx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdx(cpu, &low);
-      cpu_sta(cpu, low, high);
-      break;
-    }
-    case 0x82: { // brl rll
-      cpu->pc += (int16_t) cpu_readOpcodeWord(cpu, false);
-      cpu_checkInt(cpu);
-      cpu_idle(cpu);
-      break;
-    }
-    case 0x83: { // sta sr
-      uint32_t low = 0;
-      uint32_t high = cpu_adrSr(cpu, &low);
-      cpu_sta(cpu, low, high);
-      break;
-    }
-    case 0x84: { // sty dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_sty(cpu, low, high);
-      break;
-    }
-    case 0x85: { // sta dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_sta(cpu, low, high);
-      break;
-    }
-    case 0x86: { // stx dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_stx(cpu, low, high);
-      break;
-    }
-    case 0x87: { // sta idl
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdl(cpu, &low);
-      cpu_sta(cpu, low, high);
-      break;
-    }
-    case 0x88: { // dey imp
-      cpu_adrImp(cpu);
-      if(cpu->xf) {
-        cpu->y = (cpu->y - 1) & 0xff;
-      } else {
-        cpu->y--;
-      }
-      cpu_setZN(cpu, cpu->y, cpu->xf);
-      break;
-    }
-    case 0x89: { // biti imm(m)
-      if(cpu->mf) {
-        cpu_checkInt(cpu);
-        uint8_t result = (cpu->a & 0xff) & cpu_readOpcode(cpu);
-        cpu->z = result == 0;
-      } else {
-        uint16_t result = cpu->a & cpu_readOpcodeWord(cpu, true);
-        cpu->z = result == 0;
-      }
-      break;
-    }
-    case 0x8a: { // txa imp
-      cpu_adrImp(cpu);
-      if(cpu->mf) {
-        cpu->a = (cpu->a & 0xff00) | (cpu->x & 0xff);
-      } else {
-        cpu->a = cpu->x;
-      }
-      cpu_setZN(cpu, cpu->a, cpu->mf);
-      break;
-    }
-    case 0x8b: { // phb imp
-      cpu_idle(cpu);
-      cpu_checkInt(cpu);
-      cpu_pushByte(cpu, cpu->db);
-      break;
-    }
-    case 0x8c: { // sty abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_sty(cpu, low, high);
-      break;
-    }
-    case 0x8d: { // sta abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_sta(cpu, low, high);
-      break;
-    }
-    case 0x8e: { // stx abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_stx(cpu, low, high);
-      break;
-    }
-    case 0x8f: { // sta abl
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbl(cpu, &low);
-      cpu_sta(cpu, low, high);
-      break;
-    }
-    case 0x90: { // bcc rel
-      cpu_doBranch(cpu, !cpu->c);
-      break;
-    }
-    case 0x91: { // sta idy
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdy(cpu, &low, true);
-      cpu_sta(cpu, low, high);
-      break;
-    }
-    case 0x92: { // sta idp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdp(cpu, &low);
-      cpu_sta(cpu, low, high);
-      break;
-    }
-    case 0x93: { // sta isy
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIsy(cpu, &low);
-      cpu_sta(cpu, low, high);
-      break;
-    }
-    case 0x94: { // sty dpx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_sty(cpu, low, high);
-      break;
-    }
-    case 0x95: { // sta dpx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_sta(cpu, low, high);
-      break;
-    }
-    case 0x96: { // stx dpy
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDpy(cpu, &low);
-      cpu_stx(cpu, low, high);
-      break;
-    }
-    case 0x97: { // sta ily
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIly(cpu, &low);
-      cpu_sta(cpu, low, high);
-      break;
-    }
-    case 0x98: { // tya imp
-      cpu_adrImp(cpu);
-      if(cpu->mf) {
-        cpu->a = (cpu->a & 0xff00) | (cpu->y & 0xff);
-      } else {
-        cpu->a = cpu->y;
-      }
-      cpu_setZN(cpu, cpu->a, cpu->mf);
-      break;
-    }
-    case 0x99: { // sta aby
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAby(cpu, &low, true);
-      cpu_sta(cpu, low, high);
-      break;
-    }
-    case 0x9a: { // txs imp
-      cpu_adrImp(cpu);
-      cpu->sp = (cpu->e) ? (cpu->x & 0xff) | 0x100 : cpu->x;
-      break;
-    }
-    case 0x9b: { // txy imp
-      cpu_adrImp(cpu);
-      if(cpu->xf) {
-        cpu->y = cpu->x & 0xff;
-      } else {
-        cpu->y = cpu->x;
-      }
-      cpu_setZN(cpu, cpu->y, cpu->xf);
-      break;
-    }
-    case 0x9c: { // stz abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_stz(cpu, low, high);
-      break;
-    }
-    case 0x9d: { // sta abx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, true);
-      cpu_sta(cpu, low, high);
-      break;
-    }
-    case 0x9e: { // stz abx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, true);
-      cpu_stz(cpu, low, high);
-      break;
-    }
-    case 0x9f: { // sta alx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAlx(cpu, &low);
-      cpu_sta(cpu, low, high);
-      break;
-    }
-    case 0xa0: { // ldy imm(x)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, true);
-      cpu_ldy(cpu, low, high);
-      break;
-    }
-    case 0xa1: { // lda idx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdx(cpu, &low);
-      cpu_lda(cpu, low, high);
-      break;
-    }
-    case 0xa2: { // ldx imm(x)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, true);
-      cpu_ldx(cpu, low, high);
-      break;
-    }
-    case 0xa3: { // lda sr
-      uint32_t low = 0;
-      uint32_t high = cpu_adrSr(cpu, &low);
-      cpu_lda(cpu, low, high);
-      break;
-    }
-    case 0xa4: { // ldy dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_ldy(cpu, low, high);
-      break;
-    }
-    case 0xa5: { // lda dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_lda(cpu, low, high);
-      break;
-    }
-    case 0xa6: { // ldx dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_ldx(cpu, low, high);
-      break;
-    }
-    case 0xa7: { // lda idl
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdl(cpu, &low);
-      cpu_lda(cpu, low, high);
-      break;
-    }
-    case 0xa8: { // tay imp
-      cpu_adrImp(cpu);
-      if(cpu->xf) {
-        cpu->y = cpu->a & 0xff;
-      } else {
-        cpu->y = cpu->a;
-      }
-      cpu_setZN(cpu, cpu->y, cpu->xf);
-      break;
-    }
-    case 0xa9: { // lda imm(m)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, false);
-      cpu_lda(cpu, low, high);
-      break;
-    }
-    case 0xaa: { // tax imp
-      cpu_adrImp(cpu);
-      if(cpu->xf) {
-        cpu->x = cpu->a & 0xff;
-      } else {
-        cpu->x = cpu->a;
-      }
-      cpu_setZN(cpu, cpu->x, cpu->xf);
-      break;
-    }
-    case 0xab: { // plb imp
-      cpu_idle(cpu);
-      cpu_idle(cpu);
-      cpu_checkInt(cpu);
-      cpu->db = cpu_pullByte(cpu);
-      cpu_setZN(cpu, cpu->db, true);
-      break;
-    }
-    case 0xac: { // ldy abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_ldy(cpu, low, high);
-      break;
-    }
-    case 0xad: { // lda abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_lda(cpu, low, high);
-      break;
-    }
-    case 0xae: { // ldx abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_ldx(cpu, low, high);
-      break;
-    }
-    case 0xaf: { // lda abl
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbl(cpu, &low);
-      cpu_lda(cpu, low, high);
-      break;
-    }
-    case 0xb0: { // bcs rel
-      cpu_doBranch(cpu, cpu->c);
-      break;
-    }
-    case 0xb1: { // lda idy(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdy(cpu, &low, false);
-      cpu_lda(cpu, low, high);
-      break;
-    }
-    case 0xb2: { // lda idp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdp(cpu, &low);
-      cpu_lda(cpu, low, high);
-      break;
-    }
-    case 0xb3: { // lda isy
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIsy(cpu, &low);
-      cpu_lda(cpu, low, high);
-      break;
-    }
-    case 0xb4: { // ldy dpx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_ldy(cpu, low, high);
-      break;
-    }
-    case 0xb5: { // lda dpx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_lda(cpu, low, high);
-      break;
-    }
-    case 0xb6: { // ldx dpy
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDpy(cpu, &low);
-      cpu_ldx(cpu, low, high);
-      break;
-    }
-    case 0xb7: { // lda ily
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIly(cpu, &low);
-      cpu_lda(cpu, low, high);
-      break;
-    }
-    case 0xb8: { // clv imp
-      cpu_adrImp(cpu);
-      cpu->v = false;
-      break;
-    }
-    case 0xb9: { // lda aby(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAby(cpu, &low, false);
-      cpu_lda(cpu, low, high);
-      break;
-    }
-    case 0xba: { // tsx imp
-      cpu_adrImp(cpu);
-      if(cpu->xf) {
-        cpu->x = cpu->sp & 0xff;
-      } else {
-        cpu->x = cpu->sp;
-      }
-      cpu_setZN(cpu, cpu->x, cpu->xf);
-      break;
-    }
-    case 0xbb: { // tyx imp
-      cpu_adrImp(cpu);
-      if(cpu->xf) {
-        cpu->x = cpu->y & 0xff;
-      } else {
-        cpu->x = cpu->y;
-      }
-      cpu_setZN(cpu, cpu->x, cpu->xf);
-      break;
-    }
-    case 0xbc: { // ldy abx(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, false);
-      cpu_ldy(cpu, low, high);
-      break;
-    }
-    case 0xbd: { // lda abx(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, false);
-      cpu_lda(cpu, low, high);
-      break;
-    }
-    case 0xbe: { // ldx aby(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAby(cpu, &low, false);
-      cpu_ldx(cpu, low, high);
-      break;
-    }
-    case 0xbf: { // lda alx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAlx(cpu, &low);
-      cpu_lda(cpu, low, high);
-      break;
-    }
-    case 0xc0: { // cpy imm(x)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, true);
-      cpu_cpy(cpu, low, high);
-      break;
-    }
-    case 0xc1: { // cmp idx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdx(cpu, &low);
-      cpu_cmp(cpu, low, high);
-      break;
-    }
-    case 0xc2: { // rep imm(s)
-      uint8_t val = cpu_readOpcode(cpu);
-      cpu_checkInt(cpu);
-      cpu_setFlags(cpu, cpu_getFlags(cpu) & ~val);
-      cpu_idle(cpu);
-      break;
-    }
-    case 0xc3: { // cmp sr
-      uint32_t low = 0;
-      uint32_t high = cpu_adrSr(cpu, &low);
-      cpu_cmp(cpu, low, high);
-      break;
-    }
-    case 0xc4: { // cpy dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_cpy(cpu, low, high);
-      break;
-    }
-    case 0xc5: { // cmp dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_cmp(cpu, low, high);
-      break;
-    }
-    case 0xc6: { // dec dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_dec(cpu, low, high);
-      break;
-    }
-    case 0xc7: { // cmp idl
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdl(cpu, &low);
-      cpu_cmp(cpu, low, high);
-      break;
-    }
-    case 0xc8: { // iny imp
-      cpu_adrImp(cpu);
-      if(cpu->xf) {
-        cpu->y = (cpu->y + 1) & 0xff;
-      } else {
-        cpu->y++;
-      }
-      cpu_setZN(cpu, cpu->y, cpu->xf);
-      break;
-    }
-    case 0xc9: { // cmp imm(m)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, false);
-      cpu_cmp(cpu, low, high);
-      break;
-    }
-    case 0xca: { // dex imp
-      cpu_adrImp(cpu);
-      if(cpu->xf) {
-        cpu->x = (cpu->x - 1) & 0xff;
-      } else {
-        cpu->x--;
-      }
-      cpu_setZN(cpu, cpu->x, cpu->xf);
-      break;
-    }
-    case 0xcb: { // wai imp
-      cpu->waiting = true;
-      cpu_idle(cpu);
-      cpu_idle(cpu);
-      break;
-    }
-    case 0xcc: { // cpy abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_cpy(cpu, low, high);
-      break;
-    }
-    case 0xcd: { // cmp abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_cmp(cpu, low, high);
-      break;
-    }
-    case 0xce: { // dec abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_dec(cpu, low, high);
-      break;
-    }
-    case 0xcf: { // cmp abl
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbl(cpu, &low);
-      cpu_cmp(cpu, low, high);
-      break;
-    }
-    case 0xd0: { // bne rel
-      cpu_doBranch(cpu, !cpu->z);
-      break;
-    }
-    case 0xd1: { // cmp idy(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdy(cpu, &low, false);
-      cpu_cmp(cpu, low, high);
-      break;
-    }
-    case 0xd2: { // cmp idp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdp(cpu, &low);
-      cpu_cmp(cpu, low, high);
-      break;
-    }
-    case 0xd3: { // cmp isy
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIsy(cpu, &low);
-      cpu_cmp(cpu, low, high);
-      break;
-    }
-    case 0xd4: { // pei dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_pushWord(cpu, cpu_readWord(cpu, low, high, false), true);
-      break;
-    }
-    case 0xd5: { // cmp dpx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_cmp(cpu, low, high);
-      break;
-    }
-    case 0xd6: { // dec dpx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_dec(cpu, low, high);
-      break;
-    }
-    case 0xd7: { // cmp ily
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIly(cpu, &low);
-      cpu_cmp(cpu, low, high);
-      break;
-    }
-    case 0xd8: { // cld imp
-      cpu_adrImp(cpu);
-      cpu->d = false;
-      break;
-    }
-    case 0xd9: { // cmp aby(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAby(cpu, &low, false);
-      cpu_cmp(cpu, low, high);
-      break;
-    }
-    case 0xda: { // phx imp
-      cpu_idle(cpu);
-      if(cpu->xf) {
-        cpu_checkInt(cpu);
-        cpu_pushByte(cpu, cpu->x);
-      } else {
-        cpu_pushWord(cpu, cpu->x, true);
-      }
-      break;
-    }
-    case 0xdb: { // stp imp
-      cpu->stopped = true;
-      cpu_idle(cpu);
-      cpu_idle(cpu);
-      break;
-    }
-    case 0xdc: { // jml ial
-      uint16_t adr = cpu_readOpcodeWord(cpu, false);
-      cpu->pc = cpu_readWord(cpu, adr, (adr + 1) & 0xffff, false);
-      cpu_checkInt(cpu);
-      cpu->k = cpu_read(cpu, (adr + 2) & 0xffff);
-      break;
-    }
-    case 0xdd: { // cmp abx(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, false);
-      cpu_cmp(cpu, low, high);
-      break;
-    }
-    case 0xde: { // dec abx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, true);
-      cpu_dec(cpu, low, high);
-      break;
-    }
-    case 0xdf: { // cmp alx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAlx(cpu, &low);
-      cpu_cmp(cpu, low, high);
-      break;
-    }
-    case 0xe0: { // cpx imm(x)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, true);
-      cpu_cpx(cpu, low, high);
-      break;
-    }
-    case 0xe1: { // sbc idx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdx(cpu, &low);
-      cpu_sbc(cpu, low, high);
-      break;
-    }
-    case 0xe2: { // sep imm(s)
-      uint8_t val = cpu_readOpcode(cpu);
-      cpu_checkInt(cpu);
-      cpu_setFlags(cpu, cpu_getFlags(cpu) | val);
-      cpu_idle(cpu);
-      break;
-    }
-    case 0xe3: { // sbc sr
-      uint32_t low = 0;
-      uint32_t high = cpu_adrSr(cpu, &low);
-      cpu_sbc(cpu, low, high);
-      break;
-    }
-    case 0xe4: { // cpx dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_cpx(cpu, low, high);
-      break;
-    }
-    case 0xe5: { // sbc dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_sbc(cpu, low, high);
-      break;
-    }
-    case 0xe6: { // inc dp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_inc(cpu, low, high);
-      break;
-    }
-    case 0xe7: { // sbc idl
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdl(cpu, &low);
-      cpu_sbc(cpu, low, high);
-      break;
-    }
-    case 0xe8: { // inx imp
-      cpu_adrImp(cpu);
-      if(cpu->xf) {
-        cpu->x = (cpu->x + 1) & 0xff;
-      } else {
-        cpu->x++;
-      }
-      cpu_setZN(cpu, cpu->x, cpu->xf);
-      break;
-    }
-    case 0xe9: { // sbc imm(m)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, false);
-      cpu_sbc(cpu, low, high);
-      break;
-    }
-    case 0xea: { // nop imp
-      cpu_adrImp(cpu);
-      // no operation
-      break;
-    }
-    case 0xeb: { // xba imp
-      uint8_t low = cpu->a & 0xff;
-      uint8_t high = cpu->a >> 8;
-      cpu->a = (low << 8) | high;
-      cpu_setZN(cpu, high, true);
-      cpu_idle(cpu);
-      cpu_checkInt(cpu);
-      cpu_idle(cpu);
-      break;
-    }
-    case 0xec: { // cpx abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_cpx(cpu, low, high);
-      break;
-    }
-    case 0xed: { // sbc abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_sbc(cpu, low, high);
-      break;
-    }
-    case 0xee: { // inc abs
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_inc(cpu, low, high);
-      break;
-    }
-    case 0xef: { // sbc abl
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbl(cpu, &low);
-      cpu_sbc(cpu, low, high);
-      break;
-    }
-    case 0xf0: { // beq rel
-      cpu_doBranch(cpu, cpu->z);
-      break;
-    }
-    case 0xf1: { // sbc idy(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdy(cpu, &low, false);
-      cpu_sbc(cpu, low, high);
-      break;
-    }
-    case 0xf2: { // sbc idp
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIdp(cpu, &low);
-      cpu_sbc(cpu, low, high);
-      break;
-    }
-    case 0xf3: { // sbc isy
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIsy(cpu, &low);
-      cpu_sbc(cpu, low, high);
-      break;
-    }
-    case 0xf4: { // pea imm(l)
-      cpu_pushWord(cpu, cpu_readOpcodeWord(cpu, false), true);
-      break;
-    }
-    case 0xf5: { // sbc dpx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_sbc(cpu, low, high);
-      break;
-    }
-    case 0xf6: { // inc dpx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_inc(cpu, low, high);
-      break;
-    }
-    case 0xf7: { // sbc ily
-      uint32_t low = 0;
-      uint32_t high = cpu_adrIly(cpu, &low);
-      cpu_sbc(cpu, low, high);
-      break;
-    }
-    case 0xf8: { // sed imp
-      cpu_adrImp(cpu);
-      cpu->d = true;
-      break;
-    }
-    case 0xf9: { // sbc aby(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAby(cpu, &low, false);
-      cpu_sbc(cpu, low, high);
-      break;
-    }
-    case 0xfa: { // plx imp
-      cpu_idle(cpu);
-      cpu_idle(cpu);
-      if(cpu->xf) {
-        cpu_checkInt(cpu);
-        cpu->x = cpu_pullByte(cpu);
-      } else {
-        cpu->x = cpu_pullWord(cpu, true);
-      }
-      cpu_setZN(cpu, cpu->x, cpu->xf);
-      break;
-    }
-    case 0xfb: { // xce imp
-      cpu_adrImp(cpu);
-      bool temp = cpu->c;
-      cpu->c = cpu->e;
-      cpu->e = temp;
-      cpu_setFlags(cpu, cpu_getFlags(cpu)); // updates x and m flags, clears upper half of x and y if needed
-      break;
-    }
-    case 0xfc: { // jsr iax
-      uint8_t adrl = cpu_readOpcode(cpu);
-      cpu_pushWord(cpu, cpu->pc, false);
-      uint16_t adr = adrl | (cpu_readOpcode(cpu) << 8);
-      cpu_idle(cpu);
-      uint16_t value = cpu_readWord(cpu, (cpu->k << 16) | ((adr + cpu->x) & 0xffff), (cpu->k << 16) | ((adr + cpu->x + 1) & 0xffff), true);
-      cpu->pc = value;
-      break;
-    }
-    case 0xfd: { // sbc abx(r)
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, false);
-      cpu_sbc(cpu, low, high);
-      break;
-    }
-    case 0xfe: { // inc abx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, true);
-      cpu_inc(cpu, low, high);
-      break;
-    }
-    case 0xff: { // sbc alx
-      uint32_t low = 0;
-      uint32_t high = cpu_adrAlx(cpu, &low);
-      cpu_sbc(cpu, low, high);
-      break;
-    }
+// opcodes, templated on the flags they depend on
+
+template<bool E>
+static void cpu_op00(Cpu* cpu) { // brk imm(s)
+  uint32_t vector = (E) ? 0xfffe : 0xffe6;
+  cpu_readOpcode(cpu);
+  if (!E) cpu_pushByte<E>(cpu, cpu->k);
+  cpu_pushWord<E>(cpu, cpu->pc, false);
+  cpu_pushByte<E>(cpu, cpu_getFlags(cpu));
+  cpu->i = true;
+  cpu->d = false;
+  cpu->k = 0;
+  cpu->pc = cpu_readWord(cpu, vector, vector + 1, true);
+}
+
+template<bool M>
+static void cpu_op01(Cpu* cpu) { // ora idx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdx(cpu, &low);
+  cpu_ora<M>(cpu, low, high);
+}
+
+template<bool E>
+static void cpu_op02(Cpu* cpu) { // cop imm(s)
+  uint32_t vector = (E) ? 0xfff4 : 0xffe4;
+  cpu_readOpcode(cpu);
+  if (!E) cpu_pushByte<E>(cpu, cpu->k);
+  cpu_pushWord<E>(cpu, cpu->pc, false);
+  cpu_pushByte<E>(cpu, cpu_getFlags(cpu));
+  cpu->i = true;
+  cpu->d = false;
+  cpu->k = 0;
+  cpu->pc = cpu_readWord(cpu, vector, vector + 1, true);
+}
+
+template<bool M>
+static void cpu_op03(Cpu* cpu) { // ora sr
+  uint32_t low = 0;
+  uint32_t high = cpu_adrSr(cpu, &low);
+  cpu_ora<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op04(Cpu* cpu) { // tsb dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_tsb<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op05(Cpu* cpu) { // ora dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_ora<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op06(Cpu* cpu) { // asl dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_asl<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op07(Cpu* cpu) { // ora idl
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdl(cpu, &low);
+  cpu_ora<M>(cpu, low, high);
+}
+
+template<bool E>
+static void cpu_op08(Cpu* cpu) { // php imp
+  cpu_idle(cpu);
+  cpu_checkInt(cpu);
+  cpu_pushByte<E>(cpu, cpu_getFlags(cpu));
+}
+
+template<bool M>
+static void cpu_op09(Cpu* cpu) { // ora imm(m)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrImm<M>(cpu, &low);
+  cpu_ora<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op0a(Cpu* cpu) { // asla imp
+  cpu_adrImp(cpu);
+  if(M) {
+    cpu->c = cpu->a & 0x80;
+    cpu->a = (cpu->a & 0xff00) | ((cpu->a << 1) & 0xff);
+  } else {
+    cpu->c = cpu->a & 0x8000;
+    cpu->a <<= 1;
+  }
+  cpu_setZN(cpu, cpu->a, M);
+}
+
+template<bool E>
+static void cpu_op0b(Cpu* cpu) { // phd imp
+  cpu_idle(cpu);
+  cpu_pushWord<E>(cpu, cpu->dp, true);
+}
+
+template<bool M>
+static void cpu_op0c(Cpu* cpu) { // tsb abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_tsb<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op0d(Cpu* cpu) { // ora abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_ora<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op0e(Cpu* cpu) { // asl abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_asl<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op0f(Cpu* cpu) { // ora abl
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbl(cpu, &low);
+  cpu_ora<M>(cpu, low, high);
+}
+
+static void cpu_op10(Cpu* cpu) { // bpl rel
+  cpu_doBranch(cpu, !cpu->n);
+}
+
+template<bool M, bool X>
+static void cpu_op11(Cpu* cpu) { // ora idy(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdy<X>(cpu, &low, false);
+  cpu_ora<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op12(Cpu* cpu) { // ora idp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdp(cpu, &low);
+  cpu_ora<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op13(Cpu* cpu) { // ora isy
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIsy(cpu, &low);
+  cpu_ora<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op14(Cpu* cpu) { // trb dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_trb<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op15(Cpu* cpu) { // ora dpx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDpx(cpu, &low);
+  cpu_ora<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op16(Cpu* cpu) { // asl dpx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDpx(cpu, &low);
+  cpu_asl<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op17(Cpu* cpu) { // ora ily
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIly(cpu, &low);
+  cpu_ora<M>(cpu, low, high);
+}
+
+static void cpu_op18(Cpu* cpu) { // clc imp
+  cpu_adrImp(cpu);
+  cpu->c = false;
+}
+
+template<bool M, bool X>
+static void cpu_op19(Cpu* cpu) { // ora aby(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAby<X>(cpu, &low, false);
+  cpu_ora<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op1a(Cpu* cpu) { // inca imp
+  cpu_adrImp(cpu);
+  if(M) {
+    cpu->a = (cpu->a & 0xff00) | ((cpu->a + 1) & 0xff);
+  } else {
+    cpu->a++;
+  }
+  cpu_setZN(cpu, cpu->a, M);
+}
+
+template<bool E>
+static void cpu_op1b(Cpu* cpu) { // tcs imp
+  cpu_adrImp(cpu);
+  cpu->sp = (E) ? (cpu->a & 0xff) | 0x100 : cpu->a;
+}
+
+template<bool M>
+static void cpu_op1c(Cpu* cpu) { // trb abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_trb<M>(cpu, low, high);
+}
+
+template<bool M, bool X>
+static void cpu_op1d(Cpu* cpu) { // ora abx(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbx<X>(cpu, &low, false);
+  cpu_ora<M>(cpu, low, high);
+}
+
+template<bool M, bool X>
+static void cpu_op1e(Cpu* cpu) { // asl abx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbx<X>(cpu, &low, true);
+  cpu_asl<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op1f(Cpu* cpu) { // ora alx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAlx(cpu, &low);
+  cpu_ora<M>(cpu, low, high);
+}
+
+template<bool E>
+static void cpu_op20(Cpu* cpu) { // jsr abs
+  uint16_t value = cpu_readOpcodeWord(cpu, false);
+  cpu_idle(cpu);
+  cpu_pushWord<E>(cpu, cpu->pc - 1, true);
+  cpu->pc = value;
+}
+
+template<bool M>
+static void cpu_op21(Cpu* cpu) { // and idx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdx(cpu, &low);
+  cpu_and<M>(cpu, low, high);
+}
+
+template<bool E>
+static void cpu_op22(Cpu* cpu) { // jsl abl
+  uint16_t value = cpu_readOpcodeWord(cpu, false);
+  cpu_pushByte<E>(cpu, cpu->k);
+  cpu_idle(cpu);
+  uint8_t newK = cpu_readOpcode(cpu);
+  cpu_pushWord<E>(cpu, cpu->pc - 1, true);
+  cpu->pc = value;
+  cpu->k = newK;
+}
+
+template<bool M>
+static void cpu_op23(Cpu* cpu) { // and sr
+  uint32_t low = 0;
+  uint32_t high = cpu_adrSr(cpu, &low);
+  cpu_and<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op24(Cpu* cpu) { // bit dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_bit<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op25(Cpu* cpu) { // and dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_and<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op26(Cpu* cpu) { // rol dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_rol<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op27(Cpu* cpu) { // and idl
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdl(cpu, &low);
+  cpu_and<M>(cpu, low, high);
+}
+
+template<bool E>
+static void cpu_op28(Cpu* cpu) { // plp imp
+  cpu_idle(cpu);
+  cpu_idle(cpu);
+  cpu_checkInt(cpu);
+  cpu_setFlags(cpu, cpu_pullByte<E>(cpu));
+}
+
+template<bool M>
+static void cpu_op29(Cpu* cpu) { // and imm(m)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrImm<M>(cpu, &low);
+  cpu_and<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op2a(Cpu* cpu) { // rola imp
+  cpu_adrImp(cpu);
+  int result = (cpu->a << 1) | cpu->c;
+  if(M) {
+    cpu->c = result & 0x100;
+    cpu->a = (cpu->a & 0xff00) | (result & 0xff);
+  } else {
+    cpu->c = result & 0x10000;
+    cpu->a = result;
+  }
+  cpu_setZN(cpu, cpu->a, M);
+}
+
+template<bool E>
+static void cpu_op2b(Cpu* cpu) { // pld imp
+  cpu_idle(cpu);
+  cpu_idle(cpu);
+  cpu->dp = cpu_pullWord<E>(cpu, true);
+  cpu_setZN(cpu, cpu->dp, false);
+}
+
+template<bool M>
+static void cpu_op2c(Cpu* cpu) { // bit abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_bit<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op2d(Cpu* cpu) { // and abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_and<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op2e(Cpu* cpu) { // rol abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_rol<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op2f(Cpu* cpu) { // and abl
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbl(cpu, &low);
+  cpu_and<M>(cpu, low, high);
+}
+
+static void cpu_op30(Cpu* cpu) { // bmi rel
+  cpu_doBranch(cpu, cpu->n);
+}
+
+template<bool M, bool X>
+static void cpu_op31(Cpu* cpu) { // and idy(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdy<X>(cpu, &low, false);
+  cpu_and<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op32(Cpu* cpu) { // and idp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdp(cpu, &low);
+  cpu_and<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op33(Cpu* cpu) { // and isy
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIsy(cpu, &low);
+  cpu_and<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op34(Cpu* cpu) { // bit dpx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDpx(cpu, &low);
+  cpu_bit<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op35(Cpu* cpu) { // and dpx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDpx(cpu, &low);
+  cpu_and<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op36(Cpu* cpu) { // rol dpx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDpx(cpu, &low);
+  cpu_rol<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op37(Cpu* cpu) { // and ily
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIly(cpu, &low);
+  cpu_and<M>(cpu, low, high);
+}
+
+static void cpu_op38(Cpu* cpu) { // sec imp
+  cpu_adrImp(cpu);
+  cpu->c = true;
+}
+
+template<bool M, bool X>
+static void cpu_op39(Cpu* cpu) { // and aby(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAby<X>(cpu, &low, false);
+  cpu_and<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op3a(Cpu* cpu) { // deca imp
+  cpu_adrImp(cpu);
+  if(M) {
+    cpu->a = (cpu->a & 0xff00) | ((cpu->a - 1) & 0xff);
+  } else {
+    cpu->a--;
+  }
+  cpu_setZN(cpu, cpu->a, M);
+}
+
+static void cpu_op3b(Cpu* cpu) { // tsc imp
+  cpu_adrImp(cpu);
+  cpu->a = cpu->sp;
+  cpu_setZN(cpu, cpu->a, false);
+}
+
+template<bool M, bool X>
+static void cpu_op3c(Cpu* cpu) { // bit abx(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbx<X>(cpu, &low, false);
+  cpu_bit<M>(cpu, low, high);
+}
+
+template<bool M, bool X>
+static void cpu_op3d(Cpu* cpu) { // and abx(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbx<X>(cpu, &low, false);
+  cpu_and<M>(cpu, low, high);
+}
+
+template<bool M, bool X>
+static void cpu_op3e(Cpu* cpu) { // rol abx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbx<X>(cpu, &low, true);
+  cpu_rol<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op3f(Cpu* cpu) { // and alx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAlx(cpu, &low);
+  cpu_and<M>(cpu, low, high);
+}
+
+template<bool E>
+static void cpu_op40(Cpu* cpu) { // rti imp
+  cpu_idle(cpu);
+  cpu_idle(cpu);
+  cpu_setFlags(cpu, cpu_pullByte<E>(cpu));
+  cpu->pc = cpu_pullWord<E>(cpu, false);
+  cpu_checkInt(cpu);
+  cpu->k = cpu_pullByte<E>(cpu);
+}
+
+template<bool M>
+static void cpu_op41(Cpu* cpu) { // eor idx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdx(cpu, &low);
+  cpu_eor<M>(cpu, low, high);
+}
+
+static void cpu_op42(Cpu* cpu) { // wdm imm(s)
+  cpu_checkInt(cpu);
+  cpu_readOpcode(cpu);
+}
+
+template<bool M>
+static void cpu_op43(Cpu* cpu) { // eor sr
+  uint32_t low = 0;
+  uint32_t high = cpu_adrSr(cpu, &low);
+  cpu_eor<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_op44(Cpu* cpu) { // mvp bm
+  uint8_t dest = cpu_readOpcode(cpu);
+  uint8_t src = cpu_readOpcode(cpu);
+  cpu->db = dest;
+  cpu_write(cpu, (dest << 16) | cpu->y, cpu_read(cpu, (src << 16) | cpu->x));
+  cpu->a--;
+  cpu->x--;
+  cpu->y--;
+  if(cpu->a != 0xffff) {
+    cpu->pc -= 3;
+  }
+  if(X) {
+    cpu->x &= 0xff;
+    cpu->y &= 0xff;
+  }
+  cpu_idle(cpu);
+  cpu_checkInt(cpu);
+  cpu_idle(cpu);
+}
+
+template<bool M>
+static void cpu_op45(Cpu* cpu) { // eor dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_eor<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op46(Cpu* cpu) { // lsr dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_lsr<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op47(Cpu* cpu) { // eor idl
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdl(cpu, &low);
+  cpu_eor<M>(cpu, low, high);
+}
+
+template<bool E, bool M>
+static void cpu_op48(Cpu* cpu) { // pha imp
+  cpu_idle(cpu);
+  if(M) {
+    cpu_checkInt(cpu);
+    cpu_pushByte<E>(cpu, cpu->a);
+  } else {
+    cpu_pushWord<E>(cpu, cpu->a, true);
+  }
+}
+
+template<bool M>
+static void cpu_op49(Cpu* cpu) { // eor imm(m)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrImm<M>(cpu, &low);
+  cpu_eor<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op4a(Cpu* cpu) { // lsra imp
+  cpu_adrImp(cpu);
+  cpu->c = cpu->a & 1;
+  if(M) {
+    cpu->a = (cpu->a & 0xff00) | ((cpu->a >> 1) & 0x7f);
+  } else {
+    cpu->a >>= 1;
+  }
+  cpu_setZN(cpu, cpu->a, M);
+}
+
+template<bool E>
+static void cpu_op4b(Cpu* cpu) { // phk imp
+  cpu_idle(cpu);
+  cpu_checkInt(cpu);
+  cpu_pushByte<E>(cpu, cpu->k);
+}
+
+static void cpu_op4c(Cpu* cpu) { // jmp abs
+  cpu->pc = cpu_readOpcodeWord(cpu, true);
+}
+
+template<bool M>
+static void cpu_op4d(Cpu* cpu) { // eor abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_eor<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op4e(Cpu* cpu) { // lsr abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_lsr<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op4f(Cpu* cpu) { // eor abl
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbl(cpu, &low);
+  cpu_eor<M>(cpu, low, high);
+}
+
+static void cpu_op50(Cpu* cpu) { // bvc rel
+  cpu_doBranch(cpu, !cpu->v);
+}
+
+template<bool M, bool X>
+static void cpu_op51(Cpu* cpu) { // eor idy(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdy<X>(cpu, &low, false);
+  cpu_eor<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op52(Cpu* cpu) { // eor idp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdp(cpu, &low);
+  cpu_eor<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op53(Cpu* cpu) { // eor isy
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIsy(cpu, &low);
+  cpu_eor<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_op54(Cpu* cpu) { // mvn bm
+  uint8_t dest = cpu_readOpcode(cpu);
+  uint8_t src = cpu_readOpcode(cpu);
+  cpu->db = dest;
+  cpu_write(cpu, (dest << 16) | cpu->y, cpu_read(cpu, (src << 16) | cpu->x));
+  cpu->a--;
+  cpu->x++;
+  cpu->y++;
+  if(cpu->a != 0xffff) {
+    cpu->pc -= 3;
+  }
+  if(X) {
+    cpu->x &= 0xff;
+    cpu->y &= 0xff;
+  }
+  cpu_idle(cpu);
+  cpu_checkInt(cpu);
+  cpu_idle(cpu);
+}
+
+template<bool M>
+static void cpu_op55(Cpu* cpu) { // eor dpx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDpx(cpu, &low);
+  cpu_eor<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op56(Cpu* cpu) { // lsr dpx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDpx(cpu, &low);
+  cpu_lsr<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op57(Cpu* cpu) { // eor ily
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIly(cpu, &low);
+  cpu_eor<M>(cpu, low, high);
+}
+
+static void cpu_op58(Cpu* cpu) { // cli imp
+  cpu_adrImp(cpu);
+  cpu->i = false;
+}
+
+template<bool M, bool X>
+static void cpu_op59(Cpu* cpu) { // eor aby(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAby<X>(cpu, &low, false);
+  cpu_eor<M>(cpu, low, high);
+}
+
+template<bool E, bool X>
+static void cpu_op5a(Cpu* cpu) { // phy imp
+  cpu_idle(cpu);
+  if(X) {
+    cpu_checkInt(cpu);
+    cpu_pushByte<E>(cpu, cpu->y);
+  } else {
+    cpu_pushWord<E>(cpu, cpu->y, true);
+  }
+}
+
+static void cpu_op5b(Cpu* cpu) { // tcd imp
+  cpu_adrImp(cpu);
+  cpu->dp = cpu->a;
+  cpu_setZN(cpu, cpu->dp, false);
+}
+
+static void cpu_op5c(Cpu* cpu) { // jml abl
+  uint16_t value = cpu_readOpcodeWord(cpu, false);
+  cpu_checkInt(cpu);
+  cpu->k = cpu_readOpcode(cpu);
+  cpu->pc = value;
+}
+
+template<bool M, bool X>
+static void cpu_op5d(Cpu* cpu) { // eor abx(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbx<X>(cpu, &low, false);
+  cpu_eor<M>(cpu, low, high);
+}
+
+template<bool M, bool X>
+static void cpu_op5e(Cpu* cpu) { // lsr abx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbx<X>(cpu, &low, true);
+  cpu_lsr<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op5f(Cpu* cpu) { // eor alx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAlx(cpu, &low);
+  cpu_eor<M>(cpu, low, high);
+}
+
+template<bool E>
+static void cpu_op60(Cpu* cpu) { // rts imp
+  cpu_idle(cpu);
+  cpu_idle(cpu);
+  cpu->pc = cpu_pullWord<E>(cpu, false) + 1;
+  cpu_checkInt(cpu);
+  cpu_idle(cpu);
+}
+
+template<bool M>
+static void cpu_op61(Cpu* cpu) { // adc idx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdx(cpu, &low);
+  cpu_adc<M>(cpu, low, high);
+}
+
+template<bool E>
+static void cpu_op62(Cpu* cpu) { // per rll
+  uint16_t value = cpu_readOpcodeWord(cpu, false);
+  cpu_idle(cpu);
+  cpu_pushWord<E>(cpu, cpu->pc + (int16_t) value, true);
+}
+
+template<bool M>
+static void cpu_op63(Cpu* cpu) { // adc sr
+  uint32_t low = 0;
+  uint32_t high = cpu_adrSr(cpu, &low);
+  cpu_adc<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op64(Cpu* cpu) { // stz dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_stz<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op65(Cpu* cpu) { // adc dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_adc<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op66(Cpu* cpu) { // ror dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_ror<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op67(Cpu* cpu) { // adc idl
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdl(cpu, &low);
+  cpu_adc<M>(cpu, low, high);
+}
+
+template<bool E, bool M>
+static void cpu_op68(Cpu* cpu) { // pla imp
+  cpu_idle(cpu);
+  cpu_idle(cpu);
+  if(M) {
+    cpu_checkInt(cpu);
+    cpu->a = (cpu->a & 0xff00) | cpu_pullByte<E>(cpu);
+  } else {
+    cpu->a = cpu_pullWord<E>(cpu, true);
+  }
+  cpu_setZN(cpu, cpu->a, M);
+}
+
+template<bool M>
+static void cpu_op69(Cpu* cpu) { // adc imm(m)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrImm<M>(cpu, &low);
+  cpu_adc<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op6a(Cpu* cpu) { // rora imp
+  cpu_adrImp(cpu);
+  bool carry = cpu->a & 1;
+  if(M) {
+    cpu->a = (cpu->a & 0xff00) | ((cpu->a >> 1) & 0x7f) | (cpu->c << 7);
+  } else {
+    cpu->a = (cpu->a >> 1) | (cpu->c << 15);
+  }
+  cpu->c = carry;
+  cpu_setZN(cpu, cpu->a, M);
+}
+
+template<bool E>
+static void cpu_op6b(Cpu* cpu) { // rtl imp
+  cpu_idle(cpu);
+  cpu_idle(cpu);
+  cpu->pc = cpu_pullWord<E>(cpu, false) + 1;
+  cpu_checkInt(cpu);
+  cpu->k = cpu_pullByte<E>(cpu);
+}
+
+static void cpu_op6c(Cpu* cpu) { // jmp ind
+  uint16_t adr = cpu_readOpcodeWord(cpu, false);
+  cpu->pc = cpu_readWord(cpu, adr, (adr + 1) & 0xffff, true);
+}
+
+template<bool M>
+static void cpu_op6d(Cpu* cpu) { // adc abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_adc<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op6e(Cpu* cpu) { // ror abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_ror<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op6f(Cpu* cpu) { // adc abl
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbl(cpu, &low);
+  cpu_adc<M>(cpu, low, high);
+}
+
+static void cpu_op70(Cpu* cpu) { // bvs rel
+  cpu_doBranch(cpu, cpu->v);
+}
+
+template<bool M, bool X>
+static void cpu_op71(Cpu* cpu) { // adc idy(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdy<X>(cpu, &low, false);
+  cpu_adc<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op72(Cpu* cpu) { // adc idp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdp(cpu, &low);
+  cpu_adc<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op73(Cpu* cpu) { // adc isy
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIsy(cpu, &low);
+  cpu_adc<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op74(Cpu* cpu) { // stz dpx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDpx(cpu, &low);
+  cpu_stz<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op75(Cpu* cpu) { // adc dpx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDpx(cpu, &low);
+  cpu_adc<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op76(Cpu* cpu) { // ror dpx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDpx(cpu, &low);
+  cpu_ror<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op77(Cpu* cpu) { // adc ily
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIly(cpu, &low);
+  cpu_adc<M>(cpu, low, high);
+}
+
+static void cpu_op78(Cpu* cpu) { // sei imp
+  cpu_adrImp(cpu);
+  cpu->i = true;
+}
+
+template<bool M, bool X>
+static void cpu_op79(Cpu* cpu) { // adc aby(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAby<X>(cpu, &low, false);
+  cpu_adc<M>(cpu, low, high);
+}
+
+template<bool E, bool X>
+static void cpu_op7a(Cpu* cpu) { // ply imp
+  cpu_idle(cpu);
+  cpu_idle(cpu);
+  if(X) {
+    cpu_checkInt(cpu);
+    cpu->y = cpu_pullByte<E>(cpu);
+  } else {
+    cpu->y = cpu_pullWord<E>(cpu, true);
+  }
+  cpu_setZN(cpu, cpu->y, X);
+}
+
+static void cpu_op7b(Cpu* cpu) { // tdc imp
+  cpu_adrImp(cpu);
+  cpu->a = cpu->dp;
+  cpu_setZN(cpu, cpu->a, false);
+}
+
+static void cpu_op7c(Cpu* cpu) { // jmp iax
+  uint16_t adr = cpu_readOpcodeWord(cpu, false);
+  cpu_idle(cpu);
+  cpu->pc = cpu_readWord(cpu, (cpu->k << 16) | ((adr + cpu->x) & 0xffff), (cpu->k << 16) | ((adr + cpu->x + 1) & 0xffff), true);
+}
+
+template<bool M, bool X>
+static void cpu_op7d(Cpu* cpu) { // adc abx(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbx<X>(cpu, &low, false);
+  cpu_adc<M>(cpu, low, high);
+}
+
+template<bool M, bool X>
+static void cpu_op7e(Cpu* cpu) { // ror abx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbx<X>(cpu, &low, true);
+  cpu_ror<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op7f(Cpu* cpu) { // adc alx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAlx(cpu, &low);
+  cpu_adc<M>(cpu, low, high);
+}
+
+static void cpu_op80(Cpu* cpu) { // bra rel
+  cpu_doBranch(cpu, true);
+}
+
+template<bool M>
+static void cpu_op81(Cpu* cpu) { // sta idx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdx(cpu, &low);
+  cpu_sta<M>(cpu, low, high);
+}
+
+static void cpu_op82(Cpu* cpu) { // brl rll
+  cpu->pc += (int16_t) cpu_readOpcodeWord(cpu, false);
+  cpu_checkInt(cpu);
+  cpu_idle(cpu);
+}
+
+template<bool M>
+static void cpu_op83(Cpu* cpu) { // sta sr
+  uint32_t low = 0;
+  uint32_t high = cpu_adrSr(cpu, &low);
+  cpu_sta<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_op84(Cpu* cpu) { // sty dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_sty<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op85(Cpu* cpu) { // sta dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_sta<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_op86(Cpu* cpu) { // stx dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_stx<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op87(Cpu* cpu) { // sta idl
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdl(cpu, &low);
+  cpu_sta<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_op88(Cpu* cpu) { // dey imp
+  cpu_adrImp(cpu);
+  if(X) {
+    cpu->y = (cpu->y - 1) & 0xff;
+  } else {
+    cpu->y--;
+  }
+  cpu_setZN(cpu, cpu->y, X);
+}
+
+template<bool M>
+static void cpu_op89(Cpu* cpu) { // biti imm(m)
+  if(M) {
+    cpu_checkInt(cpu);
+    uint8_t result = (cpu->a & 0xff) & cpu_readOpcode(cpu);
+    cpu->z = result == 0;
+  } else {
+    uint16_t result = cpu->a & cpu_readOpcodeWord(cpu, true);
+    cpu->z = result == 0;
+  }
+}
+
+template<bool M>
+static void cpu_op8a(Cpu* cpu) { // txa imp
+  cpu_adrImp(cpu);
+  if(M) {
+    cpu->a = (cpu->a & 0xff00) | (cpu->x & 0xff);
+  } else {
+    cpu->a = cpu->x;
+  }
+  cpu_setZN(cpu, cpu->a, M);
+}
+
+template<bool E>
+static void cpu_op8b(Cpu* cpu) { // phb imp
+  cpu_idle(cpu);
+  cpu_checkInt(cpu);
+  cpu_pushByte<E>(cpu, cpu->db);
+}
+
+template<bool X>
+static void cpu_op8c(Cpu* cpu) { // sty abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_sty<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op8d(Cpu* cpu) { // sta abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_sta<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_op8e(Cpu* cpu) { // stx abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_stx<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op8f(Cpu* cpu) { // sta abl
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbl(cpu, &low);
+  cpu_sta<M>(cpu, low, high);
+}
+
+static void cpu_op90(Cpu* cpu) { // bcc rel
+  cpu_doBranch(cpu, !cpu->c);
+}
+
+template<bool M, bool X>
+static void cpu_op91(Cpu* cpu) { // sta idy
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdy<X>(cpu, &low, true);
+  cpu_sta<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op92(Cpu* cpu) { // sta idp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdp(cpu, &low);
+  cpu_sta<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op93(Cpu* cpu) { // sta isy
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIsy(cpu, &low);
+  cpu_sta<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_op94(Cpu* cpu) { // sty dpx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDpx(cpu, &low);
+  cpu_sty<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op95(Cpu* cpu) { // sta dpx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDpx(cpu, &low);
+  cpu_sta<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_op96(Cpu* cpu) { // stx dpy
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDpy(cpu, &low);
+  cpu_stx<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op97(Cpu* cpu) { // sta ily
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIly(cpu, &low);
+  cpu_sta<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op98(Cpu* cpu) { // tya imp
+  cpu_adrImp(cpu);
+  if(M) {
+    cpu->a = (cpu->a & 0xff00) | (cpu->y & 0xff);
+  } else {
+    cpu->a = cpu->y;
+  }
+  cpu_setZN(cpu, cpu->a, M);
+}
+
+template<bool M, bool X>
+static void cpu_op99(Cpu* cpu) { // sta aby
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAby<X>(cpu, &low, true);
+  cpu_sta<M>(cpu, low, high);
+}
+
+template<bool E>
+static void cpu_op9a(Cpu* cpu) { // txs imp
+  cpu_adrImp(cpu);
+  cpu->sp = (E) ? (cpu->x & 0xff) | 0x100 : cpu->x;
+}
+
+template<bool X>
+static void cpu_op9b(Cpu* cpu) { // txy imp
+  cpu_adrImp(cpu);
+  if(X) {
+    cpu->y = cpu->x & 0xff;
+  } else {
+    cpu->y = cpu->x;
+  }
+  cpu_setZN(cpu, cpu->y, X);
+}
+
+template<bool M>
+static void cpu_op9c(Cpu* cpu) { // stz abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_stz<M>(cpu, low, high);
+}
+
+template<bool M, bool X>
+static void cpu_op9d(Cpu* cpu) { // sta abx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbx<X>(cpu, &low, true);
+  cpu_sta<M>(cpu, low, high);
+}
+
+template<bool M, bool X>
+static void cpu_op9e(Cpu* cpu) { // stz abx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbx<X>(cpu, &low, true);
+  cpu_stz<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_op9f(Cpu* cpu) { // sta alx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAlx(cpu, &low);
+  cpu_sta<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_opa0(Cpu* cpu) { // ldy imm(x)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrImm<X>(cpu, &low);
+  cpu_ldy<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opa1(Cpu* cpu) { // lda idx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdx(cpu, &low);
+  cpu_lda<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_opa2(Cpu* cpu) { // ldx imm(x)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrImm<X>(cpu, &low);
+  cpu_ldx<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opa3(Cpu* cpu) { // lda sr
+  uint32_t low = 0;
+  uint32_t high = cpu_adrSr(cpu, &low);
+  cpu_lda<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_opa4(Cpu* cpu) { // ldy dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_ldy<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opa5(Cpu* cpu) { // lda dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_lda<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_opa6(Cpu* cpu) { // ldx dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_ldx<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opa7(Cpu* cpu) { // lda idl
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdl(cpu, &low);
+  cpu_lda<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_opa8(Cpu* cpu) { // tay imp
+  cpu_adrImp(cpu);
+  if(X) {
+    cpu->y = cpu->a & 0xff;
+  } else {
+    cpu->y = cpu->a;
+  }
+  cpu_setZN(cpu, cpu->y, X);
+}
+
+template<bool M>
+static void cpu_opa9(Cpu* cpu) { // lda imm(m)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrImm<M>(cpu, &low);
+  cpu_lda<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_opaa(Cpu* cpu) { // tax imp
+  cpu_adrImp(cpu);
+  if(X) {
+    cpu->x = cpu->a & 0xff;
+  } else {
+    cpu->x = cpu->a;
+  }
+  cpu_setZN(cpu, cpu->x, X);
+}
+
+template<bool E>
+static void cpu_opab(Cpu* cpu) { // plb imp
+  cpu_idle(cpu);
+  cpu_idle(cpu);
+  cpu_checkInt(cpu);
+  cpu->db = cpu_pullByte<E>(cpu);
+  cpu_setZN(cpu, cpu->db, true);
+}
+
+template<bool X>
+static void cpu_opac(Cpu* cpu) { // ldy abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_ldy<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opad(Cpu* cpu) { // lda abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_lda<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_opae(Cpu* cpu) { // ldx abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_ldx<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opaf(Cpu* cpu) { // lda abl
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbl(cpu, &low);
+  cpu_lda<M>(cpu, low, high);
+}
+
+static void cpu_opb0(Cpu* cpu) { // bcs rel
+  cpu_doBranch(cpu, cpu->c);
+}
+
+template<bool M, bool X>
+static void cpu_opb1(Cpu* cpu) { // lda idy(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdy<X>(cpu, &low, false);
+  cpu_lda<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opb2(Cpu* cpu) { // lda idp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdp(cpu, &low);
+  cpu_lda<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opb3(Cpu* cpu) { // lda isy
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIsy(cpu, &low);
+  cpu_lda<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_opb4(Cpu* cpu) { // ldy dpx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDpx(cpu, &low);
+  cpu_ldy<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opb5(Cpu* cpu) { // lda dpx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDpx(cpu, &low);
+  cpu_lda<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_opb6(Cpu* cpu) { // ldx dpy
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDpy(cpu, &low);
+  cpu_ldx<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opb7(Cpu* cpu) { // lda ily
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIly(cpu, &low);
+  cpu_lda<M>(cpu, low, high);
+}
+
+static void cpu_opb8(Cpu* cpu) { // clv imp
+  cpu_adrImp(cpu);
+  cpu->v = false;
+}
+
+template<bool M, bool X>
+static void cpu_opb9(Cpu* cpu) { // lda aby(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAby<X>(cpu, &low, false);
+  cpu_lda<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_opba(Cpu* cpu) { // tsx imp
+  cpu_adrImp(cpu);
+  if(X) {
+    cpu->x = cpu->sp & 0xff;
+  } else {
+    cpu->x = cpu->sp;
+  }
+  cpu_setZN(cpu, cpu->x, X);
+}
+
+template<bool X>
+static void cpu_opbb(Cpu* cpu) { // tyx imp
+  cpu_adrImp(cpu);
+  if(X) {
+    cpu->x = cpu->y & 0xff;
+  } else {
+    cpu->x = cpu->y;
+  }
+  cpu_setZN(cpu, cpu->x, X);
+}
+
+template<bool X>
+static void cpu_opbc(Cpu* cpu) { // ldy abx(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbx<X>(cpu, &low, false);
+  cpu_ldy<X>(cpu, low, high);
+}
+
+template<bool M, bool X>
+static void cpu_opbd(Cpu* cpu) { // lda abx(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbx<X>(cpu, &low, false);
+  cpu_lda<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_opbe(Cpu* cpu) { // ldx aby(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAby<X>(cpu, &low, false);
+  cpu_ldx<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opbf(Cpu* cpu) { // lda alx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAlx(cpu, &low);
+  cpu_lda<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_opc0(Cpu* cpu) { // cpy imm(x)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrImm<X>(cpu, &low);
+  cpu_cpy<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opc1(Cpu* cpu) { // cmp idx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdx(cpu, &low);
+  cpu_cmp<M>(cpu, low, high);
+}
+
+static void cpu_opc2(Cpu* cpu) { // rep imm(s)
+  uint8_t val = cpu_readOpcode(cpu);
+  cpu_checkInt(cpu);
+  cpu_setFlags(cpu, cpu_getFlags(cpu) & ~val);
+  cpu_idle(cpu);
+}
+
+template<bool M>
+static void cpu_opc3(Cpu* cpu) { // cmp sr
+  uint32_t low = 0;
+  uint32_t high = cpu_adrSr(cpu, &low);
+  cpu_cmp<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_opc4(Cpu* cpu) { // cpy dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_cpy<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opc5(Cpu* cpu) { // cmp dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_cmp<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opc6(Cpu* cpu) { // dec dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_dec<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opc7(Cpu* cpu) { // cmp idl
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdl(cpu, &low);
+  cpu_cmp<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_opc8(Cpu* cpu) { // iny imp
+  cpu_adrImp(cpu);
+  if(X) {
+    cpu->y = (cpu->y + 1) & 0xff;
+  } else {
+    cpu->y++;
+  }
+  cpu_setZN(cpu, cpu->y, X);
+}
+
+template<bool M>
+static void cpu_opc9(Cpu* cpu) { // cmp imm(m)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrImm<M>(cpu, &low);
+  cpu_cmp<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_opca(Cpu* cpu) { // dex imp
+  cpu_adrImp(cpu);
+  if(X) {
+    cpu->x = (cpu->x - 1) & 0xff;
+  } else {
+    cpu->x--;
+  }
+  cpu_setZN(cpu, cpu->x, X);
+}
+
+static void cpu_opcb(Cpu* cpu) { // wai imp
+  cpu->waiting = true;
+  cpu_idle(cpu);
+  cpu_idle(cpu);
+}
+
+template<bool X>
+static void cpu_opcc(Cpu* cpu) { // cpy abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_cpy<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opcd(Cpu* cpu) { // cmp abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_cmp<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opce(Cpu* cpu) { // dec abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_dec<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opcf(Cpu* cpu) { // cmp abl
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbl(cpu, &low);
+  cpu_cmp<M>(cpu, low, high);
+}
+
+static void cpu_opd0(Cpu* cpu) { // bne rel
+  cpu_doBranch(cpu, !cpu->z);
+}
+
+template<bool M, bool X>
+static void cpu_opd1(Cpu* cpu) { // cmp idy(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdy<X>(cpu, &low, false);
+  cpu_cmp<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opd2(Cpu* cpu) { // cmp idp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdp(cpu, &low);
+  cpu_cmp<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opd3(Cpu* cpu) { // cmp isy
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIsy(cpu, &low);
+  cpu_cmp<M>(cpu, low, high);
+}
+
+template<bool E>
+static void cpu_opd4(Cpu* cpu) { // pei dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_pushWord<E>(cpu, cpu_readWord(cpu, low, high, false), true);
+}
+
+template<bool M>
+static void cpu_opd5(Cpu* cpu) { // cmp dpx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDpx(cpu, &low);
+  cpu_cmp<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opd6(Cpu* cpu) { // dec dpx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDpx(cpu, &low);
+  cpu_dec<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opd7(Cpu* cpu) { // cmp ily
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIly(cpu, &low);
+  cpu_cmp<M>(cpu, low, high);
+}
+
+static void cpu_opd8(Cpu* cpu) { // cld imp
+  cpu_adrImp(cpu);
+  cpu->d = false;
+}
+
+template<bool M, bool X>
+static void cpu_opd9(Cpu* cpu) { // cmp aby(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAby<X>(cpu, &low, false);
+  cpu_cmp<M>(cpu, low, high);
+}
+
+template<bool E, bool X>
+static void cpu_opda(Cpu* cpu) { // phx imp
+  cpu_idle(cpu);
+  if(X) {
+    cpu_checkInt(cpu);
+    cpu_pushByte<E>(cpu, cpu->x);
+  } else {
+    cpu_pushWord<E>(cpu, cpu->x, true);
+  }
+}
+
+static void cpu_opdb(Cpu* cpu) { // stp imp
+  cpu->stopped = true;
+  cpu_idle(cpu);
+  cpu_idle(cpu);
+}
+
+static void cpu_opdc(Cpu* cpu) { // jml ial
+  uint16_t adr = cpu_readOpcodeWord(cpu, false);
+  cpu->pc = cpu_readWord(cpu, adr, (adr + 1) & 0xffff, false);
+  cpu_checkInt(cpu);
+  cpu->k = cpu_read(cpu, (adr + 2) & 0xffff);
+}
+
+template<bool M, bool X>
+static void cpu_opdd(Cpu* cpu) { // cmp abx(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbx<X>(cpu, &low, false);
+  cpu_cmp<M>(cpu, low, high);
+}
+
+template<bool M, bool X>
+static void cpu_opde(Cpu* cpu) { // dec abx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbx<X>(cpu, &low, true);
+  cpu_dec<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opdf(Cpu* cpu) { // cmp alx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAlx(cpu, &low);
+  cpu_cmp<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_ope0(Cpu* cpu) { // cpx imm(x)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrImm<X>(cpu, &low);
+  cpu_cpx<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_ope1(Cpu* cpu) { // sbc idx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdx(cpu, &low);
+  cpu_sbc<M>(cpu, low, high);
+}
+
+static void cpu_ope2(Cpu* cpu) { // sep imm(s)
+  uint8_t val = cpu_readOpcode(cpu);
+  cpu_checkInt(cpu);
+  cpu_setFlags(cpu, cpu_getFlags(cpu) | val);
+  cpu_idle(cpu);
+}
+
+template<bool M>
+static void cpu_ope3(Cpu* cpu) { // sbc sr
+  uint32_t low = 0;
+  uint32_t high = cpu_adrSr(cpu, &low);
+  cpu_sbc<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_ope4(Cpu* cpu) { // cpx dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_cpx<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_ope5(Cpu* cpu) { // sbc dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_sbc<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_ope6(Cpu* cpu) { // inc dp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDp(cpu, &low);
+  cpu_inc<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_ope7(Cpu* cpu) { // sbc idl
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdl(cpu, &low);
+  cpu_sbc<M>(cpu, low, high);
+}
+
+template<bool X>
+static void cpu_ope8(Cpu* cpu) { // inx imp
+  cpu_adrImp(cpu);
+  if(X) {
+    cpu->x = (cpu->x + 1) & 0xff;
+  } else {
+    cpu->x++;
+  }
+  cpu_setZN(cpu, cpu->x, X);
+}
+
+template<bool M>
+static void cpu_ope9(Cpu* cpu) { // sbc imm(m)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrImm<M>(cpu, &low);
+  cpu_sbc<M>(cpu, low, high);
+}
+
+static void cpu_opea(Cpu* cpu) { // nop imp
+  cpu_adrImp(cpu);
+  // no operation
+}
+
+static void cpu_opeb(Cpu* cpu) { // xba imp
+  uint8_t low = cpu->a & 0xff;
+  uint8_t high = cpu->a >> 8;
+  cpu->a = (low << 8) | high;
+  cpu_setZN(cpu, high, true);
+  cpu_idle(cpu);
+  cpu_checkInt(cpu);
+  cpu_idle(cpu);
+}
+
+template<bool X>
+static void cpu_opec(Cpu* cpu) { // cpx abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_cpx<X>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_oped(Cpu* cpu) { // sbc abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_sbc<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opee(Cpu* cpu) { // inc abs
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbs(cpu, &low);
+  cpu_inc<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opef(Cpu* cpu) { // sbc abl
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbl(cpu, &low);
+  cpu_sbc<M>(cpu, low, high);
+}
+
+static void cpu_opf0(Cpu* cpu) { // beq rel
+  cpu_doBranch(cpu, cpu->z);
+}
+
+template<bool M, bool X>
+static void cpu_opf1(Cpu* cpu) { // sbc idy(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdy<X>(cpu, &low, false);
+  cpu_sbc<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opf2(Cpu* cpu) { // sbc idp
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIdp(cpu, &low);
+  cpu_sbc<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opf3(Cpu* cpu) { // sbc isy
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIsy(cpu, &low);
+  cpu_sbc<M>(cpu, low, high);
+}
+
+template<bool E>
+static void cpu_opf4(Cpu* cpu) { // pea imm(l)
+  cpu_pushWord<E>(cpu, cpu_readOpcodeWord(cpu, false), true);
+}
+
+template<bool M>
+static void cpu_opf5(Cpu* cpu) { // sbc dpx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDpx(cpu, &low);
+  cpu_sbc<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opf6(Cpu* cpu) { // inc dpx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrDpx(cpu, &low);
+  cpu_inc<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opf7(Cpu* cpu) { // sbc ily
+  uint32_t low = 0;
+  uint32_t high = cpu_adrIly(cpu, &low);
+  cpu_sbc<M>(cpu, low, high);
+}
+
+static void cpu_opf8(Cpu* cpu) { // sed imp
+  cpu_adrImp(cpu);
+  cpu->d = true;
+}
+
+template<bool M, bool X>
+static void cpu_opf9(Cpu* cpu) { // sbc aby(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAby<X>(cpu, &low, false);
+  cpu_sbc<M>(cpu, low, high);
+}
+
+template<bool E, bool X>
+static void cpu_opfa(Cpu* cpu) { // plx imp
+  cpu_idle(cpu);
+  cpu_idle(cpu);
+  if(X) {
+    cpu_checkInt(cpu);
+    cpu->x = cpu_pullByte<E>(cpu);
+  } else {
+    cpu->x = cpu_pullWord<E>(cpu, true);
   }
+  cpu_setZN(cpu, cpu->x, X);
+}
+
+static void cpu_opfb(Cpu* cpu) { // xce imp
+  cpu_adrImp(cpu);
+  bool temp = cpu->c;
+  cpu->c = cpu->e;
+  cpu->e = temp;
+  cpu_setFlags(cpu, cpu_getFlags(cpu)); // updates x and m flags, clears upper half of x and y if needed
+}
+
+template<bool E>
+static void cpu_opfc(Cpu* cpu) { // jsr iax
+  uint8_t adrl = cpu_readOpcode(cpu);
+  cpu_pushWord<E>(cpu, cpu->pc, false);
+  uint16_t adr = adrl | (cpu_readOpcode(cpu) << 8);
+  cpu_idle(cpu);
+  uint16_t value = cpu_readWord(cpu, (cpu->k << 16) | ((adr + cpu->x) & 0xffff), (cpu->k << 16) | ((adr + cpu->x + 1) & 0xffff), true);
+  cpu->pc = value;
+}
+
+template<bool M, bool X>
+static void cpu_opfd(Cpu* cpu) { // sbc abx(r)
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbx<X>(cpu, &low, false);
+  cpu_sbc<M>(cpu, low, high);
+}
+
+template<bool M, bool X>
+static void cpu_opfe(Cpu* cpu) { // inc abx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAbx<X>(cpu, &low, true);
+  cpu_inc<M>(cpu, low, high);
+}
+
+template<bool M>
+static void cpu_opff(Cpu* cpu) { // sbc alx
+  uint32_t low = 0;
+  uint32_t high = cpu_adrAlx(cpu, &low);
+  cpu_sbc<M>(cpu, low, high);
+}
+// the opcode tables, one per mode, so the handlers never check the flags for operand sizes and stack wrapping
+// each handler is only templated on the flags it depends on, the ones that depend on none are shared by all tables
+template<bool E, bool M, bool X>
+static const CpuOpcodeHandler cpu_opcodes[256] = {
+  cpu_op00<E>, cpu_op01<M>, cpu_op02<E>, cpu_op03<M>, cpu_op04<M>, cpu_op05<M>, cpu_op06<M>, cpu_op07<M>,
+  cpu_op08<E>, cpu_op09<M>, cpu_op0a<M>, cpu_op0b<E>, cpu_op0c<M>, cpu_op0d<M>, cpu_op0e<M>, cpu_op0f<M>,
+  cpu_op10, cpu_op11<M, X>, cpu_op12<M>, cpu_op13<M>, cpu_op14<M>, cpu_op15<M>, cpu_op16<M>, cpu_op17<M>,
+  cpu_op18, cpu_op19<M, X>, cpu_op1a<M>, cpu_op1b<E>, cpu_op1c<M>, cpu_op1d<M, X>, cpu_op1e<M, X>, cpu_op1f<M>,
+  cpu_op20<E>, cpu_op21<M>, cpu_op22<E>, cpu_op23<M>, cpu_op24<M>, cpu_op25<M>, cpu_op26<M>, cpu_op27<M>,
+  cpu_op28<E>, cpu_op29<M>, cpu_op2a<M>, cpu_op2b<E>, cpu_op2c<M>, cpu_op2d<M>, cpu_op2e<M>, cpu_op2f<M>,
+  cpu_op30, cpu_op31<M, X>, cpu_op32<M>, cpu_op33<M>, cpu_op34<M>, cpu_op35<M>, cpu_op36<M>, cpu_op37<M>,
+  cpu_op38, cpu_op39<M, X>, cpu_op3a<M>, cpu_op3b, cpu_op3c<M, X>, cpu_op3d<M, X>, cpu_op3e<M, X>, cpu_op3f<M>,
+  cpu_op40<E>, cpu_op41<M>, cpu_op42, cpu_op43<M>, cpu_op44<X>, cpu_op45<M>, cpu_op46<M>, cpu_op47<M>,
+  cpu_op48<E, M>, cpu_op49<M>, cpu_op4a<M>, cpu_op4b<E>, cpu_op4c, cpu_op4d<M>, cpu_op4e<M>, cpu_op4f<M>,
+  cpu_op50, cpu_op51<M, X>, cpu_op52<M>, cpu_op53<M>, cpu_op54<X>, cpu_op55<M>, cpu_op56<M>, cpu_op57<M>,
+  cpu_op58, cpu_op59<M, X>, cpu_op5a<E, X>, cpu_op5b, cpu_op5c, cpu_op5d<M, X>, cpu_op5e<M, X>, cpu_op5f<M>,
+  cpu_op60<E>, cpu_op61<M>, cpu_op62<E>, cpu_op63<M>, cpu_op64<M>, cpu_op65<M>, cpu_op66<M>, cpu_op67<M>,
+  cpu_op68<E, M>, cpu_op69<M>, cpu_op6a<M>, cpu_op6b<E>, cpu_op6c, cpu_op6d<M>, cpu_op6e<M>, cpu_op6f<M>,
+  cpu_op70, cpu_op71<M, X>, cpu_op72<M>, cpu_op73<M>, cpu_op74<M>, cpu_op75<M>, cpu_op76<M>, cpu_op77<M>,
+  cpu_op78, cpu_op79<M, X>, cpu_op7a<E, X>, cpu_op7b, cpu_op7c, cpu_op7d<M, X>, cpu_op7e<M, X>, cpu_op7f<M>,
+  cpu_op80, cpu_op81<M>, cpu_op82, cpu_op83<M>, cpu_op84<X>, cpu_op85<M>, cpu_op86<X>, cpu_op87<M>,
+  cpu_op88<X>, cpu_op89<M>, cpu_op8a<M>, cpu_op8b<E>, cpu_op8c<X>, cpu_op8d<M>, cpu_op8e<X>, cpu_op8f<M>,
+  cpu_op90, cpu_op91<M, X>, cpu_op92<M>, cpu_op93<M>, cpu_op94<X>, cpu_op95<M>, cpu_op96<X>, cpu_op97<M>,
+  cpu_op98<M>, cpu_op99<M, X>, cpu_op9a<E>, cpu_op9b<X>, cpu_op9c<M>, cpu_op9d<M, X>, cpu_op9e<M, X>, cpu_op9f<M>,
+  cpu_opa0<X>, cpu_opa1<M>, cpu_opa2<X>, cpu_opa3<M>, cpu_opa4<X>, cpu_opa5<M>, cpu_opa6<X>, cpu_opa7<M>,
+  cpu_opa8<X>, cpu_opa9<M>, cpu_opaa<X>, cpu_opab<E>, cpu_opac<X>, cpu_opad<M>, cpu_opae<X>, cpu_opaf<M>,
+  cpu_opb0, cpu_opb1<M, X>, cpu_opb2<M>, cpu_opb3<M>, cpu_opb4<X>, cpu_opb5<M>, cpu_opb6<X>, cpu_opb7<M>,
+  cpu_opb8, cpu_opb9<M, X>, cpu_opba<X>, cpu_opbb<X>, cpu_opbc<X>, cpu_opbd<M, X>, cpu_opbe<X>, cpu_opbf<M>,
+  cpu_opc0<X>, cpu_opc1<M>, cpu_opc2, cpu_opc3<M>, cpu_opc4<X>, cpu_opc5<M>, cpu_opc6<M>, cpu_opc7<M>,
+  cpu_opc8<X>, cpu_opc9<M>, cpu_opca<X>, cpu_opcb, cpu_opcc<X>, cpu_opcd<M>, cpu_opce<M>, cpu_opcf<M>,
+  cpu_opd0, cpu_opd1<M, X>, cpu_opd2<M>, cpu_opd3<M>, cpu_opd4<E>, cpu_opd5<M>, cpu_opd6<M>, cpu_opd7<M>,
+  cpu_opd8, cpu_opd9<M, X>, cpu_opda<E, X>, cpu_opdb, cpu_opdc, cpu_opdd<M, X>, cpu_opde<M, X>, cpu_opdf<M>,
+  cpu_ope0<X>, cpu_ope1<M>, cpu_ope2, cpu_ope3<M>, cpu_ope4<X>, cpu_ope5<M>, cpu_ope6<M>, cpu_ope7<M>,
+  cpu_ope8<X>, cpu_ope9<M>, cpu_opea, cpu_opeb, cpu_opec<X>, cpu_oped<M>, cpu_opee<M>, cpu_opef<M>,
+  cpu_opf0, cpu_opf1<M, X>, cpu_opf2<M>, cpu_opf3<M>, cpu_opf4<E>, cpu_opf5<M>, cpu_opf6<M>, cpu_opf7<M>,
+  cpu_opf8, cpu_opf9<M, X>, cpu_opfa<E, X>, cpu_opfb, cpu_opfc<E>, cpu_opfd<M, X>, cpu_opfe<M, X>, cpu_opff<M>
+};
+
+// indexed by e << 2 | m << 1 | x, emulation mode always has m and x set
+static const CpuOpcodeHandler* const cpu_modeOpcodes[8] = {
+  cpu_opcodes<false, false, false>, cpu_opcodes<false, false, true>,
+  cpu_opcodes<false, true, false>, cpu_opcodes<false, true, true>,
+  cpu_opcodes<true, true, true>, cpu_opcodes<true, true, true>,
+  cpu_opcodes<true, true, true>, cpu_opcodes<true, true, true>
+};
+
+static void cpu_updateMode(Cpu* cpu) {
+  // called whenever e, m or x can change: cpu_setFlags (which rep, sep, plp, rti and xce go through), resets and states
+  cpu->mode = cpu->e << 2 | cpu->mf << 1 | cpu->xf;
+  cpu->opcodes = cpu_modeOpcodes[cpu->mode];
+}
+
+// decode cache
+// entries keep the opcode with its operand bytes and the handler for the mode, decoded from memory once. they stay
+// valid as long as the write counter of the 4K of host memory the code is in (from CpuCodeHandler) does not change,
+// it is checked before every byte is taken from the entry, so writes to code (by the cpu or dma, even in the middle
+// of the instruction) are seen exactly as they would be without the cache. the bus accesses themselves still happen
+// one by one, with their timing, through CpuFetchHandler
+
+static void cpu_flushDecoded(Cpu* cpu) {
+  for(int i = 0; i < decodedSize; i++) cpu->decoded[i].tag = 0xffffffff;
+}
+
+static void cpu_decode(Cpu* cpu, CpuDecoded* entry, uint32_t adr, uint32_t tag) {
+  entry->tag = tag;
+  entry->code = cpu->code(cpu->mem, adr, &entry->pageWrites);
+  if(entry->code == NULL) return;
+  entry->writes = *entry->pageWrites;
+  entry->length = 0x1000 - (adr & 0xfff) < 4 ? 0x1000 - (adr & 0xfff) : 4;
+  memcpy(entry->bytes, entry->code, entry->length);
+  entry->handler = cpu->opcodes[entry->bytes[0]];
+}
+
+static void cpu_runDecoded(Cpu* cpu) {
+  uint32_t adr = (cpu->k << 16) | cpu->pc;
+  uint32_t tag = adr | cpu->mode << 24;
+  CpuDecoded* entry = &cpu->decoded[(adr ^ (adr >> 12)) & (decodedSize - 1)];
+  if(entry->tag != tag || (entry->code != NULL && *entry->pageWrites != entry->writes)) {
+    cpu_decode(cpu, entry, adr, tag);
+  }
+  if(entry->code == NULL) {
+    // not plain memory, read it the normal way
+    uint8_t opcode = cpu_readOpcode(cpu);
+    cpu->opcodes[opcode](cpu);
+    return;
+  }
+  cpu->intDelay = false;
+  uint8_t opcode = cpu->fetch(cpu->mem, adr, entry->bytes[0], entry->code);
+  cpu->pc++;
+  cpu->running = entry;
+  cpu->operandsLeft = entry->length - 1;
+  // another opcode only if dma wrote it during the fetch, then the page changed and the operands are read normally
+  if(opcode == entry->bytes[0]) {
+    entry->handler(cpu);
+  } else {
+    cpu->opcodes[opcode](cpu);
+  }
+  cpu->operandsLeft = 0;
+}
+
+static void cpu_checkLoop(Cpu* cpu) {
+  // everything cpu_runOpcode depends on, packed
+  uint64_t regs0 = cpu->a | (uint64_t)cpu->x << 16 | (uint64_t)cpu->y << 32 | (uint64_t)cpu->sp << 48;
+  uint64_t regs1 = cpu->dp | (uint64_t)cpu->pc << 16 | (uint64_t)cpu->k << 32 | (uint64_t)cpu->db << 40 |
+    (uint64_t)cpu_getFlags(cpu) << 48 | (uint64_t)cpu->e << 56 | (uint64_t)cpu->irqWanted << 57 |
+    (uint64_t)cpu->nmiWanted << 58 | (uint64_t)cpu->intWanted << 59 | (uint64_t)cpu->intDelay << 60;
+  bool repeated = regs0 == cpu->loopRegs[0] && regs1 == cpu->loopRegs[1];
+  cpu->loopRegs[0] = regs0;
+  cpu->loopRegs[1] = regs1;
+  cpu->loop(cpu->mem, repeated);
+}
+
+static void cpu_forgetLoop(Cpu* cpu) {
+  // bit 63 is never set by cpu_checkLoop
+  cpu->loopRegs[0] = 0;
+  cpu->loopRegs[1] = 1ULL << 63;
 }
@@ -206,6 +206,7 @@ static void dma_waitCycle(Dma* dma) {
 }
 
 static void dma_doDma(Dma* dma, int cpuCycles) {
+  SNES_STAT_TIME_ENTER(dma->snes, SNES_TIME_DMA, prevTimer);
   // nmi/irq is delayed by 1 opcode if requested during dma/hdma
   dma->snes->cpu->intDelay = true;
   // align to multiple of 8
@@ -223,6 +224,7 @@ static void dma_doDma(Dma* dma, int cpuCycles) {
         dma, dma->channel[i].aAdr, dma->channel[i].aBank,
         dma->channel[i].bAdr + bAdrOffsets[dma->channel[i].mode][offIndex++], dma->channel[i].fromB
       );
+      SNES_STAT_INC(dma->snes, dmaBytes);
       offIndex &= 3;
       if(!dma->channel[i].fixed) {
         dma->channel[i].aAdr += dma->channel[i].decrement ? -1 : 1;
@@ -235,6 +237,7 @@ static void dma_doDma(Dma* dma, int cpuCycles) {
   }
   // re-align to cpu cycles
   snes_syncCycles(dma->snes, false, cpuCycles);
+  SNES_STAT_TIME_LEAVE(dma->snes, prevTimer);
 }
 
 static void dma_initHdma(Dma* dma, bool doSync, int cpuCycles) {
@@ -247,6 +250,7 @@ static void dma_initHdma(Dma* dma, bool doSync, int cpuCycles) {
     dma->channel[i].terminated = false;
   }
   if(!hdmaEnabled) return;
+  SNES_STAT_TIME_ENTER(dma->snes, SNES_TIME_DMA, prevTimer);
   // nmi/irq is delayed by 1 opcode if requested during dma/hdma
   dma->snes->cpu->intDelay = true;
   if(doSync) snes_syncCycles(dma->snes, true, 8);
@@ -271,6 +275,7 @@ static void dma_initHdma(Dma* dma, bool doSync, int cpuCycles) {
     }
   }
   if(doSync) snes_syncCycles(dma->snes, false, cpuCycles);
+  SNES_STAT_TIME_LEAVE(dma->snes, prevTimer);
 }
 
 static void dma_doHdma(Dma* dma, bool doSync, int cpuCycles) {
@@ -284,6 +289,7 @@ static void dma_doHdma(Dma* dma, bool doSync, int cpuCycles) {
     }
   }
   if(!hdmaActive) return;
+  SNES_STAT_TIME_ENTER(dma->snes, SNES_TIME_DMA, prevTimer);
   // nmi/irq is delayed by 1 opcode if requested during dma/hdma
   dma->snes->cpu->intDelay = true;
   if(doSync) snes_syncCycles(dma->snes, true, 8);
@@ -309,6 +315,7 @@ static void dma_doHdma(Dma* dma, bool doSync, int cpuCycles) {
               dma->channel[i].bAdr + bAdrOffsets[dma->channel[i].mode][j], dma->channel[i].fromB
             );
           }
+          SNES_STAT_INC(dma->snes, hdmaBytes);
         }
       }
     }
@@ -340,6 +347,7 @@ static void dma_doHdma(Dma* dma, bool doSync, int cpuCycles) {
     }
   }
   if(doSync) snes_syncCycles(dma->snes, false, cpuCycles);
+  SNES_STAT_TIME_LEAVE(dma->snes, prevTimer);
 }
 
 static void dma_transferByte(Dma* dma, uint16_t aAdr, uint8_t aBank, uint8_t bAdr, bool fromB) {
@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <atomic>
+#include <chrono>
+
+#include <framebuffer.h>
+#include <ppu.h>
+
+// the shared word holds the index of the middle buffer, plus a flag if it holds a frame the consumer has not seen
+static const int frameFresh = 4;
+
+struct FrameBuffer {
+  int format;
+  Frame frames[3];
+  std::atomic<int> middle;
+  int back; // only touched by the producer
+  int front; // only touched by the consumer
+};
+
+FrameBuffer* framebuffer_init(int format) {
+  FrameBuffer* fb = new FrameBuffer();
+  fb->format = format;
+  int pitch = 512 * (format == PPU_FORMAT_RGB565 || format == PPU_FORMAT_RGB555 ? 2 : 4);
+  for(int i = 0; i < 3; i++) {
+    Frame* frame = &fb->frames[i];
+    frame->pixels = (uint8_t*)calloc(pitch * 478, 1);
+    frame->pitch = pitch;
+    frame->width = 0;
+    frame->height = 0;
+    frame->sequence = 0;
+    frame->timestamp = 0;
+  }
+  fb->back = 0;
+  fb->middle.store(1);
+  fb->front = 2;
+  return fb;
+}
+
+void framebuffer_free(FrameBuffer* fb) {
+  for(int i = 0; i < 3; i++) free(fb->frames[i].pixels);
+  delete fb;
+}
+
+int framebuffer_getFormat(FrameBuffer* fb) {
+  return fb->format;
+}
+
+Frame* framebuffer_getBack(FrameBuffer* fb) {
+  return &fb->frames[fb->back];
+}
+
+void framebuffer_publish(FrameBuffer* fb) {
+  Frame* frame = &fb->frames[fb->back];
+  frame->timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()
+  ).count();
+  // release the frame contents with the swap, and take over whatever the middle was (stale or not yet read)
+  fb->back = fb->middle.exchange(fb->back | frameFresh, std::memory_order_acq_rel) & 3;
+}
+
+const Frame* framebuffer_acquire(FrameBuffer* fb) {
+  if(fb->middle.load(std::memory_order_acquire) & frameFresh) {
+    fb->front = fb->middle.exchange(fb->front, std::memory_order_acq_rel) & 3;
+  }
+  const Frame* frame = &fb->frames[fb->front];
+  return frame->width == 0 ? NULL : frame;
+}
+
+bool framebuffer_hasNew(FrameBuffer* fb) {
+  return fb->middle.load(std::memory_order_acquire) & frameFresh;
+}
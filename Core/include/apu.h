@@ -25,6 +25,7 @@ struct Apu {
   Spc* spc;
   Dsp* dsp;
   uint8_t ram[0x10000];
+  uint8_t bootRom[0x40]; // algorithmically constructed in apu_init
   bool romReadable;
   uint8_t dspAdr;
   uint64_t cycles;
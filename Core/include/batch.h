@@ -0,0 +1,47 @@
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct Batch Batch;
+
+#include <snes.h>
+
+// runs jobs on many independent Snes instances from a work-stealing thread pool
+// jobs for the same instance run one after another in submission order, jobs for different instances run in parallel
+
+enum {
+  BATCH_HASH_VIDEO = 1 << 0, // fetch the framebuffer every frame and hash it
+  BATCH_HASH_AUDIO = 1 << 1 // fetch the samples every frame and hash them
+};
+
+typedef struct BatchInput {
+  int frame; // relative to the start of the job
+  int player; // 0 or 1
+  uint16_t buttons; // full controller state from this frame on, bit n is button n of snes_setButtonState
+} BatchInput;
+
+typedef struct BatchJob {
+  // set by the caller, has to stay valid until the job is done
+  int instance;
+  int frames;
+  const BatchInput* inputs; // sorted by frame, can be NULL
+  int inputCount;
+  int flags;
+  uint8_t* ram; // if not NULL, receives a copy of the 128K wram after the last frame
+  // results (fnv-1a over all frames of the job)
+  uint64_t videoHash;
+  uint64_t audioHash;
+  bool done;
+} BatchJob;
+
+Batch* batch_init(int threads); // 0 uses one thread per hardware thread
+void batch_free(Batch* batch); // waits for outstanding jobs
+int batch_addInstance(Batch* batch, const uint8_t* data, int length); // loads the rom into a new instance, returns its index or -1
+Snes* batch_getInstance(Batch* batch, int instance); // only safe to touch while it has no jobs queued
+void batch_submit(Batch* batch, BatchJob* job);
+void batch_wait(Batch* batch); // returns once every submitted job is done
+
+#endif
@@ -9,6 +9,7 @@ typedef struct Cart Cart;
 
 #include <snes.h>
 #include <statehandler.h>
+#include <cx4.h>
 
 typedef struct CartHeader {
   // normal header
@@ -50,6 +51,8 @@ struct Cart {
   uint32_t romSize;
   uint8_t* ram;
   uint32_t ramSize;
+  // coprocessor (allocated by cart_load for cx4 carts)
+  CX4* cx4;
 };
 
 // TODO: how to handle reset & load?
@@ -63,5 +66,8 @@ void cart_load(Cart* cart, int type, uint8_t* rom, int romSize, int ramSize, boo
 bool cart_handleBattery(Cart* cart, bool save, uint8_t* data, int* size); // saves/loads ram
 uint8_t cart_read(Cart* cart, uint8_t bank, uint16_t adr);
 void cart_write(Cart* cart, uint8_t bank, uint16_t adr, uint8_t val);
+// direct host pointers for the 4K page starting at bank:adr, NULL if the page is not plain rom/ram
+uint8_t* cart_getReadPage(Cart* cart, uint8_t bank, uint16_t adr);
+uint8_t* cart_getWritePage(Cart* cart, uint8_t bank, uint16_t adr);
 
 #endif
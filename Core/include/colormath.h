@@ -0,0 +1,37 @@
+
+#ifndef COLORMATH_H
+#define COLORMATH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// last stage of a ppu line: color math, brightness and output as xbgr pixels
+// colors are bgr555, masks are 0xff (set) or 0 per pixel
+
+typedef struct ColorMathLine {
+  const uint16_t* main; // mainscreen color
+  const uint16_t* sub; // added to or subtracted from main where math is set (subscreen or fixed color)
+  const uint16_t* left; // left half-pixel for hires (not clipped, no math), NULL to repeat the result
+  const uint8_t* clip; // main is clipped to black (before math)
+  const uint8_t* math; // color math applies
+  const uint8_t* half; // result of the math is halved
+  bool subtract;
+  int brightness; // 0-15
+} ColorMathLine;
+
+enum {
+  COLORMATH_AUTO = 0, // best one available
+  COLORMATH_PORTABLE,
+  COLORMATH_SSE2,
+  COLORMATH_AVX2,
+  COLORMATH_KERNEL_COUNT
+};
+
+// writes 8 bytes per pixel (left pixel, then right pixel, as 0, b, g, r)
+void colormath_renderLine(const ColorMathLine* line, uint8_t* out, int count);
+void colormath_renderLineWith(int kernel, const ColorMathLine* line, uint8_t* out, int count);
+bool colormath_hasKernel(int kernel); // if it is compiled in and the cpu supports it
+const char* colormath_kernelName(int kernel);
+void colormath_toXbgr(uint16_t color, int brightness, uint8_t* out); // one output pixel, same as the kernels
+
+#endif
@@ -10,15 +10,39 @@
 typedef uint8_t (*CpuReadHandler)(void* mem, uint32_t adr);
 typedef void (*CpuWriteHandler)(void* mem, uint32_t adr, uint8_t val);
 typedef void (*CpuIdleHandler)(void* mem, bool waiting);
+// decode cache: host pointer to the byte at adr if reading it has no side effects (NULL otherwise), and the write
+// counter of the host memory it is in, which every write that can change the byte increments
+typedef const uint8_t* (*CpuCodeHandler)(void* mem, uint32_t adr, const uint32_t** writes);
+// and a read of such a byte, with the same bus timing as CpuReadHandler: the value is the cached one, unless
+// something gets to write memory during the access itself ((h)dma), then it is read from code at the right time
+typedef uint8_t (*CpuFetchHandler)(void* mem, uint32_t adr, uint8_t cached, const uint8_t* code);
+// idle loops: called after each taken short backward branch, repeated if the registers are the same as after the
+// previous one (so the iteration in between changed nothing in the cpu)
+typedef void (*CpuLoopHandler)(void* mem, bool repeated);
 
 typedef struct Cpu Cpu;
 
+typedef void (*CpuOpcodeHandler)(Cpu* cpu);
+
+typedef struct CpuDecoded {
+  uint32_t tag; // 24-bit address | mode << 24, 0xffffffff if unused
+  uint32_t writes; // *pageWrites when decoded, the entry is stale once that changed
+  const uint32_t* pageWrites; // write counter of the memory the code is in
+  const uint8_t* code; // host pointer to the opcode, NULL if the address can't be cached (i/o)
+  CpuOpcodeHandler handler; // for bytes[0] in the mode of the tag
+  uint8_t length; // bytes decoded, up to the end of the page (4 at most), operands past it are read normally
+  uint8_t bytes[4]; // the opcode and its operands
+} CpuDecoded;
+
 struct Cpu {
   // reference to memory handler, pointers to read/write/idle handlers
   void* mem;
   CpuReadHandler read;
   CpuWriteHandler write;
   CpuIdleHandler idle;
+  CpuCodeHandler code;
+  CpuFetchHandler fetch;
+  CpuLoopHandler loop;
   // registers
   uint16_t a;
   uint16_t x;
@@ -47,9 +71,17 @@ struct Cpu {
   bool intWanted;
   bool intDelay;
   bool resetWanted;
+  // opcode table for the current e/m/x mode, not part of the state (follows the flags)
+  const CpuOpcodeHandler* opcodes;
+  uint8_t mode; // e << 2 | m << 1 | x
+  // decode cache, direct mapped on the address of the opcode
+  CpuDecoded* decoded;
+  const CpuDecoded* running; // entry of the running cached opcode, its operands come from there
+  int operandsLeft; // operand bytes in it not read yet
+  uint64_t loopRegs[2]; // registers after the last short backward branch, for CpuLoopHandler
 };
 
-Cpu* cpu_init(void* mem, CpuReadHandler read, CpuWriteHandler write, CpuIdleHandler idle);
+Cpu* cpu_init(void* mem, CpuReadHandler read, CpuWriteHandler write, CpuIdleHandler idle, CpuCodeHandler code, CpuFetchHandler fetch, CpuLoopHandler loop);
 void cpu_free(Cpu* cpu);
 void cpu_reset(Cpu* cpu, bool hard);
 void cpu_handleState(Cpu* cpu, StateHandler* sh);
@@ -1,12 +1,19 @@
-
 #ifndef CX4_H
 #define CX4_H
 
-void cx4_init(void *mem);
-uint8_t cx4_read(uint32_t addr);
-void cx4_write(uint32_t addr, uint8_t value);
-void cx4_run();
-void cx4_reset();
-void cx4_handleState(StateHandler* sh);
+#include <stdint.h>
+
+typedef struct CX4 CX4;
+
+#include <snes.h>
+#include <statehandler.h>
+
+CX4* cx4_init(Snes* snes);
+void cx4_free(CX4* cx4);
+uint8_t cx4_read(CX4* cx4, uint32_t addr);
+void cx4_write(CX4* cx4, uint32_t addr, uint8_t value);
+void cx4_run(CX4* cx4);
+void cx4_reset(CX4* cx4);
+void cx4_handleState(CX4* cx4, StateHandler* sh);
 
 #endif
@@ -0,0 +1,33 @@
+
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct FrameBuffer FrameBuffer;
+
+// lock-free triple buffer to hand finished frames from the emulation thread to a presentation thread
+// the producer renders into the back buffer and publishes it, the consumer always gets the newest published frame
+// one producer and one consumer thread, neither ever waits for the other and no frame is copied
+
+typedef struct Frame {
+  uint8_t* pixels; // room for 512 * 478 pixels in the buffer's format (PPU_FORMAT_*)
+  int pitch; // bytes per row
+  int width; // 256 or 512
+  int height; // 224 or 239, doubled when interlaced
+  uint32_t sequence; // snes frame counter at the end of the frame
+  uint64_t timestamp; // steady clock, in ns, when it was published
+} Frame;
+
+FrameBuffer* framebuffer_init(int format);
+void framebuffer_free(FrameBuffer* fb);
+int framebuffer_getFormat(FrameBuffer* fb);
+// producer side
+Frame* framebuffer_getBack(FrameBuffer* fb); // to render into, owned by the producer until published
+void framebuffer_publish(FrameBuffer* fb); // makes the back buffer the newest frame and takes a free one as the back
+// consumer side
+const Frame* framebuffer_acquire(FrameBuffer* fb); // newest frame, NULL before the first publish; stays valid until the next acquire
+bool framebuffer_hasNew(FrameBuffer* fb); // if a frame was published since the last acquire
+
+#endif
@@ -10,6 +10,15 @@ typedef struct Ppu Ppu;
 #include <snes.h>
 #include <statehandler.h>
 
+// output formats for ppu_putFrame, 32-bit formats are native-endian words
+enum {
+  PPU_FORMAT_XRGB8888 = 0, // 0x00rrggbb
+  PPU_FORMAT_XBGR8888, // 0x00bbggrr
+  PPU_FORMAT_RGB565, // rrrrrggggggbbbbb
+  PPU_FORMAT_RGB555, // 0rrrrrgggggbbbbb
+  PPU_FORMAT_COUNT
+};
+
 typedef struct BgLayer {
   uint16_t hScroll;
   uint16_t vScroll;
@@ -45,11 +54,22 @@ struct Ppu {
   uint16_t vramIncrement;
   uint8_t vramRemapMode;
   uint16_t vramReadBuffer;
+  // vram decoded to one byte per pixel, per 2bpp, 4bpp and 8bpp tile, redone on use after writes
+  uint8_t tiles2bpp[0x1000][64];
+  uint8_t tiles4bpp[0x800][64];
+  uint8_t tiles8bpp[0x400][64];
+  bool tiles2bppDirty[0x1000];
+  bool tiles4bppDirty[0x800];
+  bool tiles8bppDirty[0x400];
   // cgram access
   uint16_t cgram[0x100];
   uint8_t cgramPointer;
   bool cgramSecondWrite;
   uint8_t cgramBuffer;
+  // cgram (0-255) and the direct colors (256-2303) as bgr555, and as output pixels (0, b, g, r) with brightness applied
+  uint16_t palette[0x900];
+  uint8_t paletteXbgr[0x900][4];
+  int paletteXbgrBrightness; // brightness paletteXbgr is for, -1 if stale
   // oam access
   uint16_t oam[0x100];
   uint8_t highOam[0x20];
@@ -69,6 +89,14 @@ struct Ppu {
   bool timeOver;
   bool rangeOver;
   bool objInterlace;
+  // sprites in range per line (bit n & 63 of word n >> 6 for sprite n), kept up to date for the sprites marked dirty
+  uint64_t spriteLines[256][2];
+  uint8_t spriteTop[128]; // first line a sprite is entered on
+  uint8_t spriteHeight[128]; // lines it is entered on, 0 if it is out of x-range
+  uint8_t spriteSize[128];
+  int16_t spriteX[128];
+  bool spriteDirty[128];
+  bool spriteListsDirty; // if any spriteDirty is set
   // background layers
   BgLayer bgLayer[4];
   uint8_t scrollPrev;
@@ -115,6 +143,7 @@ struct Ppu {
   bool frameOverscan; // if we are overscanning this frame (determined at 0,225)
   bool interlace;
   bool frameInterlace; // if we are interlacing this frame (determined at start vblank)
+  bool frameHires; // if any line of this frame used mode 5/6 or pseudo-hires (not part of the state)
   bool directColor;
   // latching
   uint16_t hCount;
@@ -124,6 +153,15 @@ struct Ppu {
   bool countersLatched;
   uint8_t ppu1openBus;
   uint8_t ppu2openBus;
+  // per-line render buffers (not part of the state, rebuilt every line)
+  uint16_t bgLinePixels[4][512]; // cgram index (palette in bits 10-8 for 8bpp) per screen x, half-pixel in mode 5/6
+  uint8_t bgLinePrios[4][512];
+  // offset-per-tile values for modes 2/4/6 per column (0 has none), from the bg3 tilemap, rebuilt every line
+  uint16_t optHOffsets[33];
+  uint16_t optVOffsets[33];
+  // window masks, bit x & 63 of word x >> 6 per screen x, rebuilt after writes to $2123-$212b
+  uint64_t windowMasks[6][4]; // 0-3 (bg) 4 (spr) 5 (colorwind)
+  bool windowMasksDirty;
   // pixel buffer (xbgr)
   // times 2 for even and odd frame
   uint8_t pixelBuffer[512 * 4 * 239 * 2];
@@ -137,9 +175,13 @@ bool ppu_checkOverscan(Ppu* ppu);
 void ppu_handleVblank(Ppu* ppu);
 void ppu_handleFrameStart(Ppu* ppu);
 void ppu_runLine(Ppu* ppu, int line);
+void ppu_evaluateLine(Ppu* ppu, int line); // first half of ppu_runLine, everything but the rendering
+void ppu_renderLine(Ppu* ppu, int line); // second half, only touches the render caches and pixelBuffer
 uint8_t ppu_read(Ppu* ppu, uint8_t adr);
 void ppu_write(Ppu* ppu, uint8_t adr, uint8_t val);
 void ppu_latchHV(Ppu* ppu);
 void ppu_putPixels(Ppu* ppu, uint8_t* pixels);
+void ppu_getFrameSize(Ppu* ppu, int* width, int* height);
+void ppu_putFrame(Ppu* ppu, uint8_t* pixels, int pitch, int format);
 
 #endif
@@ -0,0 +1,32 @@
+
+#ifndef PPUWORKER_H
+#define PPUWORKER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct PpuWorker PpuWorker;
+
+#include <snes.h>
+#include <ppu.h>
+
+// renders the ppu lines on a second thread, pipelined within the frame
+// the emulation thread keeps snes->ppu for everything the cpu can observe and only runs ppu_evaluateLine on it,
+// everything that affects rendering is logged and replayed by the worker on a mirror ppu in the same order,
+// so the mirror renders exactly what ppu_runLine would have rendered inline
+
+PpuWorker* ppuworker_init(Snes* snes); // the mirror starts as a copy of snes->ppu
+void ppuworker_free(PpuWorker* worker); // finishes the log first
+// logging, on the emulation thread, each right after the same call on snes->ppu
+void ppuworker_write(PpuWorker* worker, uint8_t adr, uint8_t val);
+void ppuworker_read(PpuWorker* worker, uint8_t adr); // only needed for the reads that move oam/vram/cgram pointers
+void ppuworker_runLine(PpuWorker* worker, int line, bool render); // after ppu_evaluateLine, only evaluates if not rendering
+void ppuworker_handleFrameStart(PpuWorker* worker);
+void ppuworker_checkOverscan(PpuWorker* worker);
+void ppuworker_handleVblank(PpuWorker* worker, bool publish); // can also publish the frame to snes->frameOutput, from the worker
+// waits until everything logged is rendered and returns the mirror, which stays valid until the next log call
+Ppu* ppuworker_sync(PpuWorker* worker);
+void ppuworker_reload(PpuWorker* worker); // syncs and copies snes->ppu into the mirror again (after states)
+void ppuworker_reset(PpuWorker* worker); // reload after a reset, also clears the pixels of the mirror like ppu_reset
+
+#endif
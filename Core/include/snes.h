@@ -2,10 +2,20 @@
 #ifndef SNES_H
 #define SNES_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
+// opt-in instrumentation (counters and per-subsystem wall time), compiled out unless built with SNES_STATS=1
+#ifndef SNES_STATS
+#define SNES_STATS 0
+#endif
+
+// starting value for snes_hash (the fnv-1a offset basis)
+#define SNES_HASH_INIT 0xcbf29ce484222325ULL
+
 typedef struct Snes Snes;
+typedef struct PpuWorker PpuWorker;
 
 #include <cpu.h>
 #include <apu.h>
@@ -14,6 +24,54 @@ typedef struct Snes Snes;
 #include <cart.h>
 #include <input.h>
 #include <statehandler.h>
+#include <framebuffer.h>
+
+enum {
+  SNES_REGION_WRAM = 0, // 7e-7f, and the low 8K mirror in the system banks
+  SNES_REGION_ROM,
+  SNES_REGION_SRAM,
+  SNES_REGION_BBUS, // 2100-21ff
+  SNES_REGION_REGS, // 4200-421f
+  SNES_REGION_DMA, // 4300-437f
+  SNES_REGION_OTHER, // joypad ports, open bus, coprocessor registers
+  SNES_REGION_COUNT
+};
+
+enum {
+  SNES_TIME_CPU = 0, // everything not accounted to one of the others (cpu, bus, scheduling)
+  SNES_TIME_PPU,
+  SNES_TIME_APU,
+  SNES_TIME_DMA,
+  SNES_TIME_COUNT
+};
+
+typedef struct SnesStats {
+  uint64_t cpuOpcodes;
+  uint64_t reads[SNES_REGION_COUNT]; // a-bus reads (cpu and dma)
+  uint64_t writes[SNES_REGION_COUNT];
+  uint64_t runCycles; // snes_runCycle iterations
+  uint64_t ppuLines;
+  uint64_t spcOpcodes;
+  uint64_t dspCycles;
+  uint64_t apuCatchups;
+  uint64_t dmaBytes;
+  uint64_t hdmaBytes;
+  uint64_t idleCycles; // master cycles skipped over in idle loops
+  uint64_t busCycles; // master cycles of cpu accesses that were deferred and run in one go
+  uint64_t timeNs[SNES_TIME_COUNT]; // exclusive wall time per subsystem
+} SnesStats;
+
+#if SNES_STATS
+#define SNES_STAT_INC(snes, field) ((snes)->stats.field++)
+#define SNES_STAT_ADD(snes, field, val) ((snes)->stats.field += (val))
+#define SNES_STAT_TIME_ENTER(snes, sub, prev) int prev = snes_statsSwitch(snes, sub)
+#define SNES_STAT_TIME_LEAVE(snes, prev) snes_statsSwitch(snes, prev)
+#else
+#define SNES_STAT_INC(snes, field)
+#define SNES_STAT_ADD(snes, field, val) ((void)(val))
+#define SNES_STAT_TIME_ENTER(snes, sub, prev)
+#define SNES_STAT_TIME_LEAVE(snes, prev)
+#endif
 
 struct Snes {
   Cpu* cpu;
@@ -22,6 +80,12 @@ struct Snes {
   Dma* dma;
   Cart* cart;
   bool palTiming;
+  FrameBuffer* frameOutput; // if set, each frame is rendered into it at the start of vblank (not owned)
+  PpuWorker* ppuWorker; // if set, lines are rendered on its thread instead of inline
+  int frameSkip; // frames skipped after each rendered one
+  int framesToSkip; // left until the next rendered frame
+  bool renderFrame; // if the current frame is rendered, skipped ones only evaluate sprites (not part of the state)
+  bool showFrame; // if the current frame is also shown, not just rendered for the field an interlaced one weaves in
   // input
   Input* input1;
   Input* input2;
@@ -36,6 +100,17 @@ struct Snes {
   uint64_t cycles;
   uint64_t syncCycle;
   uint32_t nextHoriEvent;
+  uint64_t nextEventCycle; // cycle at which the scheduler has to step again, 0 forces a recalculation
+  int busDebt; // cycles of rom/ram accesses the cpu ran ahead of the scheduler, within the current quiet stretch
+  int busRoom; // cycles that can still be added to it, 0 if not known (recalculated by the next access)
+  bool exactTiming; // no bus debt and no idle loop skipping (snes_setExactTiming)
+  // idle loop tracking (not part of the state), from the last short backward branch of the cpu on
+  uint64_t loopCycle;
+  uint32_t loopReads; // hash of the i/o reads since then
+  uint32_t loopLastReads; // and of the ones during the iteration before
+  uint16_t loopAutoJoy; // autoJoyTimer at loopCycle
+  bool loopQuiet; // no writes, no i/o reads with side effects and no scheduler steps since then
+  bool loopHvbjoy; // $4212 was read since then (its value depends on hPos and the auto-joypad timer)
   // cpu handling
   // nmi / irq
   bool hIrqEnabled;
@@ -60,7 +135,22 @@ struct Snes {
   uint16_t divideResult;
   // misc
   bool fastMem;
+  const uint8_t* accessTimes; // rom area wait states, slow or fast table depending on fastMem
   uint8_t openBus;
+  // memory map, 4K pages over the 24-bit address space
+  // pages that are plain wram/rom/sram point to host memory, NULL pages go through snes_rread/snes_write
+  uint8_t* readMap[0x1000];
+  uint8_t* writeMap[0x1000];
+  // write counters for the cpu decode cache, per 4K of wram, one for all of sram and one that rom never changes,
+  // pageWrites has the one of the memory behind each page of the map (not part of the state)
+  uint32_t* pageWrites[0x1000];
+  uint32_t ramWrites[0x20];
+  uint32_t sramWrites;
+  uint32_t romWrites;
+  // instrumentation (only updated with SNES_STATS)
+  SnesStats stats;
+  int statsTimer; // subsystem the running wall time is accounted to, SNES_TIME_COUNT outside of frames
+  uint64_t statsMark;
 };
 
 Snes* snes_init(void);
@@ -78,19 +168,36 @@ void snes_write(Snes* snes, uint32_t adr, uint8_t val);
 void snes_cpuIdle(void* mem, bool waiting);
 uint8_t snes_cpuRead(void* mem, uint32_t adr);
 void snes_cpuWrite(void* mem, uint32_t adr, uint8_t val);
+const uint8_t* snes_cpuCode(void* mem, uint32_t adr, const uint32_t** writes);
+uint8_t snes_cpuFetch(void* mem, uint32_t adr, uint8_t cached, const uint8_t* code);
+void snes_cpuLoop(void* mem, bool repeated);
+// used by the ppu worker
+void snes_publishFrame(Snes* snes, Ppu* ppu, uint32_t sequence);
 // debugging
 void snes_runCpuCycle(Snes* snes);
 void snes_runSpcCycle(Snes* snes);
+// instrumentation, getStats returns false if the core was built without SNES_STATS
+bool snes_getStats(Snes* snes, SnesStats* stats);
+void snes_resetStats(Snes* snes);
+int snes_statsSwitch(Snes* snes, int timer);
 
 // snes_other.c functions:
 
 bool snes_loadRom(Snes* snes, const uint8_t* data, int length);
 void snes_setButtonState(Snes* snes, int player, int button, bool pressed);
 void snes_setPixels(Snes* snes, uint8_t* pixelData);
+void snes_getFrameSize(Snes* snes, int* width, int* height);
+void snes_setPixelsFormat(Snes* snes, uint8_t* pixelData, int pitch, int format, int* width, int* height);
+void snes_setFrameOutput(Snes* snes, FrameBuffer* fb);
+void snes_setPpuThread(Snes* snes, bool enabled);
+void snes_setExactTiming(Snes* snes, bool enabled);
+void snes_setFrameSkip(Snes* snes, int frames);
+bool snes_frameRendered(Snes* snes);
 void snes_setSamples(Snes* snes, int16_t* sampleData, int samplesPerFrame);
 int snes_saveBattery(Snes* snes, uint8_t* data);
 bool snes_loadBattery(Snes* snes, uint8_t* data, int size);
 int snes_saveState(Snes* snes, uint8_t* data);
 bool snes_loadState(Snes* snes, uint8_t* data, int size);
+uint64_t snes_hash(uint64_t hash, const void* data, size_t size); // fnv-1a, start with SNES_HASH_INIT
 
 #endif
@@ -5,9 +5,15 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PPU_X86_AVX2 1
+#include <immintrin.h>
+#endif
+
 #include <ppu.h>
 #include <snes.h>
 #include <statehandler.h>
+#include <colormath.h>
 
 // array for layer definitions per mode:
 //   0-7: mode 0-7; 8: mode 1 + l3prio; 9: mode 7 + extbg
@@ -61,27 +67,31 @@ static const int spriteSizes[8][2] = {
   {16, 64}, {32, 64}, {16, 32}, {16, 32}
 };
 
-// caches & luts to reduce cpu load
-static uint32_t bright_lut[0x10];
-static uint32_t bright_now;
-static uint8_t color_clamp_lut[0x20 * 3];
-static uint8_t *color_clamp_lut_i20 = &color_clamp_lut[0x20];
-
-static int layerCache[4] = { -1, -1, -1, -1 };
-static uint16_t bg_pixel_buf[4];
-static uint8_t bg_prio_buf[4];
-static bool bg_window_state[6]; // 0-3 (bg) 4 (spr) 5 (colorwind)
-
-static void ppu_handlePixel(Ppu* ppu, int x, int y);
-static int ppu_getPixel(Ppu* ppu, int x, int y, bool sub, int* r, int* g, int* b);
+static void ppu_resolveScreen(Ppu* ppu, int actMode, const uint8_t ranks[5][4], bool sub, uint8_t* layers, uint16_t* indices);
+static void ppu_updatePalette(Ppu* ppu);
+static void ppu_updatePaletteXbgr(Ppu* ppu);
+static void ppu_composeLine(Ppu* ppu, int y);
 static uint16_t ppu_getOffsetValue(Ppu* ppu, int col, int row);
-static inline void ppu_getPixelForBgLayer(Ppu* ppu, int x, int y, int layer);
-static void ppu_handleOPT(Ppu* ppu, int layer, int* lx, int* ly);
+static void ppu_renderBgLine(Ppu* ppu, int layer, int y);
+static void ppu_fetchBgSpan(Ppu* ppu, int layer, int x, int y, uint16_t* pixels, uint8_t* prio);
+static void ppu_updateOPT(Ppu* ppu);
+static void ppu_renderMode7Line(Ppu* ppu);
 static void ppu_calculateMode7Starts(Ppu* ppu, int y);
-static int ppu_getPixelForMode7(Ppu* ppu, int x, int layer, bool priority);
-static bool ppu_getWindowState(Ppu* ppu, int layer, int x);
+static void ppu_fetchMode7Pixels(const Ppu* ppu, int32_t xPos, int32_t yPos, int32_t xStep, int32_t yStep, uint8_t* pixels);
+#ifdef PPU_X86_AVX2
+static void ppu_fetchMode7PixelsAvx2(const Ppu* ppu, int32_t xPos, int32_t yPos, int32_t xStep, int32_t yStep, uint8_t* pixels);
+static bool ppu_hasAvx2(void);
+static const bool mode7Gather = ppu_hasAvx2();
+#endif
+static void ppu_updateWindowMasks(Ppu* ppu);
+static void ppu_getWindowRange(uint64_t* mask, int left, int right, bool inversed);
 static void ppu_evaluateSprites(Ppu* ppu, int line);
+static void ppu_markSpriteDirty(Ppu* ppu, int sprite);
+static void ppu_markAllSpritesDirty(Ppu* ppu);
+static void ppu_updateSpriteLines(Ppu* ppu);
 static uint16_t ppu_getVramRemap(Ppu* ppu);
+static void ppu_markTilesDirty(Ppu* ppu, uint16_t adr);
+static const uint8_t* ppu_getTile(Ppu* ppu, int bitDepth, uint16_t adr);
 
 Ppu* ppu_init(Snes* snes) {
   Ppu* ppu = (Ppu*)malloc(sizeof(Ppu));
@@ -94,33 +104,23 @@ void ppu_free(Ppu* ppu) {
 }
 
 void ppu_reset(Ppu* ppu) {
-  // create brightness and color clamp LUTs (rendering opti)
-  for (int i = 0; i < 0x10; i++) {
-    bright_lut[i] = (i * 0x10000) / 15;
-  }
-  for (int i = 0; i < 0x20*3; i++) {
-    if (i < 0x20) {
-      color_clamp_lut[i] = 0;
-    }
-    if (i >= 0x20 && i <= 0x3f) {
-      color_clamp_lut[i] = i - 0x20; // 0 - 1f
-    }
-    if (i >= 0x40) {
-      color_clamp_lut[i] = 0x1f;
-    }
-  }
-  bright_now = bright_lut[0xf]; // default
-
+  memset(ppu->bgLinePixels, 0, sizeof(ppu->bgLinePixels));
+  memset(ppu->bgLinePrios, 0, sizeof(ppu->bgLinePrios));
+  ppu->windowMasksDirty = true;
   memset(ppu->vram, 0, sizeof(ppu->vram));
   ppu->vramPointer = 0;
   ppu->vramIncrementOnHigh = false;
   ppu->vramIncrement = 1;
   ppu->vramRemapMode = 0;
   ppu->vramReadBuffer = 0;
+  memset(ppu->tiles2bppDirty, 1, sizeof(ppu->tiles2bppDirty));
+  memset(ppu->tiles4bppDirty, 1, sizeof(ppu->tiles4bppDirty));
+  memset(ppu->tiles8bppDirty, 1, sizeof(ppu->tiles8bppDirty));
   memset(ppu->cgram, 0, sizeof(ppu->cgram));
   ppu->cgramPointer = 0;
   ppu->cgramSecondWrite = false;
   ppu->cgramBuffer = 0;
+  ppu_updatePalette(ppu);
   memset(ppu->oam, 0, sizeof(ppu->oam));
   memset(ppu->highOam, 0, sizeof(ppu->highOam));
   ppu->oamAdr = 0;
@@ -138,6 +138,7 @@ void ppu_reset(Ppu* ppu) {
   ppu->timeOver = false;
   ppu->rangeOver = false;
   ppu->objInterlace = false;
+  ppu_markAllSpritesDirty(ppu);
   for(int i = 0; i < 4; i++) {
     ppu->bgLayer[i].hScroll = 0;
     ppu->bgLayer[i].vScroll = 0;
@@ -197,6 +198,7 @@ void ppu_reset(Ppu* ppu) {
   ppu->frameOverscan = false;
   ppu->interlace = false;
   ppu->frameInterlace = false;
+  ppu->frameHires = false;
   ppu->directColor = false;
   ppu->hCount = 0;
   ppu->vCount = 0;
@@ -257,7 +259,15 @@ void ppu_handleState(Ppu* ppu, StateHandler* sh) {
     sh_handleBytes(sh, &ppu->windowLayer[i].maskLogic, NULL);
   }
   sh_handleWordArray(sh, ppu->vram, 0x8000);
+  // the decoded tiles, sprite lines, window masks and frame hires flag are not part of the state
+  ppu_markAllSpritesDirty(ppu);
+  ppu->frameHires = ppu->pseudoHires || ppu->mode == 5 || ppu->mode == 6;
+  ppu->windowMasksDirty = true;
+  memset(ppu->tiles2bppDirty, 1, sizeof(ppu->tiles2bppDirty));
+  memset(ppu->tiles4bppDirty, 1, sizeof(ppu->tiles4bppDirty));
+  memset(ppu->tiles8bppDirty, 1, sizeof(ppu->tiles8bppDirty));
   sh_handleWordArray(sh, ppu->cgram, 0x100);
+  ppu_updatePalette(ppu);
   sh_handleWordArray(sh, ppu->oam, 0x100);
   sh_handleByteArray(sh, ppu->highOam, 0x20);
   sh_handleByteArray(sh, ppu->objPixelBuffer, 256);
@@ -286,179 +296,202 @@ void ppu_handleFrameStart(Ppu* ppu) {
   ppu->rangeOver = false;
   ppu->timeOver = false;
   ppu->evenFrame = !ppu->evenFrame;
+  ppu->frameHires = false;
 }
 
 void ppu_runLine(Ppu* ppu, int line) {
   // called for lines 1-224/239
-  // evaluate sprites
+  ppu_evaluateLine(ppu, line);
+  ppu_renderLine(ppu, line);
+}
+
+void ppu_evaluateLine(Ppu* ppu, int line) {
+  // the part of a line that changes state the cpu can see: sprite evaluation (range/time over) and mode 7 starts
   memset(ppu->objPixelBuffer, 0, sizeof(ppu->objPixelBuffer));
   if(!ppu->forcedBlank) ppu_evaluateSprites(ppu, line - 1);
-  // NOTE: if frameskipping, return here. (ppu_evaluateSprites() must run regardless)
-  // actual line
+  if(ppu->pseudoHires || ppu->mode == 5 || ppu->mode == 6) ppu->frameHires = true;
   if(ppu->mode == 7) ppu_calculateMode7Starts(ppu, line);
-  layerCache[0] = layerCache[1] = layerCache[2] = layerCache[3] = -1;
-  for(int x = 0; x < 256; x+=4) {
-    ppu_handlePixel(ppu, x + 0, line);
-    ppu_handlePixel(ppu, x + 1, line);
-    ppu_handlePixel(ppu, x + 2, line);
-    ppu_handlePixel(ppu, x + 3, line);
-  }
 }
 
-static void ppu_handlePixel(Ppu* ppu, int x, int y) {
-  int r = 0, r2 = 0;
-  int g = 0, g2 = 0;
-  int b = 0, b2 = 0;
-  if(!ppu->forcedBlank) {
-    int mainLayer = ppu_getPixel(ppu, x, y, false, &r, &g, &b);
-    bool colorWindowState = ppu_getWindowState(ppu, 5, x);
-    if(
-      ppu->clipMode == 3 ||
-      (ppu->clipMode == 2 && colorWindowState) ||
-      (ppu->clipMode == 1 && !colorWindowState)
-    ) {
-      r = 0;
-      g = 0;
-      b = 0;
-    }
-    int secondLayer = 5; // backdrop
-    bool mathEnabled = mainLayer < 6 && ppu->mathEnabled[mainLayer] && !(
-      ppu->preventMathMode == 3 ||
-      (ppu->preventMathMode == 2 && colorWindowState) ||
-      (ppu->preventMathMode == 1 && !colorWindowState)
-    );
-    if((mathEnabled && ppu->addSubscreen) || ppu->pseudoHires || ppu->mode == 5 || ppu->mode == 6) {
-      secondLayer = ppu_getPixel(ppu, x, y, true, &r2, &g2, &b2);
-    }
-    // TODO: subscreen pixels can be clipped to black as well
-    // TODO: math for subscreen pixels (add/sub sub to main)
-    if(mathEnabled) {
-      if(ppu->subtractColor) {
-        r -= (ppu->addSubscreen && secondLayer != 5) ? r2 : ppu->fixedColorR;
-        g -= (ppu->addSubscreen && secondLayer != 5) ? g2 : ppu->fixedColorG;
-        b -= (ppu->addSubscreen && secondLayer != 5) ? b2 : ppu->fixedColorB;
-      } else {
-        r += (ppu->addSubscreen && secondLayer != 5) ? r2 : ppu->fixedColorR;
-        g += (ppu->addSubscreen && secondLayer != 5) ? g2 : ppu->fixedColorG;
-        b += (ppu->addSubscreen && secondLayer != 5) ? b2 : ppu->fixedColorB;
-      }
-      if(ppu->halfColor && (secondLayer != 5 || !ppu->addSubscreen)) {
-        r >>= 1;
-        g >>= 1;
-        b >>= 1;
-      }
-      if(r > 31) r = 31;
-      if(g > 31) g = 31;
-      if(b > 31) b = 31;
-      if(r < 0) r = 0;
-      if(g < 0) g = 0;
-      if(b < 0) b = 0;
-    }
-    if(!(ppu->pseudoHires || ppu->mode == 5 || ppu->mode == 6)) {
-      r2 = r; g2 = g; b2 = b;
+void ppu_renderLine(Ppu* ppu, int line) {
+  // skipped when frameskipping (ppu_evaluateLine() has to run regardless)
+  // actual line: fetch the whole line of every visible bg layer up front, then composite it
+  if(ppu->mode == 7) {
+    if(!ppu->forcedBlank) ppu_renderMode7Line(ppu);
+  } else if(!ppu->forcedBlank) {
+    if(ppu->mode == 2 || ppu->mode == 4 || ppu->mode == 6) ppu_updateOPT(ppu);
+    for(int layer = 0; layer < 4; layer++) {
+      int bitDepth = bitDepthsPerMode[ppu->mode][layer];
+      if(bitDepth != 2 && bitDepth != 4 && bitDepth != 8) continue;
+      if(!ppu->layer[layer].mainScreenEnabled && !ppu->layer[layer].subScreenEnabled) continue;
+      ppu_renderBgLine(ppu, layer, line);
     }
   }
-  int row = (y - 1) + (ppu->evenFrame ? 0 : 239);
-  ppu->pixelBuffer[row * 2048 + x * 8 + 0 + 1] = ((b2 << 3) | (b2 >> 2)) * ppu->brightness / 15;
-  ppu->pixelBuffer[row * 2048 + x * 8 + 1 + 1] = ((g2 << 3) | (g2 >> 2)) * ppu->brightness / 15;
-  ppu->pixelBuffer[row * 2048 + x * 8 + 2 + 1] = ((r2 << 3) | (r2 >> 2)) * ppu->brightness / 15;
-  ppu->pixelBuffer[row * 2048 + x * 8 + 4 + 1] = ((b << 3) | (b >> 2)) * ppu->brightness / 15;
-  ppu->pixelBuffer[row * 2048 + x * 8 + 5 + 1] = ((g << 3) | (g >> 2)) * ppu->brightness / 15;
-  ppu->pixelBuffer[row * 2048 + x * 8 + 6 + 1] = ((r << 3) | (r >> 2)) * ppu->brightness / 15;
+  ppu_composeLine(ppu, line);
 }
 
-
-static int ppu_getPixel(Ppu* ppu, int x, int y, bool sub, int* r, int* g, int* b) {
-  // figure out which color is on this location on main- or subscreen, sets it in r, g, b
-  // returns which layer it is: 0-3 for bg layer, 4 or 6 for sprites (depending on palette), 5 for backdrop
-  int actMode = ppu->mode == 1 && ppu->bg3priority ? 8 : ppu->mode;
-  actMode = ppu->mode == 7 && ppu->m7extBg ? 9 : actMode;
-  int layer = 5;
-  int pixel = 0;
-  for(int i = 0; i < layerCountPerMode[actMode]; i++) {
-    int curLayer = layersPerMode[actMode][i];
-    int curPriority = prioritysPerMode[actMode][i];
-    bool layerActive = false;
-    if(!sub) {
-      layerActive = ppu->layer[curLayer].mainScreenEnabled && (
-        !ppu->layer[curLayer].mainScreenWindowed || !bg_window_state[curLayer]
-      );
-    } else {
-      layerActive = ppu->layer[curLayer].subScreenEnabled && (
-        !ppu->layer[curLayer].subScreenWindowed || !bg_window_state[curLayer]
-      );
-    }
-    if(layerActive) {
-      if(curLayer < 4) {
-        // bg layer
-        int lx = x;
-        int ly = y;
-        if(ppu->bgLayer[curLayer].mosaicEnabled && ppu->mosaicSize > 1) {
-          lx -= lx % ppu->mosaicSize;
-          ly -= (ly - ppu->mosaicStartLine) % ppu->mosaicSize;
-        }
-        if(ppu->mode == 7) {
-          pixel = ppu_getPixelForMode7(ppu, lx, curLayer, curPriority);
-        } else {
-          lx += ppu->bgLayer[curLayer].hScroll;
-          if(ppu->mode == 5 || ppu->mode == 6) {
-            lx *= 2;
-            lx += (sub || ppu->bgLayer[curLayer].mosaicEnabled) ? 0 : 1;
-            if(ppu->interlace) {
-              ly *= 2;
-              ly += (ppu->evenFrame || ppu->bgLayer[curLayer].mosaicEnabled) ? 0 : 1;
-            }
-          }
-          ly += ppu->bgLayer[curLayer].vScroll;
-          if(ppu->mode == 2 || ppu->mode == 4 || ppu->mode == 6) {
-            ppu_handleOPT(ppu, curLayer, &lx, &ly);
-          }
-          if (lx != layerCache[curLayer]) {
-            ppu_getPixelForBgLayer(ppu, lx & 0x3ff, ly & 0x3ff, curLayer);
-            layerCache[curLayer] = lx;
-          }
-          pixel = (bg_prio_buf[curLayer] == curPriority) ? bg_pixel_buf[curLayer] : 0;
+static void ppu_resolveScreen(Ppu* ppu, int actMode, const uint8_t ranks[5][4], bool sub, uint8_t* layers, uint16_t* indices) {
+  // finds the frontmost opaque layer of main- or subscreen for the whole line and its palette index
+  // layers gets 0-3 for bg layer, 4 or 6 for sprites (depending on palette), 5 for backdrop
+  uint8_t bestRank[256];
+  memset(bestRank, 0xff, sizeof(bestRank));
+  memset(indices, 0, 256 * sizeof(uint16_t));
+  memset(layers, 5, 256);
+  bool hires = ppu->mode == 5 || ppu->mode == 6;
+  for(int layer = 0; layer < 5; layer++) {
+    const uint8_t* rank = ranks[layer];
+    if(rank[0] == 0xff && rank[1] == 0xff && rank[2] == 0xff && rank[3] == 0xff) continue;
+    bool enabled = sub ? ppu->layer[layer].subScreenEnabled : ppu->layer[layer].mainScreenEnabled;
+    bool windowed = sub ? ppu->layer[layer].subScreenWindowed : ppu->layer[layer].mainScreenWindowed;
+    if(!enabled) continue;
+    // the layer shows where its window mask is clear (when windowed)
+    uint64_t active[4];
+    for(int i = 0; i < 4; i++) active[i] = windowed ? ~ppu->windowMasks[layer][i] : ~0ULL;
+    if((active[0] | active[1] | active[2] | active[3]) == 0) continue;
+    if(layer == 4) {
+      for(int x = 0; x < 256; x++) {
+        uint8_t pixel = ppu->objPixelBuffer[x];
+        uint8_t r = rank[ppu->objPriorityBuffer[x]];
+        if(pixel != 0 && r < bestRank[x] && ((active[x >> 6] >> (x & 63)) & 1)) {
+          bestRank[x] = r;
+          indices[x] = pixel;
+          layers[x] = pixel < 0xc0 ? 6 : 4; // sprites with palette color < 0xc0
         }
-      } else {
-        // get a pixel from the sprite buffer
-        pixel = 0;
-        if(ppu->objPriorityBuffer[x] == curPriority) pixel = ppu->objPixelBuffer[x];
       }
-    }
-    if(pixel > 0) {
-      layer = curLayer;
-      break;
+      continue;
+    }
+    const uint16_t* pixels = ppu->bgLinePixels[layer];
+    const uint8_t* prios = ppu->bgLinePrios[layer];
+    bool mosaic = ppu->bgLayer[layer].mosaicEnabled && ppu->mosaicSize > 1;
+    // 8bpp layers in direct color mode index the direct colors with all 11 bits
+    bool direct = ppu->directColor && bitDepthsPerMode[actMode][layer] == 8;
+    uint16_t indexMask = direct ? 0x7ff : 0xff;
+    uint16_t indexBase = direct ? 0x100 : 0;
+    // line buffers are 512 wide in mode 5/6, subscreen on the even and mainscreen on the odd half-pixels
+    int half = (sub || ppu->bgLayer[layer].mosaicEnabled) ? 0 : 1;
+    for(int x = 0; x < 256; x++) {
+      int lx = mosaic ? x - x % ppu->mosaicSize : x;
+      if(hires) lx = lx * 2 + half;
+      uint16_t pixel = pixels[lx];
+      uint8_t r = rank[prios[lx]];
+      if(pixel != 0 && r < bestRank[x] && ((active[x >> 6] >> (x & 63)) & 1)) {
+        bestRank[x] = r;
+        indices[x] = (pixel & indexMask) + indexBase;
+        layers[x] = layer;
+      }
     }
   }
-  if(ppu->directColor && layer < 4 && bitDepthsPerMode[actMode][layer] == 8) {
-    *r = ((pixel & 0x7) << 2) | ((pixel & 0x100) >> 7);
-    *g = ((pixel & 0x38) >> 1) | ((pixel & 0x200) >> 8);
-    *b = ((pixel & 0xc0) >> 3) | ((pixel & 0x400) >> 8);
-  } else {
-    uint16_t color = ppu->cgram[pixel & 0xff];
-    *r = color & 0x1f;
-    *g = (color >> 5) & 0x1f;
-    *b = (color >> 10) & 0x1f;
+}
+
+static void ppu_composeLine(Ppu* ppu, int y) {
+  // pass 1 resolves main- and subscreen for the line, pass 2 does clipping and color math
+  uint8_t mainLayers[256];
+  uint8_t subLayers[256];
+  uint16_t mainIndices[256]; // into ppu->palette
+  uint16_t subIndices[256];
+  bool hires = ppu->pseudoHires || ppu->mode == 5 || ppu->mode == 6;
+  // clip to black and prevent math as bits over the line, from the color window
+  uint64_t clip[4];
+  uint64_t preventMath[4];
+  if(!ppu->forcedBlank) {
+    if(ppu->windowMasksDirty) ppu_updateWindowMasks(ppu);
+    const uint64_t* colorWindow = ppu->windowMasks[5];
+    for(int i = 0; i < 4; i++) {
+      const uint64_t modes[4] = {0, ~colorWindow[i], colorWindow[i], ~0ULL};
+      clip[i] = modes[ppu->clipMode];
+      preventMath[i] = modes[ppu->preventMathMode];
+    }
+    int actMode = ppu->mode == 1 && ppu->bg3priority ? 8 : ppu->mode;
+    actMode = ppu->mode == 7 && ppu->m7extBg ? 9 : actMode;
+    // position of every (layer, priority) pair in the mode's front-to-back order, 0xff if not drawn
+    uint8_t ranks[5][4];
+    memset(ranks, 0xff, sizeof(ranks));
+    for(int i = 0; i < layerCountPerMode[actMode]; i++) {
+      ranks[layersPerMode[actMode][i]][prioritysPerMode[actMode][i]] = i;
+    }
+    ppu_resolveScreen(ppu, actMode, ranks, false, mainLayers, mainIndices);
+    // the subscreen is only ever looked at when it is added/subtracted or shown in hires
+    if(ppu->addSubscreen || hires) ppu_resolveScreen(ppu, actMode, ranks, true, subLayers, subIndices);
   }
-  if(layer == 4 && pixel < 0xc0) layer = 6; // sprites with palette color < 0xc0
-  return layer;
+  int row = (y - 1) + (ppu->evenFrame ? 0 : 239);
+  uint8_t* out = &ppu->pixelBuffer[row * 2048];
+  if(ppu->forcedBlank) {
+    memset(out, 0, 256 * 8);
+    return;
+  }
+  // per pixel inputs for the color math kernel
+  uint8_t clipMask[256];
+  uint8_t mathMask[256];
+  uint8_t layerMath[8] = {0};
+  for(int layer = 0; layer < 6; layer++) layerMath[layer] = ppu->mathEnabled[layer] ? 0xff : 0;
+  uint8_t anySet = 0;
+  for(int x = 0; x < 256; x++) {
+    clipMask[x] = ((clip[x >> 6] >> (x & 63)) & 1) ? 0xff : 0;
+    mathMask[x] = ((preventMath[x >> 6] >> (x & 63)) & 1) ? 0 : layerMath[mainLayers[x]];
+    anySet |= clipMask[x] | mathMask[x];
+  }
+  if(!hires && anySet == 0) {
+    // nothing to blend, both half-pixels come straight from the palette
+    if(ppu->paletteXbgrBrightness != ppu->brightness) ppu_updatePaletteXbgr(ppu);
+    for(int x = 0; x < 256; x++) {
+      memcpy(&out[x * 8], ppu->paletteXbgr[mainIndices[x]], 4);
+      memcpy(&out[x * 8 + 4], ppu->paletteXbgr[mainIndices[x]], 4);
+    }
+    return;
+  }
+  uint8_t halfMask[256];
+  uint16_t mainColors[256];
+  uint16_t subColors[256];
+  uint16_t operands[256]; // subscreen or fixed color
+  uint16_t fixedColor = ppu->fixedColorR | (ppu->fixedColorG << 5) | (ppu->fixedColorB << 10);
+  bool subResolved = ppu->addSubscreen || hires;
+  for(int x = 0; x < 256; x++) {
+    mainColors[x] = ppu->palette[mainIndices[x]];
+    subColors[x] = subResolved ? ppu->palette[subIndices[x]] : 0;
+    // TODO: subscreen pixels can be clipped to black as well
+    // TODO: math for subscreen pixels (add/sub sub to main)
+    bool subUsed = ppu->addSubscreen && subLayers[x] != 5; // backdrop uses the fixed color
+    operands[x] = subUsed ? subColors[x] : fixedColor;
+    halfMask[x] = ppu->halfColor && (subUsed || !ppu->addSubscreen) ? 0xff : 0;
+  }
+  ColorMathLine line;
+  line.main = mainColors;
+  line.sub = operands;
+  line.left = hires ? subColors : NULL;
+  line.clip = clipMask;
+  line.math = mathMask;
+  line.half = halfMask;
+  line.subtract = ppu->subtractColor;
+  line.brightness = ppu->brightness;
+  colormath_renderLine(&line, out, 256);
 }
 
-static void ppu_handleOPT(Ppu* ppu, int layer, int* lx, int* ly) {
-  int x = *lx;
-  int y = *ly;
-  int column = 0;
-  if(ppu->mode == 6) {
-    column = ((x - (x & 0xf)) - ((ppu->bgLayer[layer].hScroll * 2) & 0xfff0)) >> 4;
-  } else {
-    column = ((x - (x & 0x7)) - (ppu->bgLayer[layer].hScroll & 0xfff8)) >> 3;
+static void ppu_updatePalette(Ppu* ppu) {
+  for(int i = 0; i < 0x100; i++) ppu->palette[i] = ppu->cgram[i] & 0x7fff;
+  for(int i = 0; i < 0x800; i++) {
+    // bbgggrrr with the palette number as the extra low bits (b in bit 10, g in 9, r in 8)
+    int r = ((i & 0x7) << 2) | ((i & 0x100) >> 7);
+    int g = ((i & 0x38) >> 1) | ((i & 0x200) >> 8);
+    int b = ((i & 0xc0) >> 3) | ((i & 0x400) >> 8);
+    ppu->palette[0x100 + i] = r | (g << 5) | (b << 10);
   }
-  if(column > 0) {
-    // fetch offset values from layer 3 tilemap
-    int valid = layer == 0 ? 0x2000 : 0x4000;
+  ppu->paletteXbgrBrightness = -1;
+}
+
+static void ppu_updatePaletteXbgr(Ppu* ppu) {
+  for(int i = 0; i < 0x900; i++) colormath_toXbgr(ppu->palette[i], ppu->brightness, ppu->paletteXbgr[i]);
+  ppu->paletteXbgrBrightness = ppu->brightness;
+}
+
+static void ppu_updateOPT(Ppu* ppu) {
+  // the offsets for column c (of 8 pixels, 16 half-pixels in mode 6) come from entry c - 1 of the bg3 tilemap rows
+  ppu->optHOffsets[0] = 0;
+  ppu->optVOffsets[0] = 0;
+  for(int column = 1; column < 33; column++) {
     uint16_t hOffset = ppu_getOffsetValue(ppu, column - 1, 0);
     uint16_t vOffset = 0;
     if(ppu->mode == 4) {
+      // one value, either horizontal or vertical
       if(hOffset & 0x8000) {
         vOffset = hOffset;
         hOffset = 0;
@@ -466,14 +499,8 @@ static void ppu_handleOPT(Ppu* ppu, int layer, int* lx, int* ly) {
     } else {
       vOffset = ppu_getOffsetValue(ppu, column - 1, 1);
     }
-    if(ppu->mode == 6) {
-      // TODO: not sure if correct
-      if(hOffset & valid) *lx = (((hOffset & 0x3f8) + (column * 8)) * 2) | (x & 0xf);
-    } else {
-      if(hOffset & valid) *lx = ((hOffset & 0x3f8) + (column * 8)) | (x & 0x7);
-    }
-    // TODO: not sure if correct for interlace
-    if(vOffset & valid) *ly = (vOffset & 0x3ff) + (y - ppu->bgLayer[layer].vScroll);
+    ppu->optHOffsets[column] = hOffset;
+    ppu->optVOffsets[column] = vOffset;
   }
 }
 
@@ -488,7 +515,62 @@ static uint16_t ppu_getOffsetValue(Ppu* ppu, int col, int row) {
   return ppu->vram[tilemapAdr & 0x7fff];
 }
 
-static inline void ppu_getPixelForBgLayer(Ppu* ppu, int x, int y, int layer) {
+static void ppu_renderBgLine(Ppu* ppu, int layer, int y) {
+  // fills bgLinePixels/bgLinePrios for this layer, indexed by (unmosaiced) screen x, or half-pixel in mode 5/6
+  BgLayer* bgLayer = &ppu->bgLayer[layer];
+  bool hires = ppu->mode == 5 || ppu->mode == 6;
+  int width = hires ? 512 : 256;
+  int ly = y;
+  if(bgLayer->mosaicEnabled && ppu->mosaicSize > 1) {
+    ly -= (ly - ppu->mosaicStartLine) % ppu->mosaicSize;
+  }
+  if(hires && ppu->interlace) {
+    ly *= 2;
+    ly += (ppu->evenFrame || bgLayer->mosaicEnabled) ? 0 : 1;
+  }
+  ly += bgLayer->vScroll;
+  int startX = hires ? bgLayer->hScroll * 2 : bgLayer->hScroll;
+  uint16_t* pixels = ppu->bgLinePixels[layer];
+  uint8_t* prios = ppu->bgLinePrios[layer];
+  uint16_t span[8];
+  uint8_t spanPrio = 0;
+  if(ppu->mode == 2 || ppu->mode == 4 || ppu->mode == 6) {
+    // offset-per-tile can move every column somewhere else, columns start at tile boundaries so a span never crosses one
+    int valid = layer == 0 ? 0x2000 : 0x4000;
+    int columnShift = hires ? 4 : 3;
+    int scrollColumns = startX & (hires ? 0xfff0 : 0xfff8);
+    for(int i = 0; i < width;) {
+      int x = startX + i;
+      int lx = x;
+      int py = ly;
+      int column = ((x & ~((1 << columnShift) - 1)) - scrollColumns) >> columnShift;
+      uint16_t hOffset = ppu->optHOffsets[column];
+      uint16_t vOffset = ppu->optVOffsets[column];
+      // TODO: not sure if correct for mode 6
+      if(hOffset & valid) lx = ((((hOffset & 0x3f8) + (column * 8)) << (columnShift - 3)) | (x & ((1 << columnShift) - 1)));
+      // TODO: not sure if correct for interlace
+      if(vOffset & valid) py = (vOffset & 0x3ff) + (ly - bgLayer->vScroll);
+      lx &= 0x3ff;
+      ppu_fetchBgSpan(ppu, layer, lx, py & 0x3ff, span, &spanPrio);
+      for(int j = lx & 7; j < 8 && i < width; j++, i++) {
+        pixels[i] = span[j];
+        prios[i] = spanPrio;
+      }
+    }
+    return;
+  }
+  for(int i = 0; i < width;) {
+    int lx = (startX + i) & 0x3ff;
+    ppu_fetchBgSpan(ppu, layer, lx, ly & 0x3ff, span, &spanPrio);
+    for(int j = lx & 7; j < 8 && i < width; j++, i++) {
+      pixels[i] = span[j];
+      prios[i] = spanPrio;
+    }
+  }
+}
+
+static void ppu_fetchBgSpan(Ppu* ppu, int layer, int x, int y, uint16_t* pixels, uint8_t* prio) {
+  // decodes the 8 pixels of the tile row containing x, y
   // figure out address of tilemap word and read it
   bool wideTiles = ppu->bgLayer[layer].bigTiles || ppu->mode == 5 || ppu->mode == 6;
   int tileBitsX = wideTiles ? 4 : 3;
@@ -500,15 +582,15 @@ static inline void ppu_getPixelForBgLayer(Ppu* ppu, int x, int y, int layer) {
   if((y & tileHighBitY) && ppu->bgLayer[layer].tilemapHigher) tilemapAdr += ppu->bgLayer[layer].tilemapWider ? 0x800 : 0x400;
   uint16_t tile = ppu->vram[tilemapAdr & 0x7fff];
   // check priority, get palette
-  int tilePrio = (tile >> 13) & 1;
+  *prio = (tile >> 13) & 1;
   int paletteNum = (tile & 0x1c00) >> 10;
-  // figure out position within tile
+  // figure out row within tile
   int row = (tile & 0x8000) ? 7 - (y & 0x7) : (y & 0x7);
-  int col = (tile & 0x4000) ? (x & 0x7) : 7 - (x & 0x7);
+  bool hFlip = tile & 0x4000;
   int tileNum = tile & 0x3ff;
   if(wideTiles) {
     // if unflipped right half of tile, or flipped left half of tile
-    if(((bool) (x & 8)) ^ ((bool) (tile & 0x4000))) tileNum += 1;
+    if(((bool) (x & 8)) ^ hFlip) tileNum += 1;
   }
   if(ppu->bgLayer[layer].bigTiles) {
     // if unflipped bottom half of tile, or flipped upper half of tile
@@ -517,46 +599,35 @@ static inline void ppu_getPixelForBgLayer(Ppu* ppu, int x, int y, int layer) {
   // read tiledata, ajust palette for mode 0
   int bitDepth = bitDepthsPerMode[ppu->mode][layer];
   if(ppu->mode == 0) paletteNum += 8 * layer;
-  // plane 1 (always)
-  const uint16_t base_addr = ppu->bgLayer[layer].tileAdr + ((tileNum & 0x3ff) * 4 * bitDepth);
-  const int bit2shift = 8 + col;
-  int pixel = 0;
-  switch (bitDepth) {
-    case 2: {
-        uint16_t plane = ppu->vram[(base_addr + row) & 0x7fff];
-        pixel = (plane >> col) & 1;
-        pixel |= ((plane >> bit2shift) & 1) << 1;
-    } break;
-    case 4: {
-        uint16_t plane = ppu->vram[(base_addr + row) & 0x7fff];
-        pixel = (plane >> col) & 1;
-        pixel |= ((plane >> bit2shift) & 1) << 1;
-
-        plane = ppu->vram[(base_addr + 8 + row) & 0x7fff];
-        pixel |= ((plane >> col) & 1) << 2;
-        pixel |= ((plane >> bit2shift) & 1) << 3;
-    } break;
-    case 8: {
-        uint16_t plane = ppu->vram[(base_addr + row) & 0x7fff];
-        pixel = (plane >> col) & 1;
-        pixel |= ((plane >> bit2shift) & 1) << 1;
-
-        plane = ppu->vram[(base_addr + 8 + row) & 0x7fff];
-        pixel |= ((plane >> col) & 1) << 2;
-        pixel |= ((plane >> bit2shift) & 1) << 3;
-
-        plane = ppu->vram[(base_addr + 16 + row) & 0x7fff];
-        pixel |= ((plane >> col) & 1) << 4;
-        pixel |= ((plane >> bit2shift) & 1) << 5;
+  const uint8_t* tileRow = ppu_getTile(ppu, bitDepth, ppu->bgLayer[layer].tileAdr + ((tileNum & 0x3ff) * 4 * bitDepth)) + row * 8;
+  int paletteBase = paletteNum << bitDepth;
+  for(int i = 0; i < 8; i++) {
+    int pixel = tileRow[hFlip ? 7 - i : i];
+    // cgram index, or 0 if transparent, palette number in bits 10-8 for 8-color layers
+    pixels[i] = (pixel == 0) ? 0 : paletteBase + pixel;
+  }
+}
 
-        plane = ppu->vram[(base_addr + 24 + row) & 0x7fff];
-        pixel |= ((plane >> col) & 1) << 6;
-        pixel |= ((plane >> bit2shift) & 1) << 7;
-    } break;
+static void ppu_renderMode7Line(Ppu* ppu) {
+  // the map position of screen x is start + a/c * x (or * (255 - x) when flipped), stepped per pixel in 8.8 fixed point
+  int32_t xStep = ppu->m7xFlip ? -ppu->m7matrix[0] : ppu->m7matrix[0];
+  int32_t yStep = ppu->m7xFlip ? -ppu->m7matrix[2] : ppu->m7matrix[2];
+  int32_t xPos = ppu->m7startX + (ppu->m7xFlip ? ppu->m7matrix[0] * 255 : 0);
+  int32_t yPos = ppu->m7startY + (ppu->m7xFlip ? ppu->m7matrix[2] * 255 : 0);
+  uint8_t pixels[256];
+#ifdef PPU_X86_AVX2
+  if(mode7Gather) ppu_fetchMode7PixelsAvx2(ppu, xPos, yPos, xStep, yStep, pixels);
+  else
+#endif
+  ppu_fetchMode7Pixels(ppu, xPos, yPos, xStep, yStep, pixels);
+  // fetched once for both layers: bg1 gets the full 8-bit pixel, extbg bg2 the low 7 bits with bit 7 as priority
+  for(int x = 0; x < 256; x++) {
+    uint8_t pixel = pixels[x];
+    ppu->bgLinePixels[0][x] = pixel;
+    ppu->bgLinePrios[0][x] = 0;
+    ppu->bgLinePixels[1][x] = pixel & 0x7f;
+    ppu->bgLinePrios[1][x] = pixel >> 7;
   }
-  // return cgram index, or 0 if transparent, palette number in bits 10-8 for 8-color layers
-  bg_pixel_buf[layer] = (pixel == 0) ? 0 : (paletteNum << bitDepth) + pixel;
-  bg_prio_buf[layer] = tilePrio;
 }
 
 static void ppu_calculateMode7Starts(Ppu* ppu, int y) {
@@ -588,89 +659,152 @@ static void ppu_calculateMode7Starts(Ppu* ppu, int y) {
   );
 }
 
-static int ppu_getPixelForMode7(Ppu* ppu, int x, int layer, bool priority) {
-  uint8_t rx = ppu->m7xFlip ? 255 - x : x;
-  int xPos = (ppu->m7startX + ppu->m7matrix[0] * rx) >> 8;
-  int yPos = (ppu->m7startY + ppu->m7matrix[2] * rx) >> 8;
-  bool outsideMap = xPos < 0 || xPos >= 1024 || yPos < 0 || yPos >= 1024;
-  xPos &= 0x3ff;
-  yPos &= 0x3ff;
-  if(!ppu->m7largeField) outsideMap = false;
-  uint8_t tile = outsideMap ? 0 : ppu->vram[(yPos >> 3) * 128 + (xPos >> 3)] & 0xff;
-  uint8_t pixel = outsideMap && !ppu->m7charFill ? 0 : ppu->vram[tile * 64 + (yPos & 7) * 8 + (xPos & 7)] >> 8;
-  if(layer == 1) {
-    if(((bool) (pixel & 0x80)) != priority) return 0;
-    return pixel & 0x7f;
+static void ppu_fetchMode7Pixels(const Ppu* ppu, int32_t xPos, int32_t yPos, int32_t xStep, int32_t yStep, uint8_t* pixels) {
+  // tilemap bytes are the low bytes of the first 16K words, tile pixels the high bytes
+  // outside the 1024x1024 map, large field gives tile 0 (char fill) or transparency, otherwise the map repeats
+  for(int x = 0; x < 256; x += 8) {
+    for(int i = 0; i < 8; i++) {
+      int mapX = xPos >> 8;
+      int mapY = yPos >> 8;
+      bool outsideMap = ppu->m7largeField && ((mapX | mapY) & ~0x3ff) != 0;
+      mapX &= 0x3ff;
+      mapY &= 0x3ff;
+      uint8_t tile = outsideMap ? 0 : ppu->vram[(mapY >> 3) * 128 + (mapX >> 3)] & 0xff;
+      uint8_t pixel = ppu->vram[tile * 64 + (mapY & 7) * 8 + (mapX & 7)] >> 8;
+      pixels[x + i] = outsideMap && !ppu->m7charFill ? 0 : pixel;
+      xPos += xStep;
+      yPos += yStep;
+    }
   }
-  return pixel;
 }
 
-static bool ppu_getWindowState(Ppu* ppu, int layer, int x) {
-  if(!ppu->windowLayer[layer].window1enabled && !ppu->windowLayer[layer].window2enabled) {
-    return false;
-  }
-  if(ppu->windowLayer[layer].window1enabled && !ppu->windowLayer[layer].window2enabled) {
-    bool test = x >= ppu->window1left && x <= ppu->window1right;
-    return ppu->windowLayer[layer].window1inversed ? !test : test;
+#ifdef PPU_X86_AVX2
+
+static bool ppu_hasAvx2(void) {
+  // runs from a static initializer, possibly before the one of libgcc that fills in the cpu features
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+
+__attribute__((target("avx2")))
+static void ppu_fetchMode7PixelsAvx2(const Ppu* ppu, int32_t xPos, int32_t yPos, int32_t xStep, int32_t yStep, uint8_t* pixels) {
+  // 8 pixels per step, both lookups as dword gathers on vram (indices stay below 0x4000, so they never read past it)
+  const int* vram = (const int*) ppu->vram;
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i mapMask = _mm256_set1_epi32(0x3ff);
+  const __m256i byteMask = _mm256_set1_epi32(0xff);
+  const __m256i seven = _mm256_set1_epi32(7);
+  const __m256i largeField = _mm256_set1_epi32(ppu->m7largeField ? -1 : 0);
+  const __m256i charFill = _mm256_set1_epi32(ppu->m7charFill ? -1 : 0);
+  __m256i xs = _mm256_add_epi32(_mm256_set1_epi32(xPos), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(xStep)));
+  __m256i ys = _mm256_add_epi32(_mm256_set1_epi32(yPos), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(yStep)));
+  const __m256i xStep8 = _mm256_set1_epi32(xStep * 8);
+  const __m256i yStep8 = _mm256_set1_epi32(yStep * 8);
+  for(int x = 0; x < 256; x += 8) {
+    __m256i mapX = _mm256_srai_epi32(xs, 8);
+    __m256i mapY = _mm256_srai_epi32(ys, 8);
+    __m256i outside = _mm256_andnot_si256(
+      _mm256_cmpeq_epi32(_mm256_andnot_si256(mapMask, _mm256_or_si256(mapX, mapY)), _mm256_setzero_si256()), largeField
+    );
+    mapX = _mm256_and_si256(mapX, mapMask);
+    mapY = _mm256_and_si256(mapY, mapMask);
+    __m256i mapIndex = _mm256_add_epi32(_mm256_slli_epi32(_mm256_srli_epi32(mapY, 3), 7), _mm256_srli_epi32(mapX, 3));
+    __m256i tile = _mm256_and_si256(_mm256_i32gather_epi32(vram, mapIndex, 2), byteMask);
+    tile = _mm256_andnot_si256(outside, tile);
+    __m256i pixelIndex = _mm256_add_epi32(
+      _mm256_slli_epi32(tile, 6),
+      _mm256_add_epi32(_mm256_slli_epi32(_mm256_and_si256(mapY, seven), 3), _mm256_and_si256(mapX, seven))
+    );
+    __m256i pixel = _mm256_and_si256(_mm256_srli_epi32(_mm256_i32gather_epi32(vram, pixelIndex, 2), 8), byteMask);
+    pixel = _mm256_andnot_si256(_mm256_andnot_si256(charFill, outside), pixel);
+    // dwords to bytes, each 128-bit half ends up in its low 4 bytes
+    __m256i packed = _mm256_packus_epi16(_mm256_packus_epi32(pixel, pixel), _mm256_setzero_si256());
+    uint32_t lo = _mm_cvtsi128_si32(_mm256_castsi256_si128(packed));
+    uint32_t hi = _mm_cvtsi128_si32(_mm256_extracti128_si256(packed, 1));
+    memcpy(&pixels[x], &lo, 4);
+    memcpy(&pixels[x + 4], &hi, 4);
+    xs = _mm256_add_epi32(xs, xStep8);
+    ys = _mm256_add_epi32(ys, yStep8);
   }
-  if(!ppu->windowLayer[layer].window1enabled && ppu->windowLayer[layer].window2enabled) {
-    bool test = x >= ppu->window2left && x <= ppu->window2right;
-    return ppu->windowLayer[layer].window2inversed ? !test : test;
+}
+
+#endif
+
+static void ppu_updateWindowMasks(Ppu* ppu) {
+  for(int layer = 0; layer < 6; layer++) {
+    WindowLayer* wl = &ppu->windowLayer[layer];
+    uint64_t* mask = ppu->windowMasks[layer];
+    uint64_t test1[4], test2[4];
+    ppu_getWindowRange(test1, ppu->window1left, ppu->window1right, wl->window1inversed);
+    ppu_getWindowRange(test2, ppu->window2left, ppu->window2right, wl->window2inversed);
+    for(int i = 0; i < 4; i++) {
+      if(!wl->window1enabled && !wl->window2enabled) {
+        mask[i] = 0;
+      } else if(!wl->window2enabled) {
+        mask[i] = test1[i];
+      } else if(!wl->window1enabled) {
+        mask[i] = test2[i];
+      } else {
+        switch(wl->maskLogic) {
+          case 0: mask[i] = test1[i] | test2[i]; break;
+          case 1: mask[i] = test1[i] & test2[i]; break;
+          case 2: mask[i] = test1[i] ^ test2[i]; break;
+          case 3: mask[i] = ~(test1[i] ^ test2[i]); break;
+        }
+      }
+    }
   }
-  bool test1 = x >= ppu->window1left && x <= ppu->window1right;
-  bool test2 = x >= ppu->window2left && x <= ppu->window2right;
-  if(ppu->windowLayer[layer].window1inversed) test1 = !test1;
-  if(ppu->windowLayer[layer].window2inversed) test2 = !test2;
-  switch(ppu->windowLayer[layer].maskLogic) {
-    case 0: return test1 || test2;
-    case 1: return test1 && test2;
-    case 2: return test1 != test2;
-    case 3: return test1 == test2;
+  ppu->windowMasksDirty = false;
+}
+
+static void ppu_getWindowRange(uint64_t* mask, int left, int right, bool inversed) {
+  // sets the bits for left <= x <= right (none if left > right)
+  for(int i = 0; i < 4; i++) {
+    int lo = left - i * 64;
+    int hi = right - i * 64;
+    if(lo < 0) lo = 0;
+    if(hi > 63) hi = 63;
+    mask[i] = lo > hi ? 0 : (~0ULL >> (63 - hi)) & (~0ULL << lo);
+    if(inversed) mask[i] = ~mask[i];
   }
-  return false;
 }
 
 static void ppu_evaluateSprites(Ppu* ppu, int line) {
   // TODO: rectangular sprites
-  uint8_t index = ppu->objPriority ? (ppu->oamAdr & 0xfe) : 0;
+  if(ppu->spriteListsDirty) ppu_updateSpriteLines(ppu);
+  int start = ppu->objPriority ? (ppu->oamAdr & 0xfe) >> 1 : 0;
   int spritesFound = 0;
   int tilesFound = 0;
   uint8_t foundSprites[32] = {};
-  // iterate over oam to find sprites in range
-  for(int i = 0; i < 128; i++) {
-    uint8_t y = ppu->oam[index] >> 8;
-    // check if the sprite is on this line and get the sprite size
-    uint8_t row = line - y;
-    int spriteSize = spriteSizes[ppu->objSize][(ppu->highOam[index >> 3] >> ((index & 7) + 1)) & 1];
-    int spriteHeight = ppu->objInterlace ? spriteSize / 2 : spriteSize;
-    if(row < spriteHeight) {
-      // in y-range, get the x location, using the high bit as well
-      int x = ppu->oam[index] & 0xff;
-      x |= ((ppu->highOam[index >> 3] >> (index & 7)) & 1) << 8;
-      if(x > 255) x -= 512;
-      // if in x-range, record
-      if(x > -spriteSize || x == -256) {
+  // take the sprites in range on this line in oam order, from the first sprite around to the one before it
+  const uint64_t* inRange = ppu->spriteLines[line & 0xff];
+  for(int pass = 0; pass < 2 && spritesFound <= 32; pass++) {
+    int from = pass == 0 ? start : 0;
+    int to = pass == 0 ? 128 : start;
+    for(int word = from >> 6; word * 64 < to && spritesFound <= 32; word++) {
+      uint64_t bits = inRange[word];
+      if(from > word * 64) bits &= ~0ULL << (from - word * 64);
+      if(to < word * 64 + 64) bits &= (1ULL << (to - word * 64)) - 1;
+      while(bits != 0) {
         // break if we found 32 sprites already
         spritesFound++;
-        if(spritesFound > 32) {
-          ppu->rangeOver = true;
-          spritesFound = 32;
-          break;
-        }
-        foundSprites[spritesFound - 1] = index;
+        if(spritesFound > 32) break;
+        foundSprites[spritesFound - 1] = word * 64 + __builtin_ctzll(bits);
+        bits &= bits - 1;
       }
     }
-    index += 2;
+  }
+  if(spritesFound > 32) {
+    ppu->rangeOver = true;
+    spritesFound = 32;
   }
   // iterate over found sprites backwards to fetch max 34 tile slivers
   for(int i = spritesFound; i > 0; i--) {
-    index = foundSprites[i - 1];
-    uint8_t y = ppu->oam[index] >> 8;
-    uint8_t row = line - y;
-    int spriteSize = spriteSizes[ppu->objSize][(ppu->highOam[index >> 3] >> ((index & 7) + 1)) & 1];
-    int x = ppu->oam[index] & 0xff;
-    x |= ((ppu->highOam[index >> 3] >> (index & 7)) & 1) << 8;
-    if(x > 255) x -= 512;
+    int sprite = foundSprites[i - 1];
+    uint8_t index = sprite * 2;
+    uint8_t row = line - ppu->spriteTop[sprite];
+    int spriteSize = ppu->spriteSize[sprite];
+    int x = ppu->spriteX[sprite];
     if(x > -spriteSize) {
       // update row according to obj-interlace
       if(ppu->objInterlace) row = row * 2 + (ppu->evenFrame ? 0 : 1);
@@ -692,15 +826,10 @@ static void ppu_evaluateSprites(Ppu* ppu, int line) {
           int usedCol = hFlipped ? spriteSize - 1 - col : col;
           uint8_t usedTile = (((tile >> 4) + (row / 8)) << 4) | (((tile & 0xf) + (usedCol / 8)) & 0xf);
           uint16_t objAdr = (ppu->oam[index + 1] & 0x100) ? ppu->objTileAdr2 : ppu->objTileAdr1;
-          uint16_t plane1 = ppu->vram[(objAdr + usedTile * 16 + (row & 0x7)) & 0x7fff];
-          uint16_t plane2 = ppu->vram[(objAdr + usedTile * 16 + 8 + (row & 0x7)) & 0x7fff];
+          const uint8_t* tileRow = ppu_getTile(ppu, 4, objAdr + usedTile * 16) + (row & 0x7) * 8;
           // go over each pixel
           for(int px = 0; px < 8; px++) {
-            int shift = hFlipped ? px : 7 - px;
-            int pixel = (plane1 >> shift) & 1;
-            pixel |= ((plane1 >> (8 + shift)) & 1) << 1;
-            pixel |= ((plane2 >> shift) & 1) << 2;
-            pixel |= ((plane2 >> (8 + shift)) & 1) << 3;
+            int pixel = tileRow[hFlipped ? 7 - px : px];
             // draw it in the buffer if there is a pixel here
             int screenCol = col + x + px;
             if(pixel > 0 && screenCol >= 0 && screenCol < 256) {
@@ -715,6 +844,82 @@ static void ppu_evaluateSprites(Ppu* ppu, int line) {
   }
 }
 
+static void ppu_markSpriteDirty(Ppu* ppu, int sprite) {
+  ppu->spriteDirty[sprite] = true;
+  ppu->spriteListsDirty = true;
+}
+
+static void ppu_markAllSpritesDirty(Ppu* ppu) {
+  // also forgets where they were entered
+  memset(ppu->spriteLines, 0, sizeof(ppu->spriteLines));
+  memset(ppu->spriteHeight, 0, sizeof(ppu->spriteHeight));
+  memset(ppu->spriteDirty, 1, sizeof(ppu->spriteDirty));
+  ppu->spriteListsDirty = true;
+}
+
+static void ppu_updateSpriteLines(Ppu* ppu) {
+  // moves every dirty sprite to the lines it is on now
+  for(int sprite = 0; sprite < 128; sprite++) {
+    if(!ppu->spriteDirty[sprite]) continue;
+    ppu->spriteDirty[sprite] = false;
+    uint64_t bit = 1ULL << (sprite & 63);
+    for(int row = 0; row < ppu->spriteHeight[sprite]; row++) {
+      ppu->spriteLines[(ppu->spriteTop[sprite] + row) & 0xff][sprite >> 6] &= ~bit;
+    }
+    // size and x, using the bits from high oam
+    uint8_t high = ppu->highOam[sprite >> 2] >> ((sprite & 3) * 2);
+    int spriteSize = spriteSizes[ppu->objSize][(high >> 1) & 1];
+    int x = (ppu->oam[sprite * 2] & 0xff) | ((high & 1) << 8);
+    if(x > 255) x -= 512;
+    ppu->spriteSize[sprite] = spriteSize;
+    ppu->spriteX[sprite] = x;
+    ppu->spriteTop[sprite] = ppu->oam[sprite * 2] >> 8;
+    // only sprites in x-range count for the 32 per line
+    bool inRange = x > -spriteSize || x == -256;
+    ppu->spriteHeight[sprite] = inRange ? (ppu->objInterlace ? spriteSize / 2 : spriteSize) : 0;
+    for(int row = 0; row < ppu->spriteHeight[sprite]; row++) {
+      ppu->spriteLines[(ppu->spriteTop[sprite] + row) & 0xff][sprite >> 6] |= bit;
+    }
+  }
+  ppu->spriteListsDirty = false;
+}
+
+static void ppu_markTilesDirty(Ppu* ppu, uint16_t adr) {
+  adr &= 0x7fff;
+  ppu->tiles2bppDirty[adr >> 3] = true;
+  ppu->tiles4bppDirty[adr >> 4] = true;
+  ppu->tiles8bppDirty[adr >> 5] = true;
+}
+
+static const uint8_t* ppu_getTile(Ppu* ppu, int bitDepth, uint16_t adr) {
+  // returns the 8x8 pixels of the tile at word address adr (aligned to the tile size), row by row
+  adr &= 0x7fff;
+  uint8_t* tile;
+  bool* dirty;
+  switch(bitDepth) {
+    case 2: tile = ppu->tiles2bpp[adr >> 3]; dirty = &ppu->tiles2bppDirty[adr >> 3]; break;
+    case 4: tile = ppu->tiles4bpp[adr >> 4]; dirty = &ppu->tiles4bppDirty[adr >> 4]; break;
+    default: tile = ppu->tiles8bpp[adr >> 5]; dirty = &ppu->tiles8bppDirty[adr >> 5]; break;
+  }
+  if(*dirty) {
+    // each word holds 2 planes of a row, 2bpp uses 1 word per row, 4bpp 2, 8bpp 4
+    for(int row = 0; row < 8; row++) {
+      for(int col = 0; col < 8; col++) {
+        int shift = 7 - col;
+        int pixel = 0;
+        for(int j = 0; j < bitDepth / 2; j++) {
+          uint16_t planes = ppu->vram[adr + j * 8 + row];
+          pixel |= ((planes >> shift) & 1) << (j * 2);
+          pixel |= ((planes >> (8 + shift)) & 1) << (j * 2 + 1);
+        }
+        tile[row * 8 + col] = pixel;
+      }
+    }
+    *dirty = false;
+  }
+  return tile;
+}
+
 static uint16_t ppu_getVramRemap(Ppu* ppu) {
   uint16_t adr = ppu->vramPointer;
   switch(ppu->vramRemapMode) {
@@ -859,11 +1064,11 @@ void ppu_write(Ppu* ppu, uint8_t adr, uint8_t val) {
     case 0x00: {
       // TODO: oam address reset when written on first line of vblank, (and when forced blank is disabled?)
       ppu->brightness = val & 0xf;
-      bright_now = bright_lut[ppu->brightness];
       ppu->forcedBlank = val & 0x80;
       break;
     }
     case 0x01: {
+      if(ppu->objSize != val >> 5) ppu_markAllSpritesDirty(ppu);
       ppu->objSize = val >> 5;
       ppu->objTileAdr1 = (val & 7) << 13;
       ppu->objTileAdr2 = ppu->objTileAdr1 + (((val & 0x18) + 8) << 9);
@@ -886,7 +1091,9 @@ void ppu_write(Ppu* ppu, uint8_t adr, uint8_t val) {
     }
     case 0x04: {
       if(ppu->oamInHigh) {
-        ppu->highOam[((ppu->oamAdr & 0xf) << 1) | ppu->oamSecondWrite] = val;
+        int highAdr = ((ppu->oamAdr & 0xf) << 1) | ppu->oamSecondWrite;
+        ppu->highOam[highAdr] = val;
+        for(int i = 0; i < 4; i++) ppu_markSpriteDirty(ppu, highAdr * 4 + i);
         if(ppu->oamSecondWrite) {
           ppu->oamAdr++;
           if(ppu->oamAdr == 0) ppu->oamInHigh = false;
@@ -895,6 +1102,7 @@ void ppu_write(Ppu* ppu, uint8_t adr, uint8_t val) {
         if(!ppu->oamSecondWrite) {
           ppu->oamBuffer = val;
         } else {
+          if((ppu->oamAdr & 1) == 0) ppu_markSpriteDirty(ppu, ppu->oamAdr >> 1); // x and y, not tile and attributes
           ppu->oam[ppu->oamAdr++] = (val << 8) | ppu->oamBuffer;
           if(ppu->oamAdr == 0) ppu->oamInHigh = true;
         }
@@ -991,6 +1199,7 @@ void ppu_write(Ppu* ppu, uint8_t adr, uint8_t val) {
       uint16_t vramAdr = ppu_getVramRemap(ppu);
 	  if (ppu->forcedBlank || ppu->snes->inVblank) { // TODO: also cgram and oam?
 		ppu->vram[vramAdr & 0x7fff] = (ppu->vram[vramAdr & 0x7fff] & 0xff00) | val;
+		ppu_markTilesDirty(ppu, vramAdr);
 	  }
       if(!ppu->vramIncrementOnHigh) ppu->vramPointer += ppu->vramIncrement;
       break;
@@ -999,6 +1208,7 @@ void ppu_write(Ppu* ppu, uint8_t adr, uint8_t val) {
       uint16_t vramAdr = ppu_getVramRemap(ppu);
 	  if (ppu->forcedBlank || ppu->snes->inVblank) {
 		ppu->vram[vramAdr & 0x7fff] = (ppu->vram[vramAdr & 0x7fff] & 0x00ff) | (val << 8);
+		ppu_markTilesDirty(ppu, vramAdr);
 	  }
       if(ppu->vramIncrementOnHigh) ppu->vramPointer += ppu->vramIncrement;
       break;
@@ -1033,7 +1243,12 @@ void ppu_write(Ppu* ppu, uint8_t adr, uint8_t val) {
       if(!ppu->cgramSecondWrite) {
         ppu->cgramBuffer = val;
       } else {
-        ppu->cgram[ppu->cgramPointer++] = (val << 8) | ppu->cgramBuffer;
+        ppu->cgram[ppu->cgramPointer] = (val << 8) | ppu->cgramBuffer;
+        ppu->palette[ppu->cgramPointer] = ppu->cgram[ppu->cgramPointer] & 0x7fff;
+        if(ppu->paletteXbgrBrightness >= 0) {
+          colormath_toXbgr(ppu->palette[ppu->cgramPointer], ppu->paletteXbgrBrightness, ppu->paletteXbgr[ppu->cgramPointer]);
+        }
+        ppu->cgramPointer++;
       }
       ppu->cgramSecondWrite = !ppu->cgramSecondWrite;
       break;
@@ -1049,22 +1264,27 @@ void ppu_write(Ppu* ppu, uint8_t adr, uint8_t val) {
       ppu->windowLayer[(adr - 0x23) * 2 + 1].window1enabled = val & 0x20;
       ppu->windowLayer[(adr - 0x23) * 2 + 1].window2inversed = val & 0x40;
       ppu->windowLayer[(adr - 0x23) * 2 + 1].window2enabled = val & 0x80;
+      ppu->windowMasksDirty = true;
       break;
     }
     case 0x26: {
       ppu->window1left = val;
+      ppu->windowMasksDirty = true;
       break;
     }
     case 0x27: {
       ppu->window1right = val;
+      ppu->windowMasksDirty = true;
       break;
     }
     case 0x28: {
       ppu->window2left = val;
+      ppu->windowMasksDirty = true;
       break;
     }
     case 0x29: {
       ppu->window2right = val;
+      ppu->windowMasksDirty = true;
       break;
     }
     case 0x2a: {
@@ -1072,11 +1292,13 @@ void ppu_write(Ppu* ppu, uint8_t adr, uint8_t val) {
       ppu->windowLayer[1].maskLogic = (val >> 2) & 0x3;
       ppu->windowLayer[2].maskLogic = (val >> 4) & 0x3;
       ppu->windowLayer[3].maskLogic = (val >> 6) & 0x3;
+      ppu->windowMasksDirty = true;
       break;
     }
     case 0x2b: {
       ppu->windowLayer[4].maskLogic = val & 0x3;
       ppu->windowLayer[5].maskLogic = (val >> 2) & 0x3;
+      ppu->windowMasksDirty = true;
       break;
     }
     case 0x2c: {
@@ -1134,6 +1356,7 @@ void ppu_write(Ppu* ppu, uint8_t adr, uint8_t val) {
     }
     case 0x33: {
       ppu->interlace = val & 0x1;
+      if(ppu->objInterlace != (bool) (val & 0x2)) ppu_markAllSpritesDirty(ppu);
       ppu->objInterlace = val & 0x2;
       ppu->overscan = val & 0x4;
       ppu->pseudoHires = val & 0x8;
@@ -1164,3 +1387,50 @@ void ppu_putPixels(Ppu* ppu, uint8_t* pixels) {
         memset(pixels + (464 * 2048), 0, 2048 * 16);
     }
 }
+
+void ppu_getFrameSize(Ppu* ppu, int* width, int* height) {
+  // 512 wide only if some line used hires, 448/478 high only when interlacing
+  *width = ppu->frameHires ? 512 : 256;
+  *height = (ppu->frameOverscan ? 239 : 224) * (ppu->frameInterlace ? 2 : 1);
+}
+
+void ppu_putFrame(Ppu* ppu, uint8_t* pixels, int pitch, int format) {
+  // converts the frame at its actual size (see ppu_getFrameSize), pitch is in bytes
+  int width, height;
+  ppu_getFrameSize(ppu, &width, &height);
+  // pixelBuffer has 2 half-pixels per pixel (both the same outside hires), 4 bytes each as 0, b, g, r
+  int step = width == 512 ? 4 : 8;
+  int first = width == 512 ? 0 : 4;
+  for(int y = 0; y < height; y++) {
+    // interlaced frames weave both fields, others use the field of this frame
+    int row = ppu->frameInterlace ? (y >> 1) + ((y & 1) ? 239 : 0) : y + (ppu->evenFrame ? 0 : 239);
+    const uint8_t* src = &ppu->pixelBuffer[row * 2048 + first];
+    uint8_t* dst = pixels + y * pitch;
+    switch(format) {
+      case PPU_FORMAT_XRGB8888:
+      case PPU_FORMAT_XBGR8888: {
+        bool rgb = format == PPU_FORMAT_XRGB8888;
+        uint32_t* out = (uint32_t*) dst;
+        for(int x = 0; x < width; x++, src += step) {
+          uint32_t b = src[1], g = src[2], r = src[3];
+          out[x] = rgb ? (r << 16) | (g << 8) | b : (b << 16) | (g << 8) | r;
+        }
+        break;
+      }
+      case PPU_FORMAT_RGB565: {
+        uint16_t* out = (uint16_t*) dst;
+        for(int x = 0; x < width; x++, src += step) {
+          out[x] = ((src[3] >> 3) << 11) | ((src[2] >> 2) << 5) | (src[1] >> 3);
+        }
+        break;
+      }
+      case PPU_FORMAT_RGB555: {
+        uint16_t* out = (uint16_t*) dst;
+        for(int x = 0; x < width; x++, src += step) {
+          out[x] = ((src[3] >> 3) << 10) | ((src[2] >> 3) << 5) | (src[1] >> 3);
+        }
+        break;
+      }
+    }
+  }
+}
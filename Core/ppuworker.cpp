@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <ppuworker.h>
+#include <snes.h>
+#include <ppu.h>
+
+enum {
+  PPU_LOG_WRITE = 0,
+  PPU_LOG_READ,
+  PPU_LOG_LINE,
+  PPU_LOG_FRAME_START,
+  PPU_LOG_OVERSCAN,
+  PPU_LOG_VBLANK
+};
+
+typedef struct PpuLogEntry {
+  uint8_t type;
+  uint8_t adr;
+  uint8_t val; // value for writes, if rendering for lines and vblank
+  bool inVblank; // timing the write saw, vram writes and the mosaic start line depend on it
+  uint32_t arg; // vPos for writes, line for lines, frame counter for vblank
+} PpuLogEntry;
+
+// how often the worker polls for new entries before going to sleep (about a scanline)
+static const int spinCount = 2000;
+// a frame with a full vram dma is about 70K entries, the producer waits for the worker if it gets that far ahead
+static const uint32_t logSize = 1 << 17;
+
+struct PpuWorker {
+  Snes* snes;
+  Ppu* ppu; // the mirror, only touched by the worker (or by the producer while synced)
+  Snes* shadow; // what the mirror sees as its snes, holds the vPos/inVblank of the write being replayed
+  PpuLogEntry* log;
+  uint32_t head; // next entry to write, producer only
+  uint32_t tailSeen; // last tail the producer read
+  std::atomic<uint32_t> published; // entries up to here are visible to the worker
+  std::atomic<uint32_t> tail; // entries up to here are replayed
+  // the lock and condition variables are only used when a side actually has to sleep
+  std::mutex lock;
+  std::condition_variable workAvailable;
+  std::condition_variable drained;
+  std::atomic<bool> workerSleeping;
+  std::atomic<bool> producerWaiting;
+  bool stopping;
+  std::thread thread;
+};
+
+static void ppuworker_loop(PpuWorker* worker);
+static void ppuworker_replay(PpuWorker* worker, const PpuLogEntry* entry);
+static void ppuworker_push(PpuWorker* worker, uint8_t type, uint8_t adr, uint8_t val, uint32_t arg);
+static void ppuworker_publish(PpuWorker* worker);
+static void ppuworker_waitForTail(PpuWorker* worker, uint32_t target);
+static void ppuworker_copyMirror(PpuWorker* worker);
+
+PpuWorker* ppuworker_init(Snes* snes) {
+  PpuWorker* worker = new PpuWorker();
+  worker->snes = snes;
+  worker->shadow = (Snes*)calloc(1, sizeof(Snes));
+  worker->ppu = ppu_init(worker->shadow);
+  ppuworker_copyMirror(worker);
+  memcpy(worker->ppu->pixelBuffer, snes->ppu->pixelBuffer, sizeof(worker->ppu->pixelBuffer));
+  worker->log = (PpuLogEntry*)malloc(logSize * sizeof(PpuLogEntry));
+  worker->head = 0;
+  worker->tailSeen = 0;
+  worker->published.store(0);
+  worker->tail.store(0);
+  worker->workerSleeping.store(false);
+  worker->producerWaiting.store(false);
+  worker->stopping = false;
+  worker->thread = std::thread(ppuworker_loop, worker);
+  return worker;
+}
+
+void ppuworker_free(PpuWorker* worker) {
+  ppuworker_sync(worker);
+  {
+    std::lock_guard<std::mutex> guard(worker->lock);
+    worker->stopping = true;
+  }
+  worker->workAvailable.notify_one();
+  worker->thread.join();
+  ppu_free(worker->ppu);
+  free(worker->shadow);
+  free(worker->log);
+  delete worker;
+}
+
+void ppuworker_write(PpuWorker* worker, uint8_t adr, uint8_t val) {
+  ppuworker_push(worker, PPU_LOG_WRITE, adr, val, worker->snes->vPos);
+}
+
+void ppuworker_read(PpuWorker* worker, uint8_t adr) {
+  ppuworker_push(worker, PPU_LOG_READ, adr, 0, 0);
+}
+
+void ppuworker_runLine(PpuWorker* worker, int line, bool render) {
+  ppuworker_push(worker, PPU_LOG_LINE, 0, render, line);
+  ppuworker_publish(worker);
+}
+
+void ppuworker_handleFrameStart(PpuWorker* worker) {
+  ppuworker_push(worker, PPU_LOG_FRAME_START, 0, 0, 0);
+}
+
+void ppuworker_checkOverscan(PpuWorker* worker) {
+  ppuworker_push(worker, PPU_LOG_OVERSCAN, 0, 0, 0);
+}
+
+void ppuworker_handleVblank(PpuWorker* worker, bool publish) {
+  ppuworker_push(worker, PPU_LOG_VBLANK, 0, publish, worker->snes->frames);
+  ppuworker_publish(worker);
+}
+
+Ppu* ppuworker_sync(PpuWorker* worker) {
+  ppuworker_publish(worker);
+  ppuworker_waitForTail(worker, worker->head);
+  return worker->ppu;
+}
+
+void ppuworker_reload(PpuWorker* worker) {
+  ppuworker_sync(worker);
+  ppuworker_copyMirror(worker);
+}
+
+void ppuworker_reset(PpuWorker* worker) {
+  ppuworker_reload(worker);
+  memset(worker->ppu->pixelBuffer, 0, sizeof(worker->ppu->pixelBuffer));
+}
+
+static void ppuworker_copyMirror(PpuWorker* worker) {
+  // everything but the pixels, which are not part of the state and only ever written by the mirror
+  memcpy(worker->ppu, worker->snes->ppu, offsetof(Ppu, pixelBuffer));
+  worker->ppu->snes = worker->shadow;
+}
+
+static void ppuworker_push(PpuWorker* worker, uint8_t type, uint8_t adr, uint8_t val, uint32_t arg) {
+  if(worker->head - worker->tailSeen == logSize) {
+    worker->tailSeen = worker->tail.load(std::memory_order_acquire);
+    if(worker->head - worker->tailSeen == logSize) {
+      // log is full, hand over what we have and wait for room
+      ppuworker_publish(worker);
+      ppuworker_waitForTail(worker, worker->head - logSize + 1);
+    }
+  }
+  PpuLogEntry* entry = &worker->log[worker->head & (logSize - 1)];
+  entry->type = type;
+  entry->adr = adr;
+  entry->val = val;
+  entry->inVblank = worker->snes->inVblank;
+  entry->arg = arg;
+  worker->head++;
+}
+
+static void ppuworker_publish(PpuWorker* worker) {
+  // entries are handed over in batches (per line), not one by one
+  if(worker->published.load(std::memory_order_relaxed) == worker->head) return;
+  // seq_cst store and load: either the worker sees the new entries, or we see it sleeping
+  worker->published.store(worker->head);
+  if(worker->workerSleeping.load()) {
+    {
+      std::lock_guard<std::mutex> guard(worker->lock);
+    }
+    worker->workAvailable.notify_one();
+  }
+}
+
+static void ppuworker_waitForTail(PpuWorker* worker, uint32_t target) {
+  // waits until the worker replayed everything before target
+  if((int32_t)(worker->tail.load(std::memory_order_acquire) - target) < 0) {
+    std::unique_lock<std::mutex> lock(worker->lock);
+    worker->producerWaiting.store(true);
+    worker->drained.wait(lock, [worker, target] {
+      return (int32_t)(worker->tail.load() - target) >= 0;
+    });
+    worker->producerWaiting.store(false);
+  }
+  worker->tailSeen = worker->tail.load(std::memory_order_acquire);
+}
+
+static void ppuworker_loop(PpuWorker* worker) {
+  uint32_t tail = worker->tail.load(std::memory_order_relaxed);
+  while(true) {
+    uint32_t head = worker->published.load(std::memory_order_acquire);
+    for(int i = 0; i < spinCount && head == tail; i++) {
+      std::this_thread::yield();
+      head = worker->published.load(std::memory_order_acquire);
+    }
+    if(head == tail) {
+      std::unique_lock<std::mutex> lock(worker->lock);
+      worker->workerSleeping.store(true);
+      worker->workAvailable.wait(lock, [worker, tail] {
+        return worker->stopping || worker->published.load() != tail;
+      });
+      worker->workerSleeping.store(false);
+      if(worker->published.load() == tail) return; // stopping, and nothing left
+      continue;
+    }
+    for(; tail != head; tail++) ppuworker_replay(worker, &worker->log[tail & (logSize - 1)]);
+    // seq_cst, pairs with producerWaiting like published does with workerSleeping
+    worker->tail.store(tail);
+    if(worker->producerWaiting.load()) {
+      {
+        std::lock_guard<std::mutex> guard(worker->lock);
+      }
+      worker->drained.notify_one();
+    }
+  }
+}
+
+static void ppuworker_replay(PpuWorker* worker, const PpuLogEntry* entry) {
+  Ppu* ppu = worker->ppu;
+  switch(entry->type) {
+    case PPU_LOG_WRITE: {
+      worker->shadow->vPos = entry->arg;
+      worker->shadow->inVblank = entry->inVblank;
+      ppu_write(ppu, entry->adr, entry->val);
+      break;
+    }
+    case PPU_LOG_READ: {
+      ppu_read(ppu, entry->adr);
+      break;
+    }
+    case PPU_LOG_LINE: {
+      // the mirror evaluates skipped lines as well, so it stays a copy of snes->ppu
+      if(entry->val) {
+        ppu_runLine(ppu, entry->arg);
+      } else {
+        ppu_evaluateLine(ppu, entry->arg);
+      }
+      break;
+    }
+    case PPU_LOG_FRAME_START: {
+      ppu_handleFrameStart(ppu);
+      break;
+    }
+    case PPU_LOG_OVERSCAN: {
+      ppu_checkOverscan(ppu);
+      break;
+    }
+    case PPU_LOG_VBLANK: {
+      ppu_handleVblank(ppu);
+      // frameOutput only changes while synced
+      if(entry->val && worker->snes->frameOutput != NULL) snes_publishFrame(worker->snes, ppu, entry->arg);
+      break;
+    }
+  }
+}
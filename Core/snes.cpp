@@ -4,6 +4,7 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <time.h>
 
 #include <snes.h>
 #include <cpu.h>
@@ -15,22 +16,38 @@
 #include <cx4.h>
 #include <input.h>
 #include <statehandler.h>
+#include <ppuworker.h>
 
 static void snes_runCycle(Snes* snes);
+static void snes_skipCycles(Snes* snes, int cycles);
+static void snes_updateNextEvent(Snes* snes);
+static void snes_skipIdleLoop(Snes* snes);
+static void snes_flushCycles(Snes* snes);
 static void snes_catchupApu(Snes* snes);
 static void snes_doAutoJoypad(Snes* snes);
 static uint8_t snes_readReg(Snes* snes, uint16_t adr);
 static void snes_writeReg(Snes* snes, uint16_t adr, uint8_t val);
 static uint8_t snes_rread(Snes* snes, uint32_t adr); // wrapped by read, to set open bus
-static int snes_getAccessTime(Snes* snes, uint32_t adr);
-static void build_accesstime(Snes* snes, bool recalc);
-static void free_accesstime();
-
-static uint8_t *access_time;
+static void snes_buildMemoryMap(Snes* snes);
+static void snes_selectAccessTimes(Snes* snes);
+#if SNES_STATS
+static int snes_statsRegion(Snes* snes, uint32_t adr);
+#endif
+
+// wait states (master cycles) for 00-3f,80-bf:0000-7fff, in 512-byte steps
+static const uint8_t sysAccessTimes[0x40] = {
+  8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, // 0000-1fff
+  6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, // 2000-3fff
+  12, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, // 4000-41ff, 4200-5fff
+  8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8 // 6000-7fff
+};
+// wait states for everything else (rom/sram areas), per quarter of the bank range (00-3f, 40-7f, 80-bf, c0-ff)
+static const uint8_t slowAccessTimes[4] = {8, 8, 8, 8};
+static const uint8_t fastAccessTimes[4] = {8, 8, 6, 6}; // $420d bit 0 speeds up banks 80+
 
 Snes* snes_init(void) {
   Snes* snes = (Snes*)malloc(sizeof(Snes));
-  snes->cpu = cpu_init(snes, snes_cpuRead, snes_cpuWrite, snes_cpuIdle);
+  snes->cpu = cpu_init(snes, snes_cpuRead, snes_cpuWrite, snes_cpuIdle, snes_cpuCode, snes_cpuFetch, snes_cpuLoop);
   snes->apu = apu_init(snes);
   snes->dma = dma_init(snes);
   snes->ppu = ppu_init(snes);
@@ -38,10 +55,36 @@ Snes* snes_init(void) {
   snes->input1 = input_init(snes);
   snes->input2 = input_init(snes);
   snes->palTiming = false;
+  snes->frameOutput = NULL;
+  snes->ppuWorker = NULL;
+  snes->frameSkip = 0;
+  snes->framesToSkip = 0;
+  snes->renderFrame = true;
+  snes->showFrame = true;
+  snes->accessTimes = slowAccessTimes;
+  memset(snes->readMap, 0, sizeof(snes->readMap));
+  memset(snes->writeMap, 0, sizeof(snes->writeMap));
+  for(int i = 0; i < 0x1000; i++) snes->pageWrites[i] = &snes->romWrites;
+  memset(snes->ramWrites, 0, sizeof(snes->ramWrites));
+  snes->sramWrites = 0;
+  snes->romWrites = 0;
+  memset(&snes->stats, 0, sizeof(snes->stats));
+  snes->statsTimer = SNES_TIME_COUNT; // not inside snes_runFrame, not accounted
+  snes->statsMark = 0;
+  snes->busDebt = 0;
+  snes->busRoom = 0;
+  snes->exactTiming = false;
+  snes->loopCycle = 0;
+  snes->loopReads = 0;
+  snes->loopLastReads = 0;
+  snes->loopAutoJoy = 0;
+  snes->loopQuiet = false;
+  snes->loopHvbjoy = false;
   return snes;
 }
 
 void snes_free(Snes* snes) {
+  if(snes->ppuWorker != NULL) ppuworker_free(snes->ppuWorker);
   cpu_free(snes->cpu);
   apu_free(snes->apu);
   dma_free(snes->dma);
@@ -49,7 +92,6 @@ void snes_free(Snes* snes) {
   cart_free(snes->cart);
   input_free(snes->input1);
   input_free(snes->input2);
-  free_accesstime();
   free(snes);
 }
 
@@ -89,10 +131,16 @@ void snes_reset(Snes* snes, bool hard) {
   snes->fastMem = false;
   snes->openBus = 0;
   snes->nextHoriEvent = 16;
-  build_accesstime(snes, false);
+  snes->nextEventCycle = 0;
+  snes->busDebt = 0;
+  snes->busRoom = 0;
+  snes_buildMemoryMap(snes);
+  snes_selectAccessTimes(snes);
+  if(snes->ppuWorker != NULL) ppuworker_reset(snes->ppuWorker);
 }
 
 void snes_handleState(Snes* snes, StateHandler* sh) {
+  snes_flushCycles(snes); // the debt is only left over inside the cpu loop, but it belongs to the state
   sh_handleBools(sh,
     &snes->palTiming, &snes->hIrqEnabled, &snes->vIrqEnabled, &snes->nmiEnabled, &snes->inNmi, &snes->irqCondition,
     &snes->inIrq, &snes->inVblank, &snes->autoJoyRead, &snes->ppuLatch, &snes->fastMem, NULL
@@ -106,10 +154,13 @@ void snes_handleState(Snes* snes, StateHandler* sh) {
   sh_handleInts(sh, &snes->hvTimer, &snes->ramAdr, &snes->frames, &snes->nextHoriEvent, NULL);
   sh_handleLongLongs(sh, &snes->cycles, &snes->syncCycle, NULL);
   sh_handleByteArray(sh, snes->ram, 0x20000);
+  snes->nextEventCycle = 0; // recalculated from the (possibly loaded) timing state
+  snes_selectAccessTimes(snes);
   // components
   cpu_handleState(snes->cpu, sh);
   dma_handleState(snes->dma, sh);
   ppu_handleState(snes->ppu, sh);
+  if(snes->ppuWorker != NULL) ppuworker_reload(snes->ppuWorker);
   apu_handleState(snes->apu, sh);
   input_handleState(snes->input1, sh);
   input_handleState(snes->input2, sh);
@@ -117,22 +168,38 @@ void snes_handleState(Snes* snes, StateHandler* sh) {
 }
 
 void snes_runFrame(Snes* snes) {
+  SNES_STAT_TIME_ENTER(snes, SNES_TIME_CPU, prevTimer);
   while(snes->inVblank) {
     cpu_runOpcode(snes->cpu);
+    SNES_STAT_INC(snes, cpuOpcodes);
   }
   uint32_t frame = snes->frames;
   while(!snes->inVblank && frame == snes->frames) {
     cpu_runOpcode(snes->cpu);
+    SNES_STAT_INC(snes, cpuOpcodes);
   }
+  snes_flushCycles(snes);
+  SNES_STAT_TIME_LEAVE(snes, prevTimer);
 }
 
 void snes_runCycles(Snes* snes, int cycles) {
   if(snes->hPos + cycles >= 536 && snes->hPos < 536) {
     // if we go past 536, add 40 cycles for dram refersh
     cycles += 40;
+    snes->loopQuiet = false;
   }
-  for(int i = 0; i < cycles; i += 2) {
-    snes_runCycle(snes);
+  // runs in steps of 2 cycles, rounded up
+  uint64_t target = snes->cycles + ((cycles + 1) & ~1);
+  while(snes->cycles < target) {
+    if(snes->cycles < snes->nextEventCycle) {
+      // nothing happens until the next event, skip straight to it (or to the target)
+      uint64_t to = target < snes->nextEventCycle ? target : snes->nextEventCycle;
+      snes_skipCycles(snes, (int)(to - snes->cycles));
+    } else {
+      snes_runCycle(snes);
+      snes_updateNextEvent(snes);
+      snes->loopQuiet = false;
+    }
   }
 }
 
@@ -148,6 +215,7 @@ void snes_syncCycles(Snes* snes, bool start, int syncCycles) {
 }
 
 static void snes_runCycle(Snes* snes) {
+  SNES_STAT_INC(snes, runCycles);
   snes->cycles += 2;
   if ((snes->hPos & 2) == 0) {
     // check for h/v timer irq's every 4 cycles
@@ -181,7 +249,20 @@ static void snes_runCycle(Snes* snes) {
       case 512: {
         snes->nextHoriEvent = 1104;
         // render the line halfway of the screen for better compatibility
-        if(!snes->inVblank && snes->vPos > 0) ppu_runLine(snes->ppu, snes->vPos);
+        if(!snes->inVblank && snes->vPos > 0) {
+          SNES_STAT_TIME_ENTER(snes, SNES_TIME_PPU, prevTimer);
+          // skipped frames still evaluate the line, it sets the range/time over flags
+          if(snes->ppuWorker != NULL) {
+            ppu_evaluateLine(snes->ppu, snes->vPos);
+            ppuworker_runLine(snes->ppuWorker, snes->vPos, snes->renderFrame);
+          } else if(snes->renderFrame) {
+            ppu_runLine(snes->ppu, snes->vPos);
+          } else {
+            ppu_evaluateLine(snes->ppu, snes->vPos);
+          }
+          SNES_STAT_INC(snes, ppuLines);
+          SNES_STAT_TIME_LEAVE(snes, prevTimer);
+        }
       } break;
       case 1104: {
         if(!snes->inVblank) snes->dma->hdmaRunRequested = true;
@@ -205,14 +286,14 @@ static void snes_runCycle(Snes* snes) {
         if(!snes->palTiming) {
           // even interlace frame is 263 lines
           if((snes->vPos == 262 && (!snes->ppu->frameInterlace || !snes->ppu->evenFrame)) || snes->vPos == 263) {
-            if (snes->cart->type == 4) cx4_run();
+            if (snes->cart->type == 4) cx4_run(snes->cart->cx4);
             snes->vPos = 0;
             snes->frames++;
           }
 	    } else {
           // even interlace frame is 313 lines
           if((snes->vPos == 312 && (!snes->ppu->frameInterlace || !snes->ppu->evenFrame)) || snes->vPos == 313) {
-            if (snes->cart->type == 4) cx4_run();
+            if (snes->cart->type == 4) cx4_run(snes->cart->cx4);
             snes->vPos = 0;
             snes->frames++;
           }
@@ -225,9 +306,16 @@ static void snes_runCycle(Snes* snes) {
           snes->inVblank = false;
           snes->inNmi = false;
           ppu_handleFrameStart(snes->ppu);
+          // interlaced output weaves in the previous field, so the frame before a rendered one is rendered too
+          bool interlaced = snes->ppu->frameInterlace || snes->ppu->interlace;
+          snes->showFrame = snes->framesToSkip == 0;
+          snes->renderFrame = snes->showFrame || (snes->framesToSkip == 1 && interlaced);
+          snes->framesToSkip = snes->framesToSkip == 0 ? snes->frameSkip : snes->framesToSkip - 1;
+          if(snes->ppuWorker != NULL) ppuworker_handleFrameStart(snes->ppuWorker);
         } else if(snes->vPos == 225) {
           // ask the ppu if we start vblank now or at vPos 240 (overscan)
           startingVblank = !ppu_checkOverscan(snes->ppu);
+          if(snes->ppuWorker != NULL) ppuworker_checkOverscan(snes->ppuWorker);
         } else if(snes->vPos == 240){
           // if we are not yet in vblank, we had an overscan frame, set startingVblank
           if(!snes->inVblank) startingVblank = true;
@@ -240,6 +328,11 @@ static void snes_runCycle(Snes* snes) {
 		  dsp_newFrame(snes->apu->dsp);
           // we are starting vblank
           ppu_handleVblank(snes->ppu);
+          if(snes->ppuWorker != NULL) {
+            ppuworker_handleVblank(snes->ppuWorker, snes->showFrame); // the worker publishes once it rendered the frame
+          } else if(snes->frameOutput != NULL && snes->showFrame) {
+            snes_publishFrame(snes, snes->ppu, snes->frames);
+          }
           snes->inVblank = true;
           snes->inNmi = true;
           if(snes->autoJoyRead) {
@@ -258,8 +351,89 @@ static void snes_runCycle(Snes* snes) {
   if(snes->autoJoyTimer > 0) snes->autoJoyTimer -= 2;
 }
 
+static void snes_skipCycles(Snes* snes, int cycles) {
+  // advance over steps that contain no horizontal event, no irq edge and no running hvTimer,
+  // doing in bulk what snes_runCycle would do for each of them
+  snes->cycles += cycles;
+  int checks = (snes->hPos & 2) ? cycles / 4 : (cycles + 2) / 4;
+  if(checks > 0) {
+    // away from the h-timer match, the irq condition only depends on the line
+    snes->irqCondition = snes->vIrqEnabled && !snes->hIrqEnabled && snes->vPos == snes->vTimer;
+  }
+  snes->hPos += cycles;
+  snes->autoJoyTimer = snes->autoJoyTimer > cycles ? snes->autoJoyTimer - cycles : 0;
+}
+
+static void snes_skipIdleLoop(Snes* snes) {
+  // the iteration that just ended (since loopCycle) is repeated as often as it fits before the next step
+  int period = (int)(snes->cycles - snes->loopCycle);
+  if(period <= 0 || snes->nextEventCycle <= snes->cycles) return;
+  int hPos = snes->hPos;
+  uint64_t room = snes->nextEventCycle - snes->cycles;
+  // no dram refresh in between, it would make one of the iterations longer
+  if(hPos < 536 && room > (uint64_t)(535 - hPos)) room = 535 - hPos;
+  if(snes->loopHvbjoy) {
+    // every read of $4212 has to see the same hblank and auto-joypad flags as the ones in the last iteration
+    static const int hblankEdges[2] = {4, 1096};
+    for(int i = 0; i < 2; i++) {
+      int edge = hblankEdges[i];
+      if(hPos - period < edge) {
+        if(hPos >= edge) return;
+        if(room > (uint64_t)(edge - 1 - hPos)) room = edge - 1 - hPos;
+      }
+    }
+    if(snes->autoJoyTimer > 0) {
+      if(room > (uint64_t)(snes->autoJoyTimer - 1)) room = snes->autoJoyTimer - 1;
+    } else if(snes->loopAutoJoy > 0) {
+      return;
+    }
+  }
+  int cycles = (int)(room / period) * period;
+  if(cycles == 0) return;
+  snes_runCycles(snes, cycles);
+  SNES_STAT_ADD(snes, idleCycles, cycles);
+}
+
+static void snes_updateNextEvent(Snes* snes) {
+  // find the first step that snes_runCycle has to run fully, all steps before it can be skipped
+  // nextEventCycle is the cycle that step starts at
+  int hPos = snes->hPos;
+  if((int)snes->nextHoriEvent <= hPos || (snes->autoJoyTimer & 1)) {
+    // not a position the scheduler can reason about (only from odd savestates), run every step
+    snes->nextEventCycle = snes->cycles;
+    return;
+  }
+  // the step that reaches the horizontal event
+  int steps = (snes->nextHoriEvent - 2 - hPos) / 2;
+  // next irq check (every 4 cycles), if the hvTimer runs or the condition goes high at it
+  const bool lineCondition = snes->vIrqEnabled && !snes->hIrqEnabled && snes->vPos == snes->vTimer;
+  if(snes->hvTimer > 0 || (!snes->irqCondition && lineCondition)) {
+    int checkSteps = (hPos & 2) ? 1 : 0;
+    if(checkSteps < steps) steps = checkSteps;
+  }
+  // irq check at the h-timer position
+  if(snes->hIrqEnabled && (!snes->vIrqEnabled || snes->vPos == snes->vTimer) && snes->hTimer >= hPos) {
+    int timerSteps = (snes->hTimer - hPos) / 2;
+    if(timerSteps < steps) steps = timerSteps;
+  }
+  snes->nextEventCycle = snes->cycles + steps * 2;
+}
+
+void snes_publishFrame(Snes* snes, Ppu* ppu, uint32_t sequence) {
+  // convert the finished frame straight into the back buffer and hand it over
+  FrameBuffer* fb = snes->frameOutput;
+  Frame* frame = framebuffer_getBack(fb);
+  ppu_getFrameSize(ppu, &frame->width, &frame->height);
+  ppu_putFrame(ppu, frame->pixels, frame->pitch, framebuffer_getFormat(fb));
+  frame->sequence = sequence;
+  framebuffer_publish(fb);
+}
+
 static void snes_catchupApu(Snes* snes) {
+  SNES_STAT_TIME_ENTER(snes, SNES_TIME_APU, prevTimer);
   apu_runCycles(snes->apu);
+  SNES_STAT_INC(snes, apuCatchups);
+  SNES_STAT_TIME_LEAVE(snes, prevTimer);
 }
 
 static void snes_doAutoJoypad(Snes* snes) {
@@ -281,7 +455,10 @@ static void snes_doAutoJoypad(Snes* snes) {
 
 uint8_t snes_readBBus(Snes* snes, uint8_t adr) {
   if(adr < 0x40) {
-    return ppu_read(snes->ppu, adr);
+    uint8_t val = ppu_read(snes->ppu, adr);
+    // oam, vram and cgram reads move the pointers the worker's writes go through
+    if(snes->ppuWorker != NULL && adr >= 0x38 && adr <= 0x3b) ppuworker_read(snes->ppuWorker, adr);
+    return val;
   }
   if(adr < 0x80) {
     snes_catchupApu(snes); // catch up the apu before reading
@@ -298,6 +475,7 @@ uint8_t snes_readBBus(Snes* snes, uint8_t adr) {
 void snes_writeBBus(Snes* snes, uint8_t adr, uint8_t val) {
   if(adr < 0x40) {
     ppu_write(snes->ppu, adr, val);
+    if(snes->ppuWorker != NULL) ppuworker_write(snes->ppuWorker, adr, val);
     return;
   }
   if(adr < 0x80) {
@@ -307,6 +485,7 @@ void snes_writeBBus(Snes* snes, uint8_t adr, uint8_t val) {
   }
   switch(adr) {
     case 0x80: {
+      snes->ramWrites[snes->ramAdr >> 12]++;
       snes->ram[snes->ramAdr++] = val;
       snes->ramAdr &= 0x1ffff;
       break;
@@ -396,6 +575,7 @@ static void snes_writeReg(Snes* snes, uint16_t adr, uint8_t val) {
       }
       snes->nmiEnabled = val & 0x80;
 	  snes->cpu->intDelay = true; // nmi/irq is delayed by 1 opcode (TODINK: check if this conflicts with above nmi..)
+      snes->nextEventCycle = 0; // irq timing changed
 	  break;
     }
     case 0x4201: {
@@ -434,18 +614,22 @@ static void snes_writeReg(Snes* snes, uint16_t adr, uint8_t val) {
     }
     case 0x4207: {
 	  snes->hTimer = (snes->hTimer & 0x400) | (val << 2);
+      snes->nextEventCycle = 0;
       break;
     }
     case 0x4208: {
 	  snes->hTimer = (snes->hTimer & 0x03fc) | ((val & 1) << 10);
+      snes->nextEventCycle = 0;
       break;
     }
     case 0x4209: {
       snes->vTimer = (snes->vTimer & 0x100) | val;
+      snes->nextEventCycle = 0;
       break;
     }
     case 0x420a: {
       snes->vTimer = (snes->vTimer & 0x0ff) | ((val & 1) << 8);
+      snes->nextEventCycle = 0;
       break;
     }
     case 0x420b: {
@@ -459,7 +643,7 @@ static void snes_writeReg(Snes* snes, uint16_t adr, uint8_t val) {
     case 0x420d: {
       if (snes->fastMem != (val & 0x1)) {
         snes->fastMem = val & 0x1;
-        build_accesstime(snes, true);
+        snes_selectAccessTimes(snes);
       }
       break;
     }
@@ -500,15 +684,27 @@ static uint8_t snes_rread(Snes* snes, uint32_t adr) {
 }
 
 void snes_write(Snes* snes, uint32_t adr, uint8_t val) {
+#if SNES_STATS
+  snes->stats.writes[snes_statsRegion(snes, adr)]++;
+#endif
   snes->openBus = val;
+  uint8_t* page = snes->writeMap[adr >> 12];
+  if(page != NULL) {
+    // plain wram/sram, nothing else is mapped here
+    page[adr & 0xfff] = val;
+    (*snes->pageWrites[adr >> 12])++;
+    return;
+  }
   uint8_t bank = adr >> 16;
   adr &= 0xffff;
   if(bank == 0x7e || bank == 0x7f) {
     snes->ram[((bank & 1) << 16) | adr] = val; // ram
+    snes->ramWrites[(((bank & 1) << 16) | adr) >> 12]++;
   }
   if(bank < 0x40 || (bank >= 0x80 && bank < 0xc0)) {
     if(adr < 0x2000) {
       snes->ram[adr] = val; // ram mirror
+      snes->ramWrites[adr >> 12]++;
     }
     if(adr >= 0x2100 && adr < 0x2200) {
       snes_writeBBus(snes, adr & 0xff, val); // B-bus
@@ -526,72 +722,241 @@ void snes_write(Snes* snes, uint32_t adr, uint8_t val) {
   }
   // write to cart
   cart_write(snes->cart, bank, adr, val);
+  snes->sramWrites++; // might have gone to sram
 }
 
-static int snes_getAccessTime(Snes* snes, uint32_t adr) {
-  uint8_t bank = adr >> 16;
-  adr &= 0xffff;
-  if((bank < 0x40 || (bank >= 0x80 && bank < 0xc0)) && adr < 0x8000) {
-    // 00-3f,80-bf:0-7fff
-    if(adr < 0x2000 || adr >= 0x6000) return 8; // 0-1fff, 6000-7fff
-    if(adr < 0x4000 || adr >= 0x4200) return 6; // 2000-3fff, 4200-5fff
-    return 12; // 4000-41ff
+static void snes_buildMemoryMap(Snes* snes) {
+  for(int i = 0; i < 0x1000; i++) {
+    uint8_t bank = i >> 4;
+    uint16_t adr = (i & 0xf) << 12;
+    if(bank == 0x7e || bank == 0x7f) {
+      snes->readMap[i] = snes->writeMap[i] = &snes->ram[((bank & 1) << 16) | adr];
+    } else if((bank < 0x40 || (bank >= 0x80 && bank < 0xc0)) && adr < 0x6000) {
+      // 00-3f,80-bf:0000-1fff is the wram mirror, 2000-5fff is i/o
+      snes->readMap[i] = snes->writeMap[i] = adr < 0x2000 ? &snes->ram[adr] : NULL;
+    } else {
+      snes->readMap[i] = cart_getReadPage(snes->cart, bank, adr);
+      snes->writeMap[i] = cart_getWritePage(snes->cart, bank, adr);
+    }
+    // pages are writable as a whole or not at all, so the readable ones are all the decode cache has to know about
+    const uint8_t* page = snes->readMap[i];
+    if(page != NULL && page >= snes->ram && page < snes->ram + sizeof(snes->ram)) {
+      snes->pageWrites[i] = &snes->ramWrites[(page - snes->ram) >> 12];
+    } else if(page != NULL && snes->cart->ram != NULL && page >= snes->cart->ram && page < snes->cart->ram + snes->cart->ramSize) {
+      snes->pageWrites[i] = &snes->sramWrites;
+    } else {
+      snes->pageWrites[i] = &snes->romWrites;
+    }
   }
-  // 40-7f,co-ff:0000-ffff, 00-3f,80-bf:8000-ffff
-  return (snes->fastMem && bank >= 0x80) ? 6 : 8; // depends on setting in banks 80+
 }
 
-static void build_accesstime(Snes* snes, bool recalc) {
-  int start = (recalc) ? 0x800000 : 0; // recalc only updates "fastMem" area
-  if (access_time == NULL) {
-	access_time = (uint8_t *)malloc(0x1000000);
-  }
-  for (int i = start; i < 0x1000000; i++) {
-    access_time[i] = snes_getAccessTime(snes, i);
-  }
+static void snes_selectAccessTimes(Snes* snes) {
+  snes->accessTimes = snes->fastMem ? fastAccessTimes : slowAccessTimes;
+}
+
+static inline int snes_getAccessTime(Snes* snes, uint32_t adr) {
+  // 00-3f,80-bf:0000-7fff
+  if((adr & 0x408000) == 0) return sysAccessTimes[(adr >> 9) & 0x3f];
+  // 40-7f,c0-ff:0000-ffff, 00-3f,80-bf:8000-ffff
+  return snes->accessTimes[(adr >> 22) & 3];
+}
+
+static bool snes_findBusRoom(Snes* snes, int cycles) {
+  // cpu accesses to plain memory only add to the bus debt as long as running them would just have been skipped over:
+  // no scheduler step (not even at the end), no dram refresh and no (h)dma pending. nothing can see the difference
+  // until the debt is flushed, which i/o accesses and everything outside the cpu bus path do first.
+  // none of that changes while the debt grows, so the room left is worked out once and counted down after that
+  if(snes->exactTiming) return false;
+  if(snes->dma->dmaState != 0 || snes->dma->hdmaInitRequested || snes->dma->hdmaRunRequested) return false;
+  uint64_t now = snes->cycles + snes->busDebt;
+  if(now >= snes->nextEventCycle) return false;
+  uint64_t room = snes->nextEventCycle - now;
+  int hPos = snes->hPos + snes->busDebt;
+  if(hPos < 536 && room > (uint64_t)(535 - hPos)) room = 535 - hPos;
+  snes->busRoom = room < 0x10000 ? (int)room : 0x10000;
+  return cycles <= snes->busRoom;
 }
 
-static void free_accesstime() {
-  free(access_time);
+static inline bool snes_deferCycles(Snes* snes, int cycles) {
+  if(cycles > snes->busRoom && !snes_findBusRoom(snes, cycles)) return false;
+  snes->busRoom -= cycles;
+  snes->busDebt += cycles;
+  return true;
+}
+
+static void snes_flushCycles(Snes* snes) {
+  // one skip over the whole debt ends up exactly where the separate ones would have. the access that flushes
+  // can change the timing or start dma, so the room is found again by the next one
+  snes->busRoom = 0;
+  if(snes->busDebt == 0) return;
+  int cycles = snes->busDebt;
+  snes->busDebt = 0;
+  snes_runCycles(snes, cycles);
+  SNES_STAT_ADD(snes, busCycles, cycles);
 }
 
 uint8_t snes_read(Snes* snes, uint32_t adr) {
-  uint8_t val = snes_rread(snes, adr);
+#if SNES_STATS
+  snes->stats.reads[snes_statsRegion(snes, adr)]++;
+#endif
+  const uint8_t* page = snes->readMap[adr >> 12];
+  uint8_t val = page != NULL ? page[adr & 0xfff] : snes_rread(snes, adr);
   snes->openBus = val;
   return val;
 }
 
 void snes_cpuIdle(void* mem, bool waiting) {
   Snes* snes = (Snes*) mem;
+  if(snes_deferCycles(snes, 6)) return;
+  snes_flushCycles(snes);
   dma_handleDma(snes->dma, 6);
   snes_runCycles(snes, 6);
 }
 
 uint8_t snes_cpuRead(void* mem, uint32_t adr) {
   Snes* snes = (Snes*) mem;
-  const int cycles = access_time[adr] - 4;
+  if(snes->readMap[adr >> 12] != NULL && snes_deferCycles(snes, snes_getAccessTime(snes, adr))) {
+    return snes_read(snes, adr);
+  }
+  snes_flushCycles(snes);
+  const int cycles = snes_getAccessTime(snes, adr) - 4;
   dma_handleDma(snes->dma, cycles + 4);
   snes_runCycles(snes, cycles);
   uint8_t rv = snes_read(snes, adr);
+  if(snes->readMap[adr >> 12] == NULL) {
+    // i/o, only the status registers that change at scheduler steps (or through the read itself) keep a loop idle
+    uint32_t reg = adr & 0x40ffff;
+    if(reg >= 0x4210 && reg <= 0x4212) {
+      snes->loopReads = snes->loopReads * 31 + (reg << 8 | rv);
+      if(reg == 0x4212) snes->loopHvbjoy = true;
+    } else {
+      snes->loopQuiet = false;
+    }
+  }
+  snes_runCycles(snes, 4);
+  return rv;
+}
+
+const uint8_t* snes_cpuCode(void* mem, uint32_t adr, const uint32_t** writes) {
+  // only plain rom/ram pages, reads elsewhere can have side effects or give changing (open bus) values
+  Snes* snes = (Snes*) mem;
+  const uint8_t* page = snes->readMap[adr >> 12];
+  *writes = snes->pageWrites[adr >> 12];
+  return page != NULL ? &page[adr & 0xfff] : NULL;
+}
+
+uint8_t snes_cpuFetch(void* mem, uint32_t adr, uint8_t cached, const uint8_t* code) {
+  // snes_cpuRead for a byte snes_cpuCode gave the host pointer of, and the cpu has cached
+  Snes* snes = (Snes*) mem;
+  if(snes_deferCycles(snes, snes_getAccessTime(snes, adr))) {
+    // no dma, nothing can write it before the read
+#if SNES_STATS
+    snes->stats.reads[snes_statsRegion(snes, adr)]++;
+#endif
+    snes->openBus = cached;
+    return cached;
+  }
+  snes_flushCycles(snes);
+  const int cycles = snes_getAccessTime(snes, adr) - 4;
+  dma_handleDma(snes->dma, cycles + 4);
+  snes_runCycles(snes, cycles);
+#if SNES_STATS
+  snes->stats.reads[snes_statsRegion(snes, adr)]++;
+#endif
+  uint8_t rv = *code;
+  snes->openBus = rv;
   snes_runCycles(snes, 4);
   return rv;
 }
 
 void snes_cpuWrite(void* mem, uint32_t adr, uint8_t val) {
   Snes* snes = (Snes*) mem;
-  const int cycles = access_time[adr];
+  snes->loopQuiet = false;
+  if(snes->writeMap[adr >> 12] != NULL && snes_deferCycles(snes, snes_getAccessTime(snes, adr))) {
+    snes_write(snes, adr, val);
+    return;
+  }
+  snes_flushCycles(snes);
+  const int cycles = snes_getAccessTime(snes, adr);
   dma_handleDma(snes->dma, cycles);
   snes_runCycles(snes, cycles);
   snes_write(snes, adr, val);
 }
 
+void snes_cpuLoop(void* mem, bool repeated) {
+  // an iteration that left the cpu as it was, did no writes, read the same and saw no scheduler step
+  // will do exactly the same again until the next step, so as many of them as fit before it are skipped
+  Snes* snes = (Snes*) mem;
+  snes_flushCycles(snes);
+  if(repeated && snes->loopQuiet && snes->loopReads == snes->loopLastReads && !snes->exactTiming) snes_skipIdleLoop(snes);
+  snes->loopCycle = snes->cycles;
+  snes->loopLastReads = snes->loopReads;
+  snes->loopReads = 0;
+  snes->loopAutoJoy = snes->autoJoyTimer;
+  // pending (h)dma runs on the next access, new requests only come with writes or scheduler steps
+  snes->loopQuiet = snes->dma->dmaState == 0 && !snes->dma->hdmaInitRequested && !snes->dma->hdmaRunRequested;
+  snes->loopHvbjoy = false;
+}
+
 // debugging
 
 void snes_runCpuCycle(Snes* snes) {
   cpu_runOpcode(snes->cpu);
+  snes_flushCycles(snes);
+  SNES_STAT_INC(snes, cpuOpcodes);
 }
 
 void snes_runSpcCycle(Snes* snes) {
   // TODO: apu catchup is not aware of this, SPC runs extra cycle(s)
   spc_runOpcode(snes->apu->spc);
 }
+
+// instrumentation
+
+bool snes_getStats(Snes* snes, SnesStats* stats) {
+#if SNES_STATS
+  snes_statsSwitch(snes, snes->statsTimer); // flush the running timer
+  *stats = snes->stats;
+  return true;
+#else
+  (void)snes;
+  memset(stats, 0, sizeof(SnesStats));
+  return false;
+#endif
+}
+
+void snes_resetStats(Snes* snes) {
+  memset(&snes->stats, 0, sizeof(snes->stats));
+}
+
+int snes_statsSwitch(Snes* snes, int timer) {
+  // account the time since the last switch to the running subsystem, then start timing the new one
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  uint64_t now = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+  if(snes->statsTimer < SNES_TIME_COUNT) snes->stats.timeNs[snes->statsTimer] += now - snes->statsMark;
+  snes->statsMark = now;
+  int prev = snes->statsTimer;
+  snes->statsTimer = timer;
+  return prev;
+}
+
+#if SNES_STATS
+static int snes_statsRegion(Snes* snes, uint32_t adr) {
+  uint8_t bank = adr >> 16;
+  adr &= 0xffff;
+  if(bank == 0x7e || bank == 0x7f) return SNES_REGION_WRAM;
+  if((bank < 0x40 || (bank >= 0x80 && bank < 0xc0)) && adr < 0x8000) {
+    if(adr < 0x2000) return SNES_REGION_WRAM;
+    if(adr >= 0x2100 && adr < 0x2200) return SNES_REGION_BBUS;
+    if(adr >= 0x4200 && adr < 0x4220) return SNES_REGION_REGS;
+    if(adr >= 0x4300 && adr < 0x4380) return SNES_REGION_DMA;
+    if(adr >= 0x6000 && snes->cart->ramSize > 0 && (snes->cart->type == 2 || snes->cart->type == 3)) return SNES_REGION_SRAM;
+    return SNES_REGION_OTHER;
+  }
+  if(((bank >= 0x70 && bank < 0x7e) || bank >= 0xf0) && adr < 0x8000 && snes->cart->ramSize > 0) {
+    if(snes->cart->type == 1 || snes->cart->type == 4) return SNES_REGION_SRAM;
+  }
+  return snes->cart->type == 0 ? SNES_REGION_OTHER : SNES_REGION_ROM;
+}
+#endif
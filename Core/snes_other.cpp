@@ -10,6 +10,7 @@
 #include <ppu.h>
 #include <dsp.h>
 #include <statehandler.h>
+#include <ppuworker.h>
 
 static const int stateVersion = 2;
 /*
@@ -121,9 +122,67 @@ void snes_setButtonState(Snes* snes, int player, int button, bool pressed) {
   }
 }
 
+static Ppu* snes_getFramePpu(Snes* snes) {
+  // the ppu holding the rendered pixels, waits for the worker to finish the frame if there is one
+  return snes->ppuWorker != NULL ? ppuworker_sync(snes->ppuWorker) : snes->ppu;
+}
+
 void snes_setPixels(Snes* snes, uint8_t* pixelData) {
   // size is 4 (rgba) * 512 (w) * 480 (h)
-  ppu_putPixels(snes->ppu, pixelData);
+  ppu_putPixels(snes_getFramePpu(snes), pixelData);
+}
+
+void snes_getFrameSize(Snes* snes, int* width, int* height) {
+  // size of the last frame: 256 or 512 (hires) wide, 224 or 239 (overscan) high, doubled when interlaced
+  ppu_getFrameSize(snes_getFramePpu(snes), width, height);
+}
+
+void snes_setPixelsFormat(Snes* snes, uint8_t* pixelData, int pitch, int format, int* width, int* height) {
+  // the last frame at its actual size in a PPU_FORMAT_*, pitch is in bytes
+  // the buffer needs to hold 512 * 478 pixels for the largest frames
+  Ppu* ppu = snes_getFramePpu(snes);
+  ppu_getFrameSize(ppu, width, height);
+  ppu_putFrame(ppu, pixelData, pitch, format);
+}
+
+void snes_setFrameOutput(Snes* snes, FrameBuffer* fb) {
+  // every frame is rendered into fb at the start of vblank from now on, NULL to stop
+  // the buffer is not owned, it needs to outlive its use here
+  if(snes->ppuWorker != NULL) ppuworker_sync(snes->ppuWorker); // the worker reads it when publishing
+  snes->frameOutput = fb;
+}
+
+void snes_setFrameSkip(Snes* snes, int frames) {
+  // renders one frame, then only runs the next frames without rendering them, from the next frame on
+  // skipped frames leave the pixels alone and are not published to the frame output, everything else runs as usual
+  // (while interlacing, the frame before a shown one is rendered as well, for the field it weaves in)
+  snes->frameSkip = frames > 0 ? frames : 0;
+  snes->framesToSkip = 0;
+}
+
+bool snes_frameRendered(Snes* snes) {
+  // if the last (or current) frame is shown, the pixels from snes_setPixels are only its own if so
+  return snes->showFrame;
+}
+
+void snes_setPpuThread(Snes* snes, bool enabled) {
+  // renders the lines on a separate thread, the output is the same as rendering them inline
+  if(enabled && snes->ppuWorker == NULL) {
+    snes->ppuWorker = ppuworker_init(snes);
+  } else if(!enabled && snes->ppuWorker != NULL) {
+    // keep the last frame around for snes_setPixels
+    Ppu* mirror = ppuworker_sync(snes->ppuWorker);
+    memcpy(snes->ppu->pixelBuffer, mirror->pixelBuffer, sizeof(snes->ppu->pixelBuffer));
+    ppuworker_free(snes->ppuWorker);
+    snes->ppuWorker = NULL;
+  }
+}
+
+void snes_setExactTiming(Snes* snes, bool enabled) {
+  // runs every cpu access and idle loop iteration through the scheduler one by one, without the shortcuts that skip
+  // over them (same results, only slower), to check those against
+  snes->exactTiming = enabled;
+  snes->busRoom = 0;
 }
 
 void snes_setSamples(Snes* snes, int16_t* sampleData, int samplesPerFrame) {
@@ -139,6 +198,7 @@ int snes_saveBattery(Snes* snes, uint8_t* data) {
 }
 
 bool snes_loadBattery(Snes* snes, uint8_t* data, int size) {
+  snes->sramWrites++; // might be code the cpu has cached
   return cart_handleBattery(snes->cart, false, data, &size);
 }
 
@@ -174,6 +234,16 @@ bool snes_loadState(Snes* snes, uint8_t* data, int size) {
   return true;
 }
 
+uint64_t snes_hash(uint64_t hash, const void* data, size_t size) {
+  // fnv-1a, for comparing frames, samples and memory between runs
+  const uint8_t* bytes = (const uint8_t*)data;
+  for(size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
 void readHeader(const uint8_t* data, int length, int location, CartHeader* header) {
   // read name, TODO: non-ASCII names?
   for(int i = 0; i < 21; i++) {
@@ -54,7 +54,7 @@ public actor Mango {
         emulator.type()
     }
     
-    public func framebuffer(_ buffer: @escaping (UnsafeMutablePointer<UInt8>) -> Void) {
+    public func framebuffer(_ buffer: @escaping (UnsafeMutablePointer<UInt8>, Int32, Int32, Int32) -> Void) {
         emulator.fb = buffer
     }
     
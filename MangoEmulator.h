@@ -15,7 +15,8 @@ typedef NS_ENUM(NSUInteger, SNESRomType) {
 };
 
 @interface MangoEmulator : NSObject
-@property (nonatomic, strong, nullable) void (^fb) (uint8_t*);
+@property (nonatomic, strong, nullable) void (^fb) (uint8_t*, int, int, int); // pixels (0x00bbggrr), width, height, pitch
+@property (nonatomic) BOOL ppuThread; // render the ppu lines on a second thread, off by default, read by insertCartridge
 
 +(MangoEmulator *) sharedInstance NS_SWIFT_NAME(shared());
 
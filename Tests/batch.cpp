@@ -0,0 +1,223 @@
+// checks the batch runner against running the same jobs one after another on plain Snes instances
+// builds a few small test roms in memory (with a sound program, so the audio is not silence), queues several jobs with
+// input per instance on a pool of threads, and compares the video and audio hashes and the wram of every job
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <vector>
+
+#include <snes.h>
+#include <batch.h>
+
+#include "testrom.h"
+
+static const int variants = 3;
+static const int instances = 6;
+static const int jobsPerInstance = 4;
+static const int frames = 40;
+static const int threads = 3;
+
+// spc700 program: noise on voice 0 at full volume, then loop (uploaded to $0200)
+static const uint8_t spcProgram[] = {
+  0x8f, 0x6c, 0xf2, 0x8f, 0x3f, 0xf3, // flg: no mute, no echo writes, fastest noise
+  0x8f, 0x3d, 0xf2, 0x8f, 0x01, 0xf3, // non: noise on voice 0
+  0x8f, 0x00, 0xf2, 0x8f, 0x7f, 0xf3, // v0voll
+  0x8f, 0x01, 0xf2, 0x8f, 0x40, 0xf3, // v0volr
+  0x8f, 0x05, 0xf2, 0x8f, 0x00, 0xf3, // v0adsr1: gain instead
+  0x8f, 0x07, 0xf2, 0x8f, 0x7f, 0xf3, // v0gain: direct, full
+  0x8f, 0x0c, 0xf2, 0x8f, 0x7f, 0xf3, // mvoll
+  0x8f, 0x1c, 0xf2, 0x8f, 0x7f, 0xf3, // mvolr
+  0x8f, 0x4c, 0xf2, 0x8f, 0x01, 0xf3, // kon: voice 0
+  0x2f, 0xfe // bra $-2
+};
+
+static void uploadSpc(RomBuilder* rom, int table) {
+  // the ipl rom transfer protocol, from a table in bank 0 (a 8-bit, x 16-bit)
+  const int length = sizeof(spcProgram);
+  int wait = rom->pc;
+  emit(rom, {0xad, 0x40, 0x21, 0xc9, 0xaa}); // lda $2140; cmp #$aa
+  emitBranch(rom, 0xd0, wait); // bne
+  emit(rom, {0xa2, 0x00, 0x02, 0x8e, 0x42, 0x21}); // ldx #$0200; stx $2142
+  emit(rom, {0xa9, 0x01, 0x8d, 0x41, 0x21, 0xa9, 0xcc, 0x8d, 0x40, 0x21}); // lda #$01; sta $2141; lda #$cc; sta $2140
+  wait = rom->pc;
+  emit(rom, {0xcd, 0x40, 0x21}); // cmp $2140
+  emitBranch(rom, 0xd0, wait); // bne
+  emit(rom, {0xa2, 0x00, 0x00}); // ldx #$0000
+  int loop = rom->pc;
+  emit(rom, {0xbd, table & 0xff, table >> 8, 0x8d, 0x41, 0x21}); // lda table,x; sta $2141
+  emit(rom, {0x8a, 0x8d, 0x40, 0x21}); // txa; sta $2140
+  wait = rom->pc;
+  emit(rom, {0xcd, 0x40, 0x21}); // cmp $2140
+  emitBranch(rom, 0xd0, wait); // bne
+  emit(rom, {0xe8, 0xe0, length & 0xff, length >> 8}); // inx; cpx #length
+  emitBranch(rom, 0xd0, loop); // bne
+  // start it at $0200
+  emit(rom, {0xa2, 0x00, 0x02, 0x8e, 0x42, 0x21, 0x9c, 0x41, 0x21}); // ldx #$0200; stx $2142; stz $2141
+  emit(rom, {0x18, 0x69, 0x02, 0x8d, 0x40, 0x21}); // clc; adc #$02; sta $2140
+  wait = rom->pc;
+  emit(rom, {0xcd, 0x40, 0x21}); // cmp $2140
+  emitBranch(rom, 0xd0, wait); // bne
+}
+
+static void buildRom(uint8_t* data, int variant) {
+  // random data in every bank (dma sources), program and tables in bank 0
+  RomBuilder builder = {data, 0x7feb352du * (variant + 1), 0x8000};
+  RomBuilder* rom = &builder;
+  romFill(rom);
+  int spcTable = 0xe000;
+  memcpy(&data[spcTable & 0x7fff], spcProgram, sizeof(spcProgram));
+  int rti = rom->pc;
+  emit(rom, {0x40});
+  // nmi: count frames, keep both joypads in wram, scroll by them and dma some rom to vram at the frame counter
+  int nmi = rom->pc;
+  emit(rom, {0xc2, 0x30, 0x48, 0xda, 0xe2, 0x20}); // rep #$30; pha; phx; sep #$20
+  emit(rom, {0xad, 0x10, 0x42, 0xee, 0x00, 0x00}); // lda $4210; inc $0000
+  emit(rom, {0xad, 0x18, 0x42, 0x8d, 0x02, 0x00}); // lda $4218; sta $0002
+  emit(rom, {0xad, 0x1a, 0x42, 0x8d, 0x03, 0x00}); // lda $421a; sta $0003
+  emit(rom, {0x18, 0x6d, 0x00, 0x00, 0x8d, 0x0d, 0x21, 0x9c, 0x0d, 0x21}); // clc; adc $0000; sta $210d; stz $210d
+  emit(rom, {0xad, 0x02, 0x00, 0x8d, 0x0e, 0x21, 0x9c, 0x0e, 0x21}); // lda $0002; sta $210e; stz $210e
+  emit(rom, {0xad, 0x00, 0x00, 0x8d, 0x80, 0x21}); // lda $0000; sta $2180
+  emit(rom, {0xa9, 0x80, 0x8d, 0x15, 0x21}); // lda #$80; sta $2115
+  emit(rom, {0xad, 0x00, 0x00, 0x8d, 0x16, 0x21, 0x9c, 0x17, 0x21}); // lda $0000; sta $2116; stz $2117
+  emit(rom, {0xa9, 0x01, 0x8d, 0x10, 0x43, 0xa9, 0x18, 0x8d, 0x11, 0x43}); // lda #$01; sta $4310; lda #$18; sta $4311
+  emit(rom, {0x9c, 0x12, 0x43, 0xad, 0x00, 0x00, 0x09, 0x80, 0x8d, 0x13, 0x43}); // stz $4312; lda $0000; ora #$80; sta $4313
+  emit(rom, {0xa9, 0x01, 0x8d, 0x14, 0x43, 0x9c, 0x15, 0x43, 0x8d, 0x16, 0x43}); // lda #$01; sta $4314; stz $4315; sta $4316
+  emit(rom, {0xa9, 0x02, 0x8d, 0x0b, 0x42}); // lda #$02; sta $420b
+  emit(rom, {0xc2, 0x30, 0xfa, 0x68, 0x40}); // rep #$30; plx; pla; rti
+  // reset: native mode, 8-bit a, 16-bit index
+  int reset = rom->pc;
+  emit(rom, {0x78, 0x18, 0xfb, 0xc2, 0x38, 0xa2, 0xff, 0x1f, 0x9a}); // sei; clc; xce; rep #$38; ldx #$1fff; txs
+  emit(rom, {0xa9, 0x00, 0x00, 0x5b, 0xe2, 0x20}); // lda #$0000; tcd; sep #$20
+  uploadSpc(rom, spcTable);
+  storeLong(rom, 0x2100, 0x8f);
+  storeLong(rom, 0x2115, 0x80);
+  storeLong(rom, 0x2116, 0x00);
+  storeLong(rom, 0x2117, 0x00);
+  dmaChannel0(rom, 0x01, 0x18, 0x01, 0x8000, 0x8000);
+  storeLong(rom, 0x2121, 0x00);
+  dmaChannel0(rom, 0x00, 0x22, 0x02, 0x8000, 0x200);
+  storeLong(rom, 0x2181, 0x00);
+  storeLong(rom, 0x2182, 0x10);
+  storeLong(rom, 0x2183, 0x00);
+  // screen setup, the mode differs per variant
+  storeLong(rom, 0x2105, (variant * 3) % 8 | (romRandom(rom) & 0xf0));
+  for(int reg = 0x2107; reg <= 0x210c; reg++) storeLong(rom, reg, romRandom(rom));
+  storeLong(rom, 0x212c, 0x1f);
+  storeLong(rom, 0x2100, 0x0f);
+  storeLong(rom, 0x4200, 0x81); // nmi and auto joypad read
+  emit(rom, {0xcb, 0x80, 0xfd}); // wai; bra -3
+  romHeader(rom, "MANGO BATCH TEST", false, reset, nmi, rti, rti);
+}
+
+static void makeInputs(std::vector<BatchInput>* inputs, int instance, int job) {
+  // a few changes per job, on both joypads
+  for(int i = 0; i < 4; i++) {
+    BatchInput input;
+    input.frame = i * 9 + (instance + job) % 5;
+    input.player = (i + instance) & 1;
+    input.buttons = (uint16_t)(((instance * 7 + job * 13 + i * 5) * 0x9e37u) & 0xfff);
+    inputs->push_back(input);
+  }
+}
+
+static void runSerial(Snes* snes, BatchJob* job, uint64_t* videoHash, uint64_t* audioHash, uint8_t* ram) {
+  // the same as a job in the batch runner, the plain way
+  const int samplesPerFrame = 48000 / (snes->palTiming ? 50 : 60);
+  std::vector<uint8_t> pixels(512 * 480 * 4);
+  std::vector<int16_t> samples(samplesPerFrame * 2);
+  *videoHash = SNES_HASH_INIT;
+  *audioHash = SNES_HASH_INIT;
+  int nextInput = 0;
+  for(int frame = 0; frame < job->frames; frame++) {
+    while(nextInput < job->inputCount && job->inputs[nextInput].frame <= frame) {
+      const BatchInput* input = &job->inputs[nextInput++];
+      for(int i = 0; i < 12; i++) snes_setButtonState(snes, input->player, i, (input->buttons >> i) & 1);
+    }
+    snes_runFrame(snes);
+    snes_setSamples(snes, samples.data(), samplesPerFrame);
+    *audioHash = snes_hash(*audioHash, samples.data(), samples.size() * sizeof(int16_t));
+    snes_setPixels(snes, pixels.data());
+    *videoHash = snes_hash(*videoHash, pixels.data(), pixels.size());
+  }
+  if(!(job->flags & BATCH_HASH_VIDEO)) *videoHash = 0;
+  if(!(job->flags & BATCH_HASH_AUDIO)) *audioHash = 0;
+  memcpy(ram, snes->ram, sizeof(snes->ram));
+}
+
+int main(void) {
+  std::vector<std::vector<uint8_t>> roms(variants, std::vector<uint8_t>(romSize));
+  for(int v = 0; v < variants; v++) buildRom(roms[v].data(), v);
+  // all jobs, with their inputs and a wram copy each
+  const int jobCount = instances * jobsPerInstance;
+  std::vector<std::vector<BatchInput>> inputs(jobCount);
+  std::vector<std::vector<uint8_t>> rams(jobCount, std::vector<uint8_t>(0x20000));
+  std::vector<BatchJob> jobs(jobCount);
+  for(int i = 0; i < instances; i++) {
+    for(int j = 0; j < jobsPerInstance; j++) {
+      int n = i * jobsPerInstance + j;
+      makeInputs(&inputs[n], i, j);
+      BatchJob* job = &jobs[n];
+      job->instance = i;
+      job->frames = frames;
+      job->inputs = inputs[n].data();
+      job->inputCount = (int)inputs[n].size();
+      job->flags = (j & 1 ? 0 : BATCH_HASH_VIDEO) | (j & 2 ? 0 : BATCH_HASH_AUDIO);
+      job->ram = rams[n].data();
+    }
+  }
+  // on the batch runner, queued all at once, the jobs of an instance interleaved with the others
+  Batch* batch = batch_init(threads);
+  for(int i = 0; i < instances; i++) {
+    if(batch_addInstance(batch, roms[i % variants].data(), romSize) != i) {
+      fprintf(stderr, "Failed to add instance %d\n", i);
+      return 1;
+    }
+  }
+  for(int j = 0; j < jobsPerInstance; j++) {
+    for(int i = 0; i < instances; i++) batch_submit(batch, &jobs[i * jobsPerInstance + j]);
+  }
+  batch_wait(batch);
+  batch_free(batch);
+  // one instance at a time, the same jobs in order
+  int failed = 0;
+  uint64_t firstAudio = 0;
+  bool audioDiffers = false;
+  std::vector<uint8_t> ram(0x20000);
+  for(int i = 0; i < instances; i++) {
+    Snes* snes = snes_init();
+    if(!snes_loadRom(snes, roms[i % variants].data(), romSize)) {
+      fprintf(stderr, "Failed to load test rom %d\n", i % variants);
+      return 1;
+    }
+    for(int j = 0; j < jobsPerInstance; j++) {
+      BatchJob* job = &jobs[i * jobsPerInstance + j];
+      uint64_t videoHash, audioHash;
+      runSerial(snes, job, &videoHash, &audioHash, ram.data());
+      const char* mismatch = NULL;
+      if(!job->done) mismatch = "not done";
+      else if(job->videoHash != videoHash) mismatch = "video hash";
+      else if(job->audioHash != audioHash) mismatch = "audio hash";
+      else if(memcmp(job->ram, ram.data(), ram.size()) != 0) mismatch = "wram";
+      if(mismatch != NULL) {
+        printf("instance %d (rom %d), job %d: %s mismatch\n", i, i % variants, j, mismatch);
+        failed++;
+      }
+      if(job->flags & BATCH_HASH_AUDIO) {
+        if(firstAudio == 0) firstAudio = audioHash;
+        audioDiffers |= audioHash != firstAudio;
+      }
+    }
+    snes_free(snes);
+  }
+  // the sound program has to run, or the audio hashes would only cover silence
+  if(!audioDiffers) {
+    printf("all audio hashes are the same\n");
+    failed++;
+  }
+  printf("%d of %d jobs match their serial run\n", jobCount - failed, jobCount);
+  return failed ? 1 : 0;
+}
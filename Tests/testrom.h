@@ -0,0 +1,115 @@
+// small lorom test roms built in memory, and hashing and comparing of their output, shared by the tests and the benchmark
+
+#ifndef TESTROM_H
+#define TESTROM_H
+
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <initializer_list>
+
+#include <snes.h>
+#include <cpu.h>
+
+static const int romSize = 0x20000; // 4 lorom banks
+
+typedef struct RomBuilder {
+  uint8_t* data;
+  uint32_t seed;
+  int pc; // in bank 0, $8000-$ffff
+} RomBuilder;
+
+static inline uint8_t romRandom(RomBuilder* rom) {
+  // xorshift32
+  rom->seed ^= rom->seed << 13;
+  rom->seed ^= rom->seed >> 17;
+  rom->seed ^= rom->seed << 5;
+  return rom->seed & 0xff;
+}
+
+static inline void romFill(RomBuilder* rom) {
+  // random data in every bank, to be overwritten by the program and tables
+  for(int i = 0; i < romSize; i++) rom->data[i] = romRandom(rom);
+}
+
+static inline void emit(RomBuilder* rom, std::initializer_list<int> bytes) {
+  for(int byte : bytes) rom->data[(rom->pc++) & 0x7fff] = byte;
+}
+
+static inline void emitBranch(RomBuilder* rom, int opcode, int target) {
+  // relative branch to target (backwards, within range)
+  emit(rom, {opcode, (target - (rom->pc + 2)) & 0xff});
+}
+
+static inline void storeLong(RomBuilder* rom, uint32_t adr, uint8_t val) {
+  // lda #val; sta adr (8-bit a)
+  emit(rom, {0xa9, val, 0x8f, (int)(adr & 0xff), (int)((adr >> 8) & 0xff), (int)(adr >> 16)});
+}
+
+static inline void dmaChannel0(RomBuilder* rom, int mode, int bBus, int bank, int adr, int size) {
+  storeLong(rom, 0x4300, mode);
+  storeLong(rom, 0x4301, bBus);
+  storeLong(rom, 0x4302, adr & 0xff);
+  storeLong(rom, 0x4303, adr >> 8);
+  storeLong(rom, 0x4304, bank);
+  storeLong(rom, 0x4305, size & 0xff);
+  storeLong(rom, 0x4306, size >> 8);
+  storeLong(rom, 0x420b, 0x01);
+}
+
+static inline void romHeader(RomBuilder* rom, const char* title, bool fastRom, int reset, int nmi, int irq, int rti) {
+  // header, vectors (everything but reset, nmi and irq goes to rti) and checksum
+  uint8_t* header = &rom->data[0x7fc0];
+  memset(header, ' ', 21);
+  memcpy(header, title, strlen(title));
+  header[0x15] = fastRom ? 0x30 : 0x20;
+  header[0x16] = 0x00; // rom only
+  header[0x17] = 0x07; // 128K
+  header[0x18] = 0x00;
+  header[0x19] = 0x01;
+  header[0x1a] = 0x00;
+  header[0x1b] = 0x00;
+  for(int i = 0x20; i < 0x40; i += 2) {
+    header[i] = rti & 0xff;
+    header[i + 1] = rti >> 8;
+  }
+  header[0x2a] = nmi & 0xff;
+  header[0x2b] = nmi >> 8;
+  header[0x2e] = irq & 0xff;
+  header[0x2f] = irq >> 8;
+  header[0x3c] = reset & 0xff;
+  header[0x3d] = reset >> 8;
+  header[0x1c] = 0xff;
+  header[0x1d] = 0xff;
+  header[0x1e] = 0x00;
+  header[0x1f] = 0x00;
+  uint16_t sum = 0;
+  for(int i = 0; i < romSize; i++) sum += rom->data[i];
+  header[0x1c] = (sum ^ 0xffff) & 0xff;
+  header[0x1d] = (sum ^ 0xffff) >> 8;
+  header[0x1e] = sum & 0xff;
+  header[0x1f] = sum >> 8;
+}
+
+static inline uint64_t hashFrame(Snes* snes, uint8_t* pixels, int16_t* samples, int samplesPerFrame) {
+  // the last frame's video (512 * 480 * 4 bytes of pixels) and audio, and the wram
+  snes_setSamples(snes, samples, samplesPerFrame);
+  snes_setPixels(snes, pixels);
+  uint64_t hash = SNES_HASH_INIT;
+  hash = snes_hash(hash, pixels, 512 * 480 * 4);
+  hash = snes_hash(hash, samples, samplesPerFrame * 2 * sizeof(int16_t));
+  return snes_hash(hash, snes->ram, sizeof(snes->ram));
+}
+
+static inline bool sameCpu(const Snes* a, const Snes* b) {
+  // the cpu registers and the master cycle
+  const Cpu* x = a->cpu;
+  const Cpu* y = b->cpu;
+  return a->cycles == b->cycles && x->a == y->a && x->x == y->x && x->y == y->y && x->sp == y->sp &&
+    x->pc == y->pc && x->dp == y->dp && x->k == y->k && x->db == y->db && x->mode == y->mode &&
+    x->c == y->c && x->z == y->z && x->v == y->v && x->n == y->n && x->i == y->i && x->d == y->d &&
+    x->waiting == y->waiting && x->stopped == y->stopped && x->intWanted == y->intWanted;
+}
+
+#endif
@@ -0,0 +1,170 @@
+// checks that Snes instances running at the same time on several threads do not affect each other
+// builds a few small test roms in memory, runs each alone for reference hashes, then runs several instances at once
+// (half of them with the ppu worker thread) and compares video, audio and wram every frame
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <thread>
+#include <vector>
+
+#include <snes.h>
+
+#include "testrom.h"
+
+static const int variants = 4;
+static const int instances = 8;
+static const int frames = 120;
+
+static void buildRom(uint8_t* data, int variant) {
+  // random data in every bank (dma sources), program and tables in bank 0
+  RomBuilder builder = {data, 0x9e3779b9u * (variant + 1), 0x8000};
+  RomBuilder* rom = &builder;
+  romFill(rom);
+  bool fastRom = variant & 1;
+  // interrupt handlers: an rti for the unused ones, the nmi handler does per-frame work
+  int rti = rom->pc;
+  emit(rom, {0x40});
+  int nmi = rom->pc;
+  emit(rom, {0xc2, 0x30, 0x48, 0xda, 0xe2, 0x20}); // rep #$30; pha; phx; sep #$20
+  emit(rom, {0xaf, 0x10, 0x42, 0x00}); // lda $004210
+  emit(rom, {0xee, 0x00, 0x00, 0xad, 0x00, 0x00}); // inc $0000; lda $0000 (frame counter in wram)
+  emit(rom, {0x8d, 0x0d, 0x21, 0x9c, 0x0d, 0x21}); // sta $210d; stz $210d
+  emit(rom, {0x8d, 0x02, 0x42, 0xa9, 0x5d, 0x8d, 0x03, 0x42}); // sta $4202; lda #$5d; sta $4203
+  emit(rom, {0xad, 0x00, 0x00, 0x8d, 0x40, 0x21}); // lda $0000; sta $2140
+  emit(rom, {0xad, 0x41, 0x21, 0x8d, 0x01, 0x00}); // lda $2141; sta $0001
+  emit(rom, {0xad, 0x18, 0x42, 0x8d, 0x02, 0x00}); // lda $4218; sta $0002
+  emit(rom, {0xad, 0x00, 0x00, 0x8d, 0x80, 0x21}); // lda $0000; sta $2180
+  emit(rom, {0xad, 0x16, 0x42, 0x8d, 0x03, 0x00}); // lda $4216; sta $0003
+  // 256 bytes of rom to vram at the frame counter, over channel 1
+  emit(rom, {0xa9, 0x80, 0x8d, 0x15, 0x21}); // lda #$80; sta $2115
+  emit(rom, {0xad, 0x00, 0x00, 0x8d, 0x16, 0x21, 0x9c, 0x17, 0x21}); // lda $0000; sta $2116; stz $2117
+  emit(rom, {0xa9, 0x01, 0x8d, 0x10, 0x43, 0xa9, 0x18, 0x8d, 0x11, 0x43}); // lda #$01; sta $4310; lda #$18; sta $4311
+  emit(rom, {0x9c, 0x12, 0x43, 0xad, 0x00, 0x00, 0x09, 0x80, 0x8d, 0x13, 0x43}); // stz $4312; lda $0000; ora #$80; sta $4313
+  emit(rom, {0xa9, 0x01, 0x8d, 0x14, 0x43, 0x9c, 0x15, 0x43, 0x8d, 0x16, 0x43}); // lda #$01; sta $4314; stz $4315; sta $4316
+  emit(rom, {0xa9, 0x02, 0x8d, 0x0b, 0x42}); // lda #$02; sta $420b
+  emit(rom, {0xc2, 0x30, 0xfa, 0x68, 0x40}); // rep #$30; plx; pla; rti
+  // reset: native mode, 8-bit a, 16-bit index
+  int reset = rom->pc;
+  emit(rom, {0x78, 0x18, 0xfb, 0xc2, 0x38, 0xa2, 0xff, 0x1f, 0x9a}); // sei; clc; xce; rep #$38; ldx #$1fff; txs
+  emit(rom, {0xa9, 0x00, 0x00, 0x5b, 0xe2, 0x20}); // lda #$0000; tcd; sep #$20
+  if(fastRom) {
+    // continue in the fast mirror
+    storeLong(rom, 0x420d, 0x01);
+    int next = rom->pc + 4;
+    emit(rom, {0x5c, next & 0xff, next >> 8, 0x80}); // jml $80xxxx
+  }
+  storeLong(rom, 0x2100, 0x8f);
+  storeLong(rom, 0x2115, 0x80);
+  storeLong(rom, 0x2116, 0x00);
+  storeLong(rom, 0x2117, 0x00);
+  dmaChannel0(rom, 0x01, 0x18, 0x01, 0x8000, 0x8000);
+  dmaChannel0(rom, 0x01, 0x18, 0x02, 0x8000, 0x8000);
+  storeLong(rom, 0x2121, 0x00);
+  dmaChannel0(rom, 0x00, 0x22, 0x03, 0x8000, 0x200);
+  storeLong(rom, 0x2102, 0x00);
+  storeLong(rom, 0x2103, 0x00);
+  dmaChannel0(rom, 0x00, 0x04, 0x03, 0xa000, 0x220);
+  storeLong(rom, 0x2181, 0x00);
+  storeLong(rom, 0x2182, 0x10);
+  storeLong(rom, 0x2183, 0x00);
+  // screen setup, the mode differs per variant
+  storeLong(rom, 0x2101, romRandom(rom));
+  storeLong(rom, 0x2105, (variant * 3) % 8 | (romRandom(rom) & 0xf0));
+  for(int reg = 0x2107; reg <= 0x210c; reg++) storeLong(rom, reg, romRandom(rom));
+  for(int reg = 0x211b; reg <= 0x2120; reg++) {
+    storeLong(rom, reg, romRandom(rom));
+    storeLong(rom, reg, romRandom(rom));
+  }
+  for(int reg = 0x2123; reg <= 0x2133; reg++) storeLong(rom, reg, romRandom(rom));
+  storeLong(rom, 0x212c, 0x1f);
+  storeLong(rom, 0x212d, romRandom(rom) & 0x1f);
+  // hdma on channel 2 to bg1 vertical scroll, from a table at $c000
+  int table = 0xc000;
+  for(int i = 0; i < 14; i++) {
+    data[(table & 0x7fff) + i * 3] = 0x10;
+  }
+  data[(table & 0x7fff) + 14 * 3] = 0;
+  storeLong(rom, 0x4320, 0x02);
+  storeLong(rom, 0x4321, 0x0e);
+  storeLong(rom, 0x4322, table & 0xff);
+  storeLong(rom, 0x4323, table >> 8);
+  storeLong(rom, 0x4324, 0x00);
+  storeLong(rom, 0x420c, 0x04);
+  storeLong(rom, 0x2100, 0x0f);
+  storeLong(rom, 0x4200, 0x81); // nmi and auto joypad read
+  emit(rom, {0xcb, 0x80, 0xfd}); // wai; bra -3
+  romHeader(rom, "MANGO THREAD TEST", fastRom, reset, nmi, rti, rti);
+}
+
+static bool runHashed(Snes* snes, int variant, std::vector<uint64_t>* hashes) {
+  // returns if the rom saw any of the buttons (in $4218, kept in wram by the nmi handler)
+  const int samplesPerFrame = 48000 / 60;
+  std::vector<uint8_t> pixels(512 * 480 * 4);
+  std::vector<int16_t> samples(samplesPerFrame * 2);
+  hashes->resize(frames);
+  bool pressed = false;
+  for(int i = 0; i < frames; i++) {
+    for(int button = 0; button < 12; button++) {
+      snes_setButtonState(snes, 0, button, ((i + variant) * 7 + button * 3) % 11 < 3);
+    }
+    snes_runFrame(snes);
+    (*hashes)[i] = hashFrame(snes, pixels.data(), samples.data(), samplesPerFrame);
+    pressed |= snes->ram[2] != 0;
+  }
+  return pressed;
+}
+
+int main(void) {
+  // reference hashes, one instance per rom, run alone
+  std::vector<std::vector<uint8_t>> roms(variants, std::vector<uint8_t>(romSize));
+  std::vector<std::vector<uint64_t>> reference(variants);
+  for(int v = 0; v < variants; v++) {
+    buildRom(roms[v].data(), v);
+    Snes* snes = snes_init();
+    if(!snes_loadRom(snes, roms[v].data(), romSize)) {
+      fprintf(stderr, "Failed to load test rom %d\n", v);
+      return 1;
+    }
+    bool pressed = runHashed(snes, v, &reference[v]);
+    snes_free(snes);
+    if(!pressed) {
+      fprintf(stderr, "Test rom %d never saw the joypad\n", v);
+      return 1;
+    }
+  }
+  // the roms have to differ, or cross-talk between instances would go unnoticed
+  for(int v = 1; v < variants; v++) {
+    if(reference[v][frames - 1] == reference[0][frames - 1]) {
+      fprintf(stderr, "Test roms %d and 0 end in the same state\n", v);
+      return 1;
+    }
+  }
+  // all at once, every other instance with the ppu worker
+  std::vector<Snes*> snes(instances);
+  std::vector<std::vector<uint64_t>> hashes(instances);
+  for(int i = 0; i < instances; i++) {
+    snes[i] = snes_init();
+    snes_loadRom(snes[i], roms[i % variants].data(), romSize);
+    if(i & 1) snes_setPpuThread(snes[i], true);
+  }
+  std::vector<std::thread> threads;
+  for(int i = 0; i < instances; i++) threads.emplace_back(runHashed, snes[i], i % variants, &hashes[i]);
+  for(std::thread& thread : threads) thread.join();
+  int failed = 0;
+  for(int i = 0; i < instances; i++) {
+    const std::vector<uint64_t>& ref = reference[i % variants];
+    int frame = 0;
+    while(frame < frames && hashes[i][frame] == ref[frame]) frame++;
+    if(frame < frames) {
+      printf("instance %d (rom %d%s): mismatch at frame %d\n", i, i % variants, (i & 1) ? ", ppu worker" : "", frame);
+      failed++;
+    }
+    snes_free(snes[i]);
+  }
+  printf("%d of %d concurrent instances match their serial run over %d frames\n", instances - failed, instances, frames);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,188 @@
+// checks that the timing shortcuts (idle loop skipping and the bus debt of the cpu) give exactly the same results as
+// running every access through the scheduler (snes_setExactTiming)
+// builds a few test roms in memory that spend their time polling $4210/$4212 and wram flags set by interrupts, runs
+// each with and without the shortcuts and compares the cpu, master cycle, video, audio and wram every frame
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <vector>
+
+#include <snes.h>
+
+#include "testrom.h"
+
+static const int variants = 4;
+static const int frames = 120;
+
+static void buildRom(uint8_t* data, int variant) {
+  // program and tables in bank 0, random data in the others (dma sources)
+  RomBuilder builder = {data, 0x85ebca6bu * (variant + 1), 0x8000};
+  RomBuilder* rom = &builder;
+  romFill(rom);
+  bool fastRom = variant & 1;
+  bool useNmi = variant != 2;
+  bool useIrq = variant >= 2;
+  int rti = rom->pc;
+  emit(rom, {0x40});
+  // nmi: acknowledge, set the wram flag, keep the joypad, and for fastrom some dma to vram
+  int nmi = rom->pc;
+  // (a can be 16-bit in the main loop, rti restores the flags)
+  emit(rom, {0xc2, 0x20, 0x48, 0xe2, 0x20}); // rep #$20; pha; sep #$20
+  emit(rom, {0xad, 0x10, 0x42, 0xe6, 0x10}); // lda $4210; inc $10
+  emit(rom, {0xad, 0x18, 0x42, 0x85, 0x14}); // lda $4218; sta $14
+  if(fastRom) {
+    storeLong(rom, 0x2116, 0x00);
+    emit(rom, {0xa5, 0x10, 0x8f, 0x17, 0x21, 0x00}); // lda $10; sta $002117
+    dmaChannel0(rom, 0x01, 0x18, 0x01, 0x8000, 0x100);
+  }
+  emit(rom, {0xc2, 0x20, 0x68, 0x40}); // rep #$20; pla; rti
+  // irq: acknowledge and count
+  int irq = rom->pc;
+  emit(rom, {0xc2, 0x20, 0x48, 0xe2, 0x20}); // rep #$20; pha; sep #$20
+  emit(rom, {0xad, 0x11, 0x42, 0xe6, 0x12, 0xc2, 0x20, 0x68, 0x40}); // lda $4211; inc $12; rep #$20; pla; rti
+  // reset: native mode, 8-bit a, 16-bit index
+  int reset = rom->pc;
+  emit(rom, {0x78, 0x18, 0xfb, 0xc2, 0x38, 0xa2, 0xff, 0x1f, 0x9a}); // sei; clc; xce; rep #$38; ldx #$1fff; txs
+  emit(rom, {0xa9, 0x00, 0x00, 0x5b, 0xe2, 0x20}); // lda #$0000; tcd; sep #$20
+  if(fastRom) {
+    storeLong(rom, 0x420d, 0x01);
+    int next = rom->pc + 4;
+    emit(rom, {0x5c, next & 0xff, next >> 8, 0x80}); // jml $80xxxx
+  }
+  storeLong(rom, 0x2100, 0x8f);
+  storeLong(rom, 0x2115, 0x80);
+  storeLong(rom, 0x2116, 0x00);
+  storeLong(rom, 0x2117, 0x00);
+  dmaChannel0(rom, 0x01, 0x18, 0x01, 0x8000, 0x8000);
+  storeLong(rom, 0x2121, 0x00);
+  dmaChannel0(rom, 0x00, 0x22, 0x03, 0x8000, 0x200);
+  storeLong(rom, 0x2105, 0x01);
+  storeLong(rom, 0x2107, 0x00);
+  storeLong(rom, 0x210b, 0x00);
+  storeLong(rom, 0x212c, 0x03);
+  if(fastRom) {
+    // hdma on channel 2 to bg1 vertical scroll, from a table at $c000
+    int table = 0xc000;
+    for(int i = 0; i < 14; i++) data[(table & 0x7fff) + i * 3] = 0x10;
+    data[(table & 0x7fff) + 14 * 3] = 0;
+    storeLong(rom, 0x4320, 0x02);
+    storeLong(rom, 0x4321, 0x0e);
+    storeLong(rom, 0x4322, table & 0xff);
+    storeLong(rom, 0x4323, table >> 8);
+    storeLong(rom, 0x4324, 0x00);
+    storeLong(rom, 0x420c, 0x04);
+  }
+  storeLong(rom, 0x2100, 0x0f);
+  if(useIrq) {
+    storeLong(rom, 0x4207, 0x88); // h-timer, just after the dram refresh
+    storeLong(rom, 0x4208, 0x00);
+    storeLong(rom, 0x4209, 0x60); // v-timer
+    storeLong(rom, 0x420a, 0x00);
+  }
+  // nmi, h irq on every line or v irq, always auto joypad read
+  storeLong(rom, 0x4200, (useNmi ? 0x80 : 0) | (useIrq ? (variant == 2 ? 0x10 : 0x20) : 0) | 0x01);
+  if(useIrq) emit(rom, {0x58}); // cli
+  // main loop, nearly all of it spent in polling loops
+  int main = rom->pc;
+  if(useNmi) {
+    emit(rom, {0x64, 0x10}); // stz $10
+    int spin = rom->pc;
+    if(variant == 3) {
+      emit(rom, {0xc2, 0x20, 0xa5, 0x10, 0xe2, 0x20}); // rep #$20; lda $10; sep #$20
+      emitBranch(rom, 0xf0, spin); // beq
+    } else {
+      emit(rom, {0xa5, 0x10}); // lda $10
+      emitBranch(rom, 0xf0, spin); // beq
+    }
+  } else {
+    int spin = rom->pc;
+    emit(rom, {0xad, 0x10, 0x42}); // lda $4210
+    emitBranch(rom, 0x10, spin); // bpl
+  }
+  int spin = rom->pc;
+  emit(rom, {0xad, 0x12, 0x42}); // lda $4212 (till vblank ends)
+  emitBranch(rom, 0x30, spin); // bmi
+  for(int line = 0; line < 3; line++) {
+    spin = rom->pc;
+    emit(rom, {0x2c, 0x12, 0x42}); // bit $4212 (till hblank)
+    emitBranch(rom, 0x50, spin); // bvc
+    spin = rom->pc;
+    emit(rom, {0x2c, 0x12, 0x42}); // bit $4212 (till hblank ends)
+    emitBranch(rom, 0x70, spin); // bvs
+    emit(rom, {0xee, 0x21, 0x00}); // inc $0021
+  }
+  // rom to wram copy, only plain memory (over several dram refreshes)
+  emit(rom, {0xa2, 0x00, 0x03}); // ldx #$0300
+  int copy = rom->pc;
+  emit(rom, {0xbd, 0xff, 0x8f, 0x9d, 0xff, 0x03, 0xca}); // lda $8fff,x; sta $03ff,x; dex
+  emitBranch(rom, 0xd0, copy); // bne
+  spin = rom->pc;
+  emit(rom, {0xad, 0x12, 0x42}); // lda $4212 (till vblank)
+  emitBranch(rom, 0x10, spin); // bpl
+  spin = rom->pc;
+  emit(rom, {0xad, 0x12, 0x42, 0x4a}); // lda $4212; lsr (till auto joypad read is done)
+  emitBranch(rom, 0xb0, spin); // bcs
+  emit(rom, {0xad, 0x18, 0x42, 0x85, 0x20}); // lda $4218; sta $20
+  emit(rom, {0xa5, 0x12, 0x8d, 0x0d, 0x21, 0x9c, 0x0d, 0x21}); // lda $12; sta $210d; stz $210d
+  emit(rom, {0x4c, main & 0xff, main >> 8}); // jmp main
+  romHeader(rom, "MANGO TIMING TEST", fastRom, reset, nmi, irq, rti);
+}
+
+int main(void) {
+  const int samplesPerFrame = 48000 / 60;
+  std::vector<uint8_t> pixels(512 * 480 * 4);
+  std::vector<int16_t> samples(samplesPerFrame * 2);
+  std::vector<uint8_t> data(romSize);
+  int failed = 0;
+  for(int v = 0; v < variants; v++) {
+    buildRom(data.data(), v);
+    // exact timing and with the shortcuts
+    Snes* snes[2];
+    for(int i = 0; i < 2; i++) {
+      snes[i] = snes_init();
+      if(!snes_loadRom(snes[i], data.data(), romSize)) {
+        fprintf(stderr, "Failed to load test rom %d\n", v);
+        return 1;
+      }
+    }
+    snes_setExactTiming(snes[0], true);
+    int frame = 0;
+    const char* mismatch = NULL;
+    bool pressed = false;
+    for(; frame < frames && mismatch == NULL; frame++) {
+      uint64_t hashes[2];
+      for(int i = 0; i < 2; i++) {
+        for(int button = 0; button < 12; button++) {
+          snes_setButtonState(snes[i], 0, button, ((frame + v) * 5 + button * 3) % 7 < 2);
+        }
+        snes_runFrame(snes[i]);
+        hashes[i] = hashFrame(snes[i], pixels.data(), samples.data(), samplesPerFrame);
+      }
+      pressed |= snes[0]->ram[0x20] != 0; // $4218, as read by the main loop
+      if(!sameCpu(snes[1], snes[0])) mismatch = "cpu mismatch";
+      else if(hashes[1] != hashes[0]) mismatch = "frame mismatch";
+    }
+    if(mismatch != NULL) {
+      printf("rom %d: %s in frame %d, at %02x:%04x\n", v, mismatch, frame - 1, snes[0]->cpu->k, snes[0]->cpu->pc);
+      failed++;
+    } else if(!pressed) {
+      printf("rom %d: never saw the joypad\n", v);
+      failed++;
+    }
+    // the shortcuts have to have done something (checked by the build of this test with SNES_STATS)
+    SnesStats stats;
+    if(mismatch == NULL && snes_getStats(snes[1], &stats)) {
+      if(stats.idleCycles == 0) printf("rom %d: no idle loop cycles skipped\n", v);
+      if(stats.busCycles == 0) printf("rom %d: no bus cycles deferred\n", v);
+      if(stats.idleCycles == 0 || stats.busCycles == 0) failed++;
+    }
+    for(int i = 0; i < 2; i++) snes_free(snes[i]);
+  }
+  printf("%d of %d roms match with exact timing over %d frames\n", variants - failed, variants, frames);
+  if(!SNES_STATS) printf("built without SNES_STATS, the shortcuts were not checked for having skipped anything\n");
+  return failed ? 1 : 0;
+}
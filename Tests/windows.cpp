@@ -0,0 +1,158 @@
+// checks the window registers ($2123-$212F) and the color window against a plain model of them
+// builds a test rom per case in memory that shows all four mode 0 layers, BG1/BG3 on the main screen and BG2/BG4 on
+// the sub screen added to it, each a single color, with random window settings, and checks every pixel of a line
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <vector>
+
+#include <snes.h>
+#include <ppu.h>
+
+#include "testrom.h"
+
+static const int cases = 64;
+static const int frames = 3;
+static const int line = 100;
+
+// blue on the main screen, green on the sub screen (BGR555 intensities), so that both show in the added color
+static const int bg1Blue = 16;
+static const int bg3Blue = 8;
+static const int backdropBlue = 4;
+static const int bg2Green = 16;
+static const int bg4Green = 8;
+
+typedef struct WindowCase {
+  uint8_t regs[15]; // $2123-$2131
+} WindowCase;
+
+static WindowCase makeCase(RomBuilder* rom) {
+  WindowCase c;
+  for(int i = 0; i < 15; i++) c.regs[i] = romRandom(rom);
+  c.regs[0x2c - 0x23] = 0x05; // BG1 and BG3 on the main screen
+  c.regs[0x2d - 0x23] = 0x0a; // BG2 and BG4 on the sub screen
+  c.regs[0x2e - 0x23] &= 0x0f;
+  c.regs[0x2f - 0x23] &= 0x0f;
+  c.regs[0x30 - 0x23] = (c.regs[0x30 - 0x23] & 0xf0) | 0x02; // clip and prevent math from the color window, add sub
+  c.regs[0x31 - 0x23] = 0x25; // add to BG1, BG3 and the backdrop
+  return c;
+}
+
+static void buildRom(uint8_t* data, const WindowCase* c) {
+  // program in bank 0, vram and cgram contents in bank 1
+  RomBuilder builder = {data, 0x27d4eb2fu, 0x8000};
+  RomBuilder* rom = &builder;
+  romFill(rom);
+  // vram: 2bpp tile 1 all color 1, the four maps ($0400, $0800, $0c00, $1000) all tile 1
+  uint8_t* vram = &data[0x8000];
+  memset(vram, 0, 0x2800);
+  for(int i = 8; i < 16; i++) vram[i * 2] = 0xff;
+  for(int i = 0x400; i < 0x1400; i++) vram[i * 2] = 0x01;
+  // cgram: backdrop and color 1 of each layer's first palette
+  uint8_t* cgram = &data[0xa800];
+  memset(cgram, 0, 0x100);
+  const int colors[5][2] = {{0, backdropBlue << 10}, {1, bg1Blue << 10}, {33, bg2Green << 5}, {65, bg3Blue << 10},
+    {97, bg4Green << 5}};
+  for(int i = 0; i < 5; i++) {
+    cgram[colors[i][0] * 2] = colors[i][1] & 0xff;
+    cgram[colors[i][0] * 2 + 1] = colors[i][1] >> 8;
+  }
+  int rti = rom->pc;
+  emit(rom, {0x40});
+  int reset = rom->pc;
+  emit(rom, {0x78, 0x18, 0xfb, 0xc2, 0x38, 0xa2, 0xff, 0x1f, 0x9a, 0xe2, 0x20}); // sei; clc; xce; rep #$38; ldx #$1fff; txs; sep #$20
+  storeLong(rom, 0x2100, 0x8f);
+  storeLong(rom, 0x2115, 0x80);
+  storeLong(rom, 0x2116, 0x00);
+  storeLong(rom, 0x2117, 0x00);
+  dmaChannel0(rom, 0x01, 0x18, 0x01, 0x8000, 0x2800);
+  storeLong(rom, 0x2121, 0x00);
+  dmaChannel0(rom, 0x00, 0x22, 0x01, 0xa800, 0x100);
+  storeLong(rom, 0x2105, 0x00); // mode 0
+  for(int i = 0; i < 4; i++) storeLong(rom, 0x2107 + i, (i + 1) << 2);
+  storeLong(rom, 0x210b, 0x00);
+  storeLong(rom, 0x210c, 0x00);
+  storeLong(rom, 0x2132, 0xe0); // fixed color black
+  for(int i = 0; i < 15; i++) storeLong(rom, 0x2123 + i, c->regs[i]);
+  storeLong(rom, 0x2100, 0x0f);
+  int loop = rom->pc;
+  emit(rom, {0x4c, loop & 0xff, loop >> 8}); // jmp loop
+  romHeader(rom, "MANGO WINDOW TEST", false, reset, rti, rti, rti);
+}
+
+static bool inWindow(const WindowCase* c, int layer, int x) {
+  // window mask of a layer (0-3: BG1-4, 4: OBJ, 5: color) at x
+  uint8_t sel = c->regs[(layer >> 1)] >> ((layer & 1) * 4);
+  uint8_t logic = layer < 4 ? c->regs[0x2a - 0x23] >> (layer * 2) : c->regs[0x2b - 0x23] >> ((layer - 4) * 2);
+  int w1l = c->regs[0x26 - 0x23], w1r = c->regs[0x27 - 0x23];
+  int w2l = c->regs[0x28 - 0x23], w2r = c->regs[0x29 - 0x23];
+  bool in1 = (x >= w1l && x <= w1r) != ((sel & 1) != 0);
+  bool in2 = (x >= w2l && x <= w2r) != ((sel & 4) != 0);
+  bool use1 = sel & 2, use2 = sel & 8;
+  if(!use1 && !use2) return false;
+  if(!use2) return in1;
+  if(!use1) return in2;
+  switch(logic & 3) {
+    case 0: return in1 || in2;
+    case 1: return in1 && in2;
+    case 2: return in1 != in2;
+    default: return in1 == in2;
+  }
+}
+
+static bool shown(const WindowCase* c, int layer, bool sub, int x) {
+  uint8_t windowed = c->regs[(sub ? 0x2f : 0x2e) - 0x23];
+  return !((windowed >> layer) & 1) || !inWindow(c, layer, x);
+}
+
+static bool colorMode(int mode, bool inColorWindow) {
+  // never, outside, inside, always
+  const bool modes[4] = {false, !inColorWindow, inColorWindow, true};
+  return modes[mode & 3];
+}
+
+int main(void) {
+  std::vector<uint8_t> data(romSize);
+  std::vector<uint32_t> pixels(512 * 478);
+  RomBuilder random = {NULL, 0x165667b1u, 0};
+  int failed = 0;
+  for(int n = 0; n < cases; n++) {
+    WindowCase c = makeCase(&random);
+    buildRom(data.data(), &c);
+    Snes* snes = snes_init();
+    if(!snes_loadRom(snes, data.data(), romSize)) {
+      fprintf(stderr, "Failed to load test rom %d\n", n);
+      return 1;
+    }
+    for(int frame = 0; frame < frames; frame++) snes_runFrame(snes);
+    int width, height;
+    snes_setPixelsFormat(snes, (uint8_t*)pixels.data(), 512 * 4, PPU_FORMAT_XRGB8888, &width, &height);
+    snes_free(snes);
+    int mismatches = 0;
+    for(int x = 0; x < 256; x++) {
+      int blue = shown(&c, 0, false, x) ? bg1Blue : shown(&c, 2, false, x) ? bg3Blue : backdropBlue;
+      int green = shown(&c, 1, true, x) ? bg2Green : shown(&c, 3, true, x) ? bg4Green : 0;
+      bool inColorWindow = inWindow(&c, 5, x);
+      if(colorMode(c.regs[0x30 - 0x23] >> 6, inColorWindow)) blue = 0;
+      if(colorMode(c.regs[0x30 - 0x23] >> 4, inColorWindow)) green = 0;
+      uint32_t pixel = pixels[line * width + x];
+      int gotBlue = (pixel & 0xff) >> 3, gotGreen = ((pixel >> 8) & 0xff) >> 3, gotRed = (pixel >> 16) >> 3;
+      if(gotBlue != blue || gotGreen != green || gotRed != 0) {
+        if(mismatches == 0) {
+          printf("case %d: at x %d, got b %d g %d r %d, expected b %d g %d (regs", n, x, gotBlue, gotGreen, gotRed,
+            blue, green);
+          for(int i = 0; i < 15; i++) printf(" %02x", c.regs[i]);
+          printf(")\n");
+        }
+        mismatches++;
+      }
+    }
+    if(mismatches) failed++;
+  }
+  printf("%d of %d window cases match\n", cases - failed, cases);
+  return failed ? 1 : 0;
+}